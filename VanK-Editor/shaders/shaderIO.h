@@ -31,6 +31,19 @@ struct UniformBuffer
     uint64_t countBuffer;
     uint32_t numvert;
     uint32_t numindic;
+    vec4 frustumPlanes[6];   // world space, xyz = normal, w = distance
+    vec3 cameraPosition;
+    uint32_t meshletCount;
+    uint64_t meshletBuffer;
+    uint32_t meshletCulling; // 0 = emit every meshlet
+    uint64_t lodGroupBuffer;
+    uint64_t lodBuffer;
+    uint32_t lodGroupCount;
+    float lodErrorScale;     // model units at distance 1 to pixels
+    float lodThreshold;      // max projected error in pixels
+    uint32_t lodEnabled;     // 0 = always LOD 0
+    uint32_t baseVertex;     // model range in the shared geometry buffers,
+    uint32_t baseIndex;      // meshlet and LOD index ranges are relative to it
 };
 
 struct InstancedIndexData
@@ -66,6 +79,50 @@ struct InstancedStorageData
   float ao;
 };
 
+// Cluster of up to MeshletMaxVertices / MeshletMaxTriangles, indices [firstIndex, firstIndex + triangleCount * 3)
+STATIC_CONST uint32_t MeshletMaxVertices  = 64;
+STATIC_CONST uint32_t MeshletMaxTriangles = 124;
+
+struct Meshlet
+{
+    vec3 center;
+    float radius;
+    vec3 coneAxis;
+    float coneCutoff;   // backface cone, 1 = never culled
+    uint32_t firstIndex;
+    uint32_t triangleCount;
+    uint32_t vertexCount;
+    uint32_t lodGroup;
+    uint32_t lodLevel;
+};
+
+// LOD chain of one mesh, picked per instance from the projected error at the bounding sphere
+struct MeshLodGroup
+{
+    vec3 center;
+    float radius;
+    uint32_t firstLod;
+    uint32_t lodCount;
+};
+
+struct MeshLod
+{
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    uint32_t firstMeshlet;
+    uint32_t meshletCount;
+    float error;        // simplification error in model units, 0 for LOD 0
+};
+
+// per frame slot in the count buffer, drawCount is what DrawIndexedIndirectCount reads
+struct MeshletCullStats
+{
+    uint32_t drawCount;
+    uint32_t visibleTriangles;
+    uint32_t visibleMeshlets;
+    uint32_t padding;
+};
+
 struct DrawIndexedIndirectCommand
 {
     uint indexCount;
@@ -1,6 +1,9 @@
 #include "VulkanBuffer.h"
 
+#include <algorithm>
+
 #include "VanK/Core/core.h"
+#include "VulkanUploadContext.h"
 
 VanK::VulkanVanKBuffer::VulkanVanKBuffer(uint64_t size) {}
 
@@ -18,7 +21,7 @@ VanK::VulkanVertexBuffer::VulkanVertexBuffer(uint64_t size)
     m_vertexBuffer = instance.GetAllocator().createBuffer
     (
         size,
-        vk::BufferUsageFlagBits2::eVertexBuffer | vk::BufferUsageFlagBits2::eStorageBuffer | vk::BufferUsageFlagBits2::eTransferDst | vk::BufferUsageFlagBits2::eShaderDeviceAddress,
+        vk::BufferUsageFlagBits2::eVertexBuffer | vk::BufferUsageFlagBits2::eStorageBuffer | vk::BufferUsageFlagBits2::eTransferSrc | vk::BufferUsageFlagBits2::eTransferDst | vk::BufferUsageFlagBits2::eShaderDeviceAddress,
         VMA_MEMORY_USAGE_GPU_ONLY
     );
     DBG_VK_NAME(m_vertexBuffer.buffer);
@@ -40,10 +43,6 @@ void VanK::VulkanVertexBuffer::Unbind() const
 {
 }
 
-void VanK::VulkanVertexBuffer::Upload(const void* data, size_t size)
-{
-}
-
 VanK::VulkanIndexBuffer::VulkanIndexBuffer(uint64_t size) : m_Count(size / sizeof(uint32_t))  // Calculate count from size
 {
     VK_CORE_INFO("Created IndexBuffer");
@@ -52,7 +51,7 @@ VanK::VulkanIndexBuffer::VulkanIndexBuffer(uint64_t size) : m_Count(size / sizeo
     m_indexBuffer = instance.GetAllocator().createBuffer
     (
         size,
-        vk::BufferUsageFlagBits2::eIndexBuffer | vk::BufferUsageFlagBits2::eTransferDst | vk::BufferUsageFlagBits2::eShaderDeviceAddress,
+        vk::BufferUsageFlagBits2::eIndexBuffer | vk::BufferUsageFlagBits2::eTransferSrc | vk::BufferUsageFlagBits2::eTransferDst | vk::BufferUsageFlagBits2::eShaderDeviceAddress,
         VMA_MEMORY_USAGE_GPU_ONLY
     );
     DBG_VK_NAME(m_indexBuffer.buffer);
@@ -74,12 +73,13 @@ void VanK::VulkanIndexBuffer::Unbind() const
 {
 }
 
-void VanK::VulkanIndexBuffer::Upload(const void* data, size_t size, size_t offset)
+VanK::VulkanTransferBuffer::VulkanTransferBuffer(uint64_t regionSize, VanKTransferBufferUsage usage, uint32_t regionCount)
+    // regions start 256 byte aligned, no upload alignment reaches past that
+    : m_RegionSize((regionSize + 255) & ~VkDeviceSize(255)), m_RegionFrames(std::max(regionCount, 1u), 0),
+      m_Region(static_cast<uint32_t>(m_RegionFrames.size()) - 1)
 {
-}
+    m_size = m_RegionSize * m_RegionFrames.size();
 
-VanK::VulkanTransferBuffer::VulkanTransferBuffer(uint64_t size, VanKTransferBufferUsage usage) : m_size(size)
-{
     VK_CORE_INFO("Created TransferBuffer");
     auto& instance = VulkanRendererAPI::Get();
 
@@ -93,7 +93,7 @@ VanK::VulkanTransferBuffer::VulkanTransferBuffer(uint64_t size, VanKTransferBuff
 
     m_transferBuffer = instance.GetAllocator().createBuffer
     (
-        size,
+        m_size,
         vk::BufferUsageFlagBits2::eTransferSrc,
         memoryUsage,
         VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT
@@ -130,35 +130,55 @@ void VanK::VulkanTransferBuffer::Unbind() const
  *        + VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT // If the CPU will sequentially write to the buffer's memory,
  */
 
-void* VanK::VulkanTransferBuffer::MapTransferBuffer(uint64_t size, uint64_t alignment, uint64_t& outOffset)
+bool VanK::VulkanTransferBuffer::BeginFrame()
 {
     auto& instance = VulkanRendererAPI::Get();
-    
-    //ring buffer offset
+    const uint64_t frame = instance.GetRecordingFrame();
+    if (m_Frame == frame)
+        return true;
 
-    // --- check if request itself is too large ---
-    if (size > m_size) {
-        VK_CORE_ERROR("VulkanTransferBuffer::MapTransferBuffer Requested transfer size ({0}) exceeds transfer buffer size ({1})!", size, m_size);
-        VK_CORE_ASSERT(false, "Transfer size too large!");
-    }
+    // the copies out of a region run with the frame that wrote it, it is free again once that frame has finished
+    uint32_t region = (m_Region + 1) % static_cast<uint32_t>(m_RegionFrames.size());
+    if (m_RegionFrames[region] > instance.GetCompletedFrame())
+        return false;
+
+    m_Region = region;
+    m_RegionFrames[region] = frame;
+    m_Frame = frame;
+    m_currentOffset = region * m_RegionSize;
+    return true;
+}
+
+uint64_t VanK::VulkanTransferBuffer::GetFreeSpace(uint64_t alignment) const
+{
+    if (m_Frame != VulkanRendererAPI::Get().GetRecordingFrame())
+        return 0;
 
-    // Calculate aligned offset without committing
+    VkDeviceSize regionEnd = (m_Region + 1) * m_RegionSize;
     VkDeviceSize alignedOffset = (m_currentOffset + alignment - 1) & ~(alignment - 1);
+    return alignedOffset < regionEnd ? regionEnd - alignedOffset : 0;
+}
+
+void* VanK::VulkanTransferBuffer::MapTransferBuffer(uint64_t size, uint64_t alignment, uint64_t& outOffset)
+{
+    auto& instance = VulkanRendererAPI::Get();
 
-    // Check if space from current offset to end is enough
-    if (alignedOffset + size > m_size)
+    // a frame never wraps into another region, the GPU may still be copying out of it
+    if (m_Frame != instance.GetRecordingFrame())
     {
-        // wrap around
-        alignedOffset = 0;
-
-        // If wrapped space is still not enough, fail early
-        if (size > m_currentOffset) {
-            VK_CORE_ERROR("Not enough space in transfer buffer. Requested {0}, buffer size {1}, current offset {2}", size, m_size, m_currentOffset);
-            VK_CORE_ASSERT(false, "Transfer buffer overflow!");
-            return nullptr;
-        }
+        VK_CORE_ERROR("VulkanTransferBuffer::MapTransferBuffer called before BeginFrame for frame {0}", instance.GetRecordingFrame());
+        VK_CORE_ASSERT(false, "Transfer buffer used outside its frame!");
+        return nullptr;
+    }
+    if (size > GetFreeSpace(alignment))
+    {
+        VK_CORE_ERROR("Not enough space in transfer buffer. Requested {0}, region size {1}, used {2}", size, m_RegionSize, m_currentOffset - m_Region * m_RegionSize);
+        VK_CORE_ASSERT(false, "Transfer buffer overflow!");
+        return nullptr;
     }
 
+    VkDeviceSize alignedOffset = (m_currentOffset + alignment - 1) & ~(alignment - 1);
+
     // Only map memory now that we know there is enough space
     // Map and copy data to the staging buffer 
     void* mappedPtr = nullptr;
@@ -201,7 +221,7 @@ void VanK::VulkanTransferBuffer::UploadToGPUBuffer(VanKCommandBuffer cmd, VanKTr
     (
         Unwrap(cmd),
         static_cast<VkBuffer>(bufferRegion.buffer->GetNativeHandle()),
-        vk::PipelineStageFlagBits2::eVertexShader | vk::PipelineStageFlagBits2::eFragmentShader | vk::PipelineStageFlagBits2::eComputeShader,
+        vk::PipelineStageFlagBits2::eVertexShader | vk::PipelineStageFlagBits2::eFragmentShader | vk::PipelineStageFlagBits2::eComputeShader | vk::PipelineStageFlagBits2::eDrawIndirect,
         vk::PipelineStageFlagBits2::eTransfer
     );
         
@@ -222,13 +242,10 @@ VanK::VulkanUniformBuffer::VulkanUniformBuffer(uint64_t size)
     VK_CORE_INFO("Created UniformBuffer");
     auto& instance = VulkanRendererAPI::Get();
 
-    m_uniformBuffer = instance.GetAllocator().createBuffer
-    (
-        size,
-        vk::BufferUsageFlagBits2::eUniformBuffer | vk::BufferUsageFlagBits2::eTransferDst | vk::BufferUsageFlagBits2::eShaderDeviceAddress,
-        VMA_MEMORY_USAGE_GPU_ONLY
-    );
-    DBG_VK_NAME(m_uniformBuffer.buffer);
+    const vk::DeviceSize alignment = instance.GetPhysicalDevice().getProperties().limits.minUniformBufferOffsetAlignment;
+    m_SlotSize = size;
+    m_SlotStride = (size + alignment - 1) / alignment * alignment;
+    createRing(InitialSlotsPerFrame);
 }
 
 VanK::VulkanUniformBuffer::~VulkanUniformBuffer()
@@ -237,6 +254,50 @@ VanK::VulkanUniformBuffer::~VulkanUniformBuffer()
     auto& instance = VulkanRendererAPI::Get();
     
     instance.GetAllocator().destroyBuffer(m_uniformBuffer);
+    for (const RetiredRing& ring : m_RetiredRings)
+        instance.GetAllocator().destroyBuffer(ring.Buffer);
+}
+
+void VanK::VulkanUniformBuffer::createRing(uint32_t slotsPerFrame)
+{
+    auto& instance = VulkanRendererAPI::Get();
+
+    m_SlotsPerFrame = slotsPerFrame;
+    m_uniformBuffer = instance.GetAllocator().createBuffer
+    (
+        m_SlotStride * m_SlotsPerFrame * MAX_FRAMES_IN_FLIGHT,
+        vk::BufferUsageFlagBits2::eUniformBuffer | vk::BufferUsageFlagBits2::eShaderDeviceAddress,
+        VMA_MEMORY_USAGE_CPU_TO_GPU,
+        VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT
+    );
+    DBG_VK_NAME(m_uniformBuffer.buffer);
+
+    VmaAllocationInfo allocationInfo{};
+    vmaGetAllocationInfo(instance.GetAllocator(), m_uniformBuffer.allocation, &allocationInfo);
+    m_Mapped = static_cast<uint8_t*>(allocationInfo.pMappedData);
+}
+
+void VanK::VulkanUniformBuffer::growRing()
+{
+    auto& instance = VulkanRendererAPI::Get();
+    VK_CORE_WARN("UniformBuffer ran out of its {} slots per frame, growing to {}", m_SlotsPerFrame, m_SlotsPerFrame * 2);
+
+    // draws recorded earlier this frame still read the old ring, the slots they used stay valid there
+    m_RetiredRings.push_back({ m_uniformBuffer, instance.GetRecordingFrame() });
+    createRing(m_SlotsPerFrame * 2);
+}
+
+void VanK::VulkanUniformBuffer::releaseRetiredRings()
+{
+    auto& instance = VulkanRendererAPI::Get();
+    const uint64_t completed = instance.GetCompletedFrame();
+    std::erase_if(m_RetiredRings, [&](const RetiredRing& ring)
+    {
+        if (ring.LastFrame > completed)
+            return false;
+        instance.GetAllocator().destroyBuffer(ring.Buffer);
+        return true;
+    });
 }
 
 void VanK::VulkanUniformBuffer::Bind() const
@@ -247,28 +308,28 @@ void VanK::VulkanUniformBuffer::Unbind() const
 {
 }
 
-void VanK::VulkanUniformBuffer::Update(VanKCommandBuffer cmd, const void* data, size_t size)
+void VanK::VulkanUniformBuffer::Update(const void* data, size_t size)
 {
-    // Add a memory barrier before updating (optional, but good practice)
-    utils::cmdBufferMemoryBarrier
-    (
-        Unwrap(cmd),
-        m_uniformBuffer.buffer,
-        vk::PipelineStageFlagBits2::eFragmentShader,
-        vk::PipelineStageFlagBits2::eTransfer
-    );
+    VK_CORE_ASSERT(size <= m_SlotSize, "UniformBuffer::Update larger than the buffer");
+    auto& instance = VulkanRendererAPI::Get();
 
-    // Update the buffer
-    vkCmdUpdateBuffer(*Unwrap(cmd), m_uniformBuffer.buffer, 0, size, data);
+    // the frame timeline wait in BeginFrame guarantees the GPU is done with this frame's region
+    if (m_SlotFrame != instance.GetFrameNumber())
+    {
+        m_SlotFrame = instance.GetFrameNumber();
+        m_NextSlot = 0;
+        if (!m_RetiredRings.empty())
+            releaseRetiredRings();
+    }
+    // overwriting a slot would change the uniforms of draws already recorded this frame
+    if (m_NextSlot == m_SlotsPerFrame)
+        growRing();
+    const uint32_t slot = m_NextSlot++;
 
-    // Add a memory barrier after updating
-    utils::cmdBufferMemoryBarrier
-    (
-        Unwrap(cmd),
-        m_uniformBuffer.buffer,
-        vk::PipelineStageFlagBits2::eTransfer,
-        vk::PipelineStageFlagBits2::eFragmentShader
-    );
+    m_CurrentOffset = (instance.GetCurrentFrame() * m_SlotsPerFrame + slot) * m_SlotStride;
+    std::memcpy(m_Mapped + m_CurrentOffset, data, size);
+    // no-op on host coherent memory, the queue submit makes the write visible
+    vmaFlushAllocation(instance.GetAllocator(), m_uniformBuffer.allocation, m_CurrentOffset, size);
 }
 
 VanK::VulkanStorageBuffer::VulkanStorageBuffer(uint64_t size)
@@ -279,7 +340,7 @@ VanK::VulkanStorageBuffer::VulkanStorageBuffer(uint64_t size)
     m_storageBuffer = instance.GetAllocator().createBuffer
     (
         size,
-        vk::BufferUsageFlagBits2::eStorageBuffer | vk::BufferUsageFlagBits2::eTransferDst | vk::BufferUsageFlagBits2::eShaderDeviceAddress,
+        vk::BufferUsageFlagBits2::eStorageBuffer | vk::BufferUsageFlagBits2::eTransferSrc | vk::BufferUsageFlagBits2::eTransferDst | vk::BufferUsageFlagBits2::eShaderDeviceAddress,
         VMA_MEMORY_USAGE_GPU_ONLY
     );
     DBG_VK_NAME(m_storageBuffer.buffer);
@@ -303,6 +364,8 @@ void VanK::VulkanStorageBuffer::Unbind() const
 
 void VanK::VulkanStorageBuffer::Upload(const void* data, size_t size, size_t offset)
 {
+    VK_CORE_ASSERT(offset + size <= m_storageBuffer.size, "StorageBuffer upload out of range");
+    VulkanRendererAPI::Get().GetUploadContext().Stage(m_storageBuffer.buffer, offset, data, size);
 }
 
 VanK::VulkanIndirectBuffer::VulkanIndirectBuffer(uint64_t size)
@@ -313,7 +376,7 @@ VanK::VulkanIndirectBuffer::VulkanIndirectBuffer(uint64_t size)
     m_indirectBuffer = instance.GetAllocator().createBuffer
     (
         size,
-        vk::BufferUsageFlagBits2::eIndirectBuffer | vk::BufferUsageFlagBits2::eStorageBuffer | vk::BufferUsageFlagBits2::eTransferDst | vk::BufferUsageFlagBits2::eShaderDeviceAddress,
+        vk::BufferUsageFlagBits2::eIndirectBuffer | vk::BufferUsageFlagBits2::eStorageBuffer | vk::BufferUsageFlagBits2::eTransferSrc | vk::BufferUsageFlagBits2::eTransferDst | vk::BufferUsageFlagBits2::eShaderDeviceAddress,
         VMA_MEMORY_USAGE_CPU_TO_GPU
     );
     DBG_VK_NAME(m_indirectBuffer.buffer);
@@ -335,6 +398,20 @@ void VanK::VulkanIndirectBuffer::Unbind() const
 {
 }
 
-void VanK::VulkanIndirectBuffer::Upload(const void* data, size_t size, size_t offset)
+void VanK::VulkanIndirectBuffer::Read(void* data, size_t size, size_t offset) const
 {
+    auto& instance = VulkanRendererAPI::Get();
+
+    void* mappedPtr = nullptr;
+    if (static_cast<vk::Result>(vmaMapMemory(instance.GetAllocator(), m_indirectBuffer.allocation, &mappedPtr)) != vk::Result::eSuccess)
+    {
+        VK_CORE_ERROR("Failed to map indirect buffer memory!");
+        return;
+    }
+
+    // CPU_TO_GPU memory is not guaranteed to be coherent
+    vmaInvalidateAllocation(instance.GetAllocator(), m_indirectBuffer.allocation, offset, size);
+    std::memcpy(data, static_cast<const uint8_t*>(mappedPtr) + offset, size);
+
+    vmaUnmapMemory(instance.GetAllocator(), m_indirectBuffer.allocation);
 }
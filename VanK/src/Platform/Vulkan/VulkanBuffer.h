@@ -32,9 +32,6 @@ namespace VanK
         virtual void Unbind() const override;
         virtual uint64_t GetBufferAddress() const override { return m_vertexBuffer.address; }
         virtual void* GetNativeHandle() const override { return (void*)m_vertexBuffer.buffer; }
-    
-        // Upload for initial setup
-        virtual void Upload(const void* data, size_t size) override;
         
         const utils::Buffer& GetBuffer() const { return m_vertexBuffer; }
 
@@ -55,9 +52,6 @@ namespace VanK
 
         uint32_t GetCount() const override { return m_Count; }
     
-        // Upload for initial setup
-        virtual void Upload(const void* data, size_t size, size_t offset) override;
-    
         const utils::Buffer& GetBuffer() const { return m_indexBuffer; }
 
     private:
@@ -68,7 +62,7 @@ namespace VanK
     class VulkanTransferBuffer : public TransferBuffer
     {
     public:
-        VulkanTransferBuffer(uint64_t size, VanKTransferBufferUsage usage);
+        VulkanTransferBuffer(uint64_t regionSize, VanKTransferBufferUsage usage, uint32_t regionCount);
         virtual ~VulkanTransferBuffer();
 
         virtual void Bind() const override;
@@ -78,6 +72,11 @@ namespace VanK
     
         const utils::Buffer& GetBuffer() const { return m_transferBuffer; }
 
+        virtual bool BeginFrame() override;
+        virtual uint32_t GetRegionCount() const override { return static_cast<uint32_t>(m_RegionFrames.size()); }
+        virtual uint64_t GetRegionSize() const override { return m_RegionSize; }
+        virtual uint64_t GetFreeSpace(uint64_t alignment) const override;
+
         virtual void* MapTransferBuffer(uint64_t size, uint64_t alignment, uint64_t& outOffset) override;
         virtual void UnMapTransferBuffer() override;
         virtual void UploadToGPUBuffer(VanKCommandBuffer cmd, VanKTransferBufferLocation location, VanKBufferRegion bufferRegion) override;
@@ -86,6 +85,10 @@ namespace VanK
         utils::Buffer m_transferBuffer;
         VkDeviceSize m_currentOffset = 0;
         VkDeviceSize m_size = 0;
+        VkDeviceSize m_RegionSize = 0;
+        std::vector<uint64_t> m_RegionFrames; // the frame that last wrote each region
+        uint32_t m_Region = 0;
+        uint64_t m_Frame = 0; // the frame the current region belongs to, 0 before the first BeginFrame
     };
 
     class VulkanUniformBuffer : public UniformBuffer
@@ -96,16 +99,41 @@ namespace VanK
 
         virtual void Bind() const override;
         virtual void Unbind() const override;
-        virtual uint64_t GetBufferAddress() const override { return m_uniformBuffer.address; }
+        virtual uint64_t GetBufferAddress() const override { return m_uniformBuffer.address + m_CurrentOffset; }
         virtual void* GetNativeHandle() const override { return (void*)m_uniformBuffer.buffer; }
 
-        // Uniform buffers use vkCmdUpdateBuffer with memory barriers
-        virtual void Update(VanKCommandBuffer cmd, const void* data, size_t size) override;
+        // memcpy into the next slot of the current frame's region, no transfer and no barriers
+        virtual void Update(const void* data, size_t size) override;
     
         const utils::Buffer& GetBuffer() const { return m_uniformBuffer; }
+        vk::DeviceSize GetCurrentOffset() const { return m_CurrentOffset; }
+        vk::DeviceSize GetSlotSize() const { return m_SlotSize; }
+
+        // updates per frame the ring starts with, it doubles when a frame runs out of slots
+        static constexpr uint32_t InitialSlotsPerFrame = 16;
 
     private:
+        void createRing(uint32_t slotsPerFrame);
+        // reallocates with twice the slots, the old ring lives until the frames that bound it are done
+        void growRing();
+        void releaseRetiredRings();
+
+        struct RetiredRing
+        {
+            utils::Buffer Buffer;
+            uint64_t LastFrame; // the frame being recorded when it was replaced, the last one that may read it
+        };
+
+        // one region per frame in flight, so the CPU never writes a slot the GPU may still be reading
         utils::Buffer m_uniformBuffer;
+        uint8_t* m_Mapped = nullptr;
+        vk::DeviceSize m_SlotSize = 0;
+        vk::DeviceSize m_SlotStride = 0;
+        vk::DeviceSize m_CurrentOffset = 0;
+        uint32_t m_SlotsPerFrame = 0;
+        uint32_t m_NextSlot = 0;
+        uint64_t m_SlotFrame = UINT64_MAX; // frame number m_NextSlot counts for
+        std::vector<RetiredRing> m_RetiredRings;
     };
 
     class VulkanStorageBuffer : public StorageBuffer
@@ -119,7 +147,7 @@ namespace VanK
         virtual uint64_t GetBufferAddress() const override { return m_storageBuffer.address; }
         virtual void* GetNativeHandle() const override { return (void*)m_storageBuffer.buffer; }
 
-        // Upload for initial setup
+        // Staged, the copy is recorded at the start of the next frame
         virtual void Upload(const void* data, size_t size, size_t offset) override;
 
         const utils::Buffer& GetBuffer() const { return m_storageBuffer; }
@@ -139,8 +167,7 @@ namespace VanK
         virtual uint64_t GetBufferAddress() const override { return m_indirectBuffer.address; }
         virtual void* GetNativeHandle() const override { return (void*)m_indirectBuffer.buffer; }
 
-        // Upload for initial setup
-        virtual void Upload(const void* data, size_t size, size_t offset) override;
+        virtual void Read(void* data, size_t size, size_t offset) const override;
 
         const utils::Buffer& GetBuffer() const { return m_indirectBuffer; }
 
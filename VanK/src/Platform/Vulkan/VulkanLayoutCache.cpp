@@ -0,0 +1,130 @@
+#include "VulkanLayoutCache.h"
+
+#include <algorithm>
+
+#include "VanK/Core/core.h"
+
+namespace VanK
+{
+    namespace
+    {
+        bool SameBinding(const vk::DescriptorSetLayoutBinding& a, const vk::DescriptorSetLayoutBinding& b)
+        {
+            return a.binding == b.binding && a.descriptorType == b.descriptorType && a.descriptorCount == b.descriptorCount
+                && a.stageFlags == b.stageFlags;
+        }
+
+        bool SameRange(const vk::PushConstantRange& a, const vk::PushConstantRange& b)
+        {
+            return a.stageFlags == b.stageFlags && a.offset == b.offset && a.size == b.size;
+        }
+    }
+
+    bool VulkanLayoutCache::DescriptorSetLayoutKey::operator==(const DescriptorSetLayoutKey& other) const
+    {
+        return Flags == other.Flags && BindingFlags == other.BindingFlags
+            && std::ranges::equal(Bindings, other.Bindings, SameBinding);
+    }
+
+    bool VulkanLayoutCache::PipelineLayoutKey::operator==(const PipelineLayoutKey& other) const
+    {
+        return SetLayouts == other.SetLayouts && std::ranges::equal(PushConstantRanges, other.PushConstantRanges, SameRange);
+    }
+
+    std::size_t VulkanLayoutCache::DescriptorSetLayoutKeyHash::operator()(const DescriptorSetLayoutKey& key) const
+    {
+        std::size_t seed = hashCombine(0, static_cast<uint32_t>(key.Flags));
+        for (const vk::DescriptorSetLayoutBinding& binding : key.Bindings)
+        {
+            seed = hashCombine(seed, binding.binding);
+            seed = hashCombine(seed, static_cast<uint32_t>(binding.descriptorType));
+            seed = hashCombine(seed, binding.descriptorCount);
+            seed = hashCombine(seed, static_cast<uint32_t>(binding.stageFlags));
+        }
+        for (vk::DescriptorBindingFlags flags : key.BindingFlags)
+            seed = hashCombine(seed, static_cast<uint32_t>(flags));
+        return seed;
+    }
+
+    std::size_t VulkanLayoutCache::PipelineLayoutKeyHash::operator()(const PipelineLayoutKey& key) const
+    {
+        std::size_t seed = 0;
+        for (const SharedDescriptorSetLayout& setLayout : key.SetLayouts)
+            seed = hashCombine(seed, setLayout.get());
+        for (const vk::PushConstantRange& range : key.PushConstantRanges)
+        {
+            seed = hashCombine(seed, static_cast<uint32_t>(range.stageFlags));
+            seed = hashCombine(seed, range.offset);
+            seed = hashCombine(seed, range.size);
+        }
+        return seed;
+    }
+
+    VulkanLayoutCache::VulkanLayoutCache(vk::raii::Device& device)
+        : m_Device(device)
+    {
+    }
+
+    VulkanLayoutCache::SharedDescriptorSetLayout VulkanLayoutCache::AcquireDescriptorSetLayout(const DescriptorSetLayoutKey& key)
+    {
+        VK_CORE_ASSERT(key.BindingFlags.empty() || key.BindingFlags.size() == key.Bindings.size(), "one binding flag per binding");
+        VK_CORE_ASSERT(std::ranges::none_of(key.Bindings, [](const vk::DescriptorSetLayoutBinding& b) { return b.pImmutableSamplers != nullptr; }),
+                       "immutable samplers are not supported by the layout cache");
+
+        if (auto it = m_DescriptorSetLayouts.find(key); it != m_DescriptorSetLayouts.end())
+        {
+            if (SharedDescriptorSetLayout layout = it->second.lock())
+                return layout;
+        }
+
+        const vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlags
+        {
+            .bindingCount = static_cast<uint32_t>(key.BindingFlags.size()),
+            .pBindingFlags = key.BindingFlags.data()
+        };
+        const vk::DescriptorSetLayoutCreateInfo createInfo
+        {
+            .pNext = key.BindingFlags.empty() ? nullptr : &bindingFlags,
+            .flags = key.Flags,
+            .bindingCount = static_cast<uint32_t>(key.Bindings.size()),
+            .pBindings = key.Bindings.data()
+        };
+        auto layout = std::make_shared<const vk::raii::DescriptorSetLayout>(m_Device, createInfo);
+        DBG_VK_NAME(**layout);
+
+        std::erase_if(m_DescriptorSetLayouts, [](const auto& entry) { return entry.second.expired(); });
+        m_DescriptorSetLayouts.insert_or_assign(key, layout);
+        return layout;
+    }
+
+    VulkanLayoutCache::SharedPipelineLayout VulkanLayoutCache::AcquirePipelineLayout(const PipelineLayoutKey& key)
+    {
+        if (auto it = m_PipelineLayouts.find(key); it != m_PipelineLayouts.end())
+        {
+            if (std::shared_ptr<const PipelineLayoutEntry> entry = it->second.lock())
+                return SharedPipelineLayout(entry, &entry->Layout);
+        }
+
+        std::vector<vk::DescriptorSetLayout> setLayouts;
+        setLayouts.reserve(key.SetLayouts.size());
+        for (const SharedDescriptorSetLayout& setLayout : key.SetLayouts)
+            setLayouts.push_back(**setLayout);
+
+        const vk::PipelineLayoutCreateInfo createInfo
+        {
+            .setLayoutCount = static_cast<uint32_t>(setLayouts.size()),
+            .pSetLayouts = setLayouts.data(),
+            .pushConstantRangeCount = static_cast<uint32_t>(key.PushConstantRanges.size()),
+            .pPushConstantRanges = key.PushConstantRanges.data()
+        };
+        auto entry = std::make_shared<PipelineLayoutEntry>();
+        entry->Layout = vk::raii::PipelineLayout(m_Device, createInfo);
+        entry->SetLayouts = key.SetLayouts;
+        DBG_VK_NAME(*entry->Layout);
+
+        std::erase_if(m_PipelineLayouts, [](const auto& cached) { return cached.second.expired(); });
+        m_PipelineLayouts.insert_or_assign(key, entry);
+        const vk::raii::PipelineLayout* layout = &entry->Layout;
+        return SharedPipelineLayout(std::move(entry), layout);
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "VulkanRendererAPI.h"
+
+namespace VanK
+{
+    /*--
+     * Hash-consed descriptor set layouts and pipeline layouts.
+     * Asking twice for the same description hands out the same Vulkan object, so every pipeline built on the same
+     * sets and push constant ranges shares one layout (hot reload included). The cache only holds weak references,
+     * an object is destroyed when the last pipeline or owner using it lets go.
+    -*/
+    class VulkanLayoutCache
+    {
+    public:
+        struct DescriptorSetLayoutKey
+        {
+            vk::DescriptorSetLayoutCreateFlags Flags;
+            std::vector<vk::DescriptorSetLayoutBinding> Bindings; // immutable samplers are not supported
+            std::vector<vk::DescriptorBindingFlags> BindingFlags; // empty, or one entry per binding
+
+            bool operator==(const DescriptorSetLayoutKey& other) const;
+        };
+
+        using SharedDescriptorSetLayout = std::shared_ptr<const vk::raii::DescriptorSetLayout>;
+        using SharedPipelineLayout = std::shared_ptr<const vk::raii::PipelineLayout>;
+
+        struct PipelineLayoutKey
+        {
+            std::vector<SharedDescriptorSetLayout> SetLayouts;
+            std::vector<vk::PushConstantRange> PushConstantRanges;
+
+            bool operator==(const PipelineLayoutKey& other) const;
+        };
+
+        explicit VulkanLayoutCache(vk::raii::Device& device);
+
+        SharedDescriptorSetLayout AcquireDescriptorSetLayout(const DescriptorSetLayoutKey& key);
+        SharedPipelineLayout AcquirePipelineLayout(const PipelineLayoutKey& key);
+
+    private:
+        struct DescriptorSetLayoutKeyHash
+        {
+            std::size_t operator()(const DescriptorSetLayoutKey& key) const;
+        };
+
+        struct PipelineLayoutKeyHash
+        {
+            std::size_t operator()(const PipelineLayoutKey& key) const;
+        };
+
+        // a pipeline layout keeps its set layouts alive, so the handles in its key can't be reused by another layout
+        struct PipelineLayoutEntry
+        {
+            vk::raii::PipelineLayout Layout = nullptr;
+            std::vector<SharedDescriptorSetLayout> SetLayouts;
+        };
+
+        vk::raii::Device& m_Device;
+
+        std::unordered_map<DescriptorSetLayoutKey, std::weak_ptr<const vk::raii::DescriptorSetLayout>, DescriptorSetLayoutKeyHash> m_DescriptorSetLayouts;
+        std::unordered_map<PipelineLayoutKey, std::weak_ptr<const PipelineLayoutEntry>, PipelineLayoutKeyHash> m_PipelineLayouts;
+    };
+}
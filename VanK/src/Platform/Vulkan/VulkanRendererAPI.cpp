@@ -17,19 +17,94 @@ printf("\n");
 #include <print>
 
 #include <SDL3/SDL_events.h>
+#include <SDL3/SDL_timer.h>
 #include <SDL3/SDL_vulkan.h>
 
+#include "VanK/Core/JobSystem.h"
 #include "VulkanBuffer.h"
+#include "VulkanLayoutCache.h"
 #include "VulkanShader.h"
+#include "VulkanUploadContext.h"
 
 namespace  VanK
 {
+    namespace
+    {
+        // counted by the frame's query, secondaries recorded inside it have to declare the same
+        constexpr vk::QueryPipelineStatisticFlags QueryStatistics =
+            vk::QueryPipelineStatisticFlagBits::eInputAssemblyVertices |
+            vk::QueryPipelineStatisticFlagBits::eInputAssemblyPrimitives |
+            vk::QueryPipelineStatisticFlagBits::eVertexShaderInvocations |
+            vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations |
+            vk::QueryPipelineStatisticFlagBits::eComputeShaderInvocations |
+            vk::QueryPipelineStatisticFlagBits::eClippingInvocations |
+            vk::QueryPipelineStatisticFlagBits::eClippingPrimitives;
+
+        // pipeline state keys, see m_PipelineByState
+        void appendBytes(std::vector<uint64_t>& key, const void* data, size_t size)
+        {
+            key.push_back(size);
+            for (size_t i = 0; i < size; i += sizeof(uint64_t))
+            {
+                uint64_t word = 0;
+                std::memcpy(&word, static_cast<const uint8_t*>(data) + i, std::min(sizeof(uint64_t), size - i));
+                key.push_back(word);
+            }
+        }
+
+        void appendString(std::vector<uint64_t>& key, const std::string& text)
+        {
+            appendBytes(key, text.data(), text.size());
+        }
+
+        // the constant values are part of the pipeline, the same shader with another value is another pipeline
+        void appendSpecialization(std::vector<uint64_t>& key, const std::optional<VanKSpecializationInfo>& info)
+        {
+            if (!info)
+            {
+                key.insert(key.end(), { 0, 0 });
+                return;
+            }
+            key.push_back(info->MapEntries.size());
+            for (const VanKSpecializationMapEntries& entry : info->MapEntries)
+            {
+                key.insert(key.end(), { entry.constantID, entry.offset, entry.size });
+            }
+            appendBytes(key, info->getData(), info->dataSize());
+        }
+
+        void appendPushConstantRanges(std::vector<uint64_t>& key, const std::vector<VanKPushConstantRange>& ranges)
+        {
+            key.push_back(ranges.size());
+            for (const VanKPushConstantRange& range : ranges)
+            {
+                key.insert(key.end(), { range.stageFlags, range.offset, range.size });
+            }
+        }
+
+        uint64_t floatBits(float value)
+        {
+            uint32_t bits = 0;
+            std::memcpy(&bits, &value, sizeof(bits));
+            return bits;
+        }
+    }
+
     VulkanRendererAPI::VulkanRendererAPI() = default;
 
     VulkanRendererAPI::VulkanRendererAPI(const Config& config) : window(config.window)
     {
         // Set this instance as the static instance
         s_instance = this;
+        m_FramesInFlight = std::clamp(config.framesInFlight, 1u, MAX_FRAMES_IN_FLIGHT);
+        m_Headless = config.headless;
+        if (m_Headless)
+        {
+            m_HeadlessExtent = vk::Extent2D{config.headlessExtent.width, config.headlessExtent.height};
+            m_PresentLayout = vk::ImageLayout::eTransferSrcOptimal;
+            // nothing is presented, a device without the swapchain extension (or a surface) will do
+            std::erase_if(requiredDeviceExtension, [](const char* extension) { return strcmp(extension, vk::KHRSwapchainExtensionName) == 0; });
+        }
 
         init();
     }
@@ -42,6 +117,7 @@ namespace  VanK
             s_instance = nullptr;
         }
         device.waitIdle();
+        m_UploadContext.reset();
         DestroyAllPipelines();// todo idk where to put this will see
         cleanup();
     }
@@ -61,7 +137,8 @@ namespace  VanK
     {
         createInstance();
         setupDebugMessenger();
-        createSurface();
+        if (!m_Headless)
+            createSurface();
         pickPhysicalDevice();
         createLogicalDevice();
         createDynamicDispatcher();
@@ -82,12 +159,14 @@ namespace  VanK
         createColorResources();
         createDepthResources();
         m_samplerPool.init(device);
+        m_LayoutCache = std::make_unique<VulkanLayoutCache>(device);
         createTexture();
         createTextureSampler();
         createDescriptorPool();
         createDescriptorSets();
         createCommandBuffers();
         createSyncObjects();
+        m_UploadContext = std::make_unique<VulkanUploadContext>(device, queue, queueIndex, allocator);
 
         //statistics not important
         createQueryPool();
@@ -100,7 +179,9 @@ namespace  VanK
         ImGui::CreateContext();
         ImGui::StyleColorsDark();
 
-        ImGui_ImplSDL3_InitForVulkan(window);
+        // headless has no platform backend, ImGui only needs a display size then
+        if (!m_Headless)
+            ImGui_ImplSDL3_InitForVulkan(window);
         static VkFormat imageFormats[] = {static_cast<VkFormat>(swapChainSurfaceFormat.format)};
         ImGui_ImplVulkan_InitInfo initInfo = {
             .Instance = *instance,
@@ -123,10 +204,15 @@ namespace  VanK
         ImGui_ImplVulkan_Init(&initInfo);
 
         ImGui::GetIO().ConfigFlags = ImGuiConfigFlags_DockingEnable | ImGuiConfigFlags_ViewportsEnable;
+        if (m_Headless)
+        {
+            ImGui::GetIO().ConfigFlags &= ~ImGuiConfigFlags_ViewportsEnable;
+            ImGui::GetIO().DisplaySize = ImVec2(static_cast<float>(swapChainExtent.width), static_cast<float>(swapChainExtent.height));
+        }
 
         // Descriptor Set for ImGUI
         uiDescriptorSet.resize(1);
-        if ((ImGui::GetCurrentContext() != nullptr) && ImGui::GetIO().BackendPlatformUserData != nullptr)
+        if ((ImGui::GetCurrentContext() != nullptr) && ImGui::GetIO().BackendRendererUserData != nullptr)
         {
             for (size_t d = 0; d < 1; ++d) // this is how many color attachments i have for now only color
             {
@@ -142,6 +228,8 @@ namespace  VanK
         swapChainImages.clear();
         swapChainImageViews.clear();
         swapChain = nullptr;
+        m_HeadlessImages.clear();
+        m_HeadlessImageMemory.clear();
     }
 
     void VulkanRendererAPI::cleanup()
@@ -151,7 +239,8 @@ namespace  VanK
         allocator.deinit();
 
         ImGui_ImplVulkan_Shutdown();
-        ImGui_ImplSDL3_Shutdown();
+        if (!m_Headless)
+            ImGui_ImplSDL3_Shutdown();
         ImGui::DestroyContext();
     }
 
@@ -162,6 +251,12 @@ namespace  VanK
         cleanupSwapChain();
         createSwapChain();
         createImageViews();
+        // the new swapchain may have a different number of images
+        if (renderFinishedSemaphores.size() != swapChainImages.size())
+            createRenderFinishedSemaphores();
+        // present ids belong to the old swapchain, frames still waiting on theirs fall back to the frame timeline
+        for (FrameTimingSlot& slot : m_FrameTimings)
+            slot.Presented = false;
     }
     
     void VulkanRendererAPI::recreateImages()
@@ -174,13 +269,28 @@ namespace  VanK
         createDepthResources();//depth
         sceneImageInitialized = false;
 
-        // Recreate the ImGui texture to point to the new sceneImageView
+        // Point the ImGui texture at the new sceneImageView. The descriptor set is rewritten rather than replaced, so
+        // the ImTextureID stays valid in UI built before the resize (the render thread may still have some queued).
+        // The device is idle, nothing reads the set right now.
         if (!uiDescriptorSet.empty() && uiDescriptorSet[0] != nullptr)
         {
-            ImGui_ImplVulkan_RemoveTexture(uiDescriptorSet[0]);
-            uiDescriptorSet[0] = nullptr;
+            const vk::DescriptorImageInfo imageInfo
+            {
+                .sampler = *linearSampler,
+                .imageView = *sceneImageView,
+                .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal
+            };
+            const vk::WriteDescriptorSet write
+            {
+                .dstSet = vk::DescriptorSet(uiDescriptorSet[0]),
+                .dstBinding = 0, // ImGui's texture set layout is a single combined image sampler
+                .descriptorCount = 1,
+                .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+                .pImageInfo = &imageInfo
+            };
+            device.updateDescriptorSets(write, {});
         }
-        if ((ImGui::GetCurrentContext() != nullptr) && ImGui::GetIO().BackendPlatformUserData != nullptr)
+        else if ((ImGui::GetCurrentContext() != nullptr) && ImGui::GetIO().BackendRendererUserData != nullptr)
         {
             uiDescriptorSet.resize(1);
             uiDescriptorSet[0] = ImGui_ImplVulkan_AddTexture(
@@ -345,7 +455,7 @@ namespace  VanK
         {
             if ((queueFamilyProperties[qfpIndex].queueFlags & vk::QueueFlagBits::eGraphics &&
                 queueFamilyProperties[qfpIndex].queueFlags & vk::QueueFlagBits::eCompute) &&
-                physicalDevice.getSurfaceSupportKHR(qfpIndex, *surface))
+                (m_Headless || physicalDevice.getSurfaceSupportKHR(qfpIndex, *surface)))
             {
                 // found a queue family that supports both graphics and present
                 queueIndex = qfpIndex;
@@ -357,6 +467,29 @@ namespace  VanK
             throw std::runtime_error("Could not find a queue for graphics and present -> terminating");
         }
 
+        // present id and present wait are optional, without them the low latency mode waits for the GPU instead
+        std::vector<const char*> enabledExtensions = requiredDeviceExtension;
+        auto availableExtensions = physicalDevice.enumerateDeviceExtensionProperties();
+        auto hasExtension = [&availableExtensions](const char* name)
+        {
+            return std::ranges::any_of(availableExtensions, [name](const vk::ExtensionProperties& extension)
+            {
+                return strcmp(extension.extensionName, name) == 0;
+            });
+        };
+        if (!m_Headless && hasExtension(vk::KHRPresentIdExtensionName) && hasExtension(vk::KHRPresentWaitExtensionName))
+        {
+            auto presentFeatures = physicalDevice.getFeatures2
+            <
+                vk::PhysicalDeviceFeatures2, vk::PhysicalDevicePresentIdFeaturesKHR, vk::PhysicalDevicePresentWaitFeaturesKHR
+            >();
+            m_PresentWaitSupported = presentFeatures.get<vk::PhysicalDevicePresentIdFeaturesKHR>().presentId &&
+                presentFeatures.get<vk::PhysicalDevicePresentWaitFeaturesKHR>().presentWait;
+        }
+
+        // optional, without it the scene is recorded on the primary, see IsParallelRecordingSupported
+        m_InheritedQueriesSupported = physicalDevice.getFeatures().inheritedQueries;
+
         // query for Vulkan 1.3 features
         vk::StructureChain
         <
@@ -365,11 +498,13 @@ namespace  VanK
             vk::PhysicalDeviceVulkan12Features,
             vk::PhysicalDeviceVulkan13Features,
             vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT,
-            vk::PhysicalDeviceMaintenance5Features
+            vk::PhysicalDeviceMaintenance5Features,
+            vk::PhysicalDevicePresentIdFeaturesKHR,
+            vk::PhysicalDevicePresentWaitFeaturesKHR
         >
         featureChain =
         {
-            {.features = {.sampleRateShading = true, .samplerAnisotropy = true, .pipelineStatisticsQuery = true, .shaderInt64 = true}}, // vk::PhysicalDeviceFeatures2
+            {.features = {.sampleRateShading = true, .multiDrawIndirect = true, .drawIndirectFirstInstance = true, .samplerAnisotropy = true, .pipelineStatisticsQuery = true, .shaderInt64 = true, .inheritedQueries = m_InheritedQueriesSupported}}, // vk::PhysicalDeviceFeatures2
             {.shaderDrawParameters = true},
             {
                 .drawIndirectCount = true,
@@ -387,7 +522,19 @@ namespace  VanK
             {.synchronization2 = true, .dynamicRendering = true}, // vk::PhysicalDeviceVulkan13Features
             {.extendedDynamicState = true}, // vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT
             {.maintenance5 = true},
+            {.presentId = true},
+            {.presentWait = true}
         };
+        if (m_PresentWaitSupported)
+        {
+            enabledExtensions.push_back(vk::KHRPresentIdExtensionName);
+            enabledExtensions.push_back(vk::KHRPresentWaitExtensionName);
+        }
+        else
+        {
+            featureChain.unlink<vk::PhysicalDevicePresentIdFeaturesKHR>();
+            featureChain.unlink<vk::PhysicalDevicePresentWaitFeaturesKHR>();
+        }
 
         // create a Device
         float queuePriority = 0.0f;
@@ -398,8 +545,8 @@ namespace  VanK
             .pNext = &featureChain.get(),
             .queueCreateInfoCount = 1,
             .pQueueCreateInfos = &deviceQueueCreateInfo,
-            .enabledExtensionCount = static_cast<uint32_t>(requiredDeviceExtension.size()),
-            .ppEnabledExtensionNames = requiredDeviceExtension.data()
+            .enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size()),
+            .ppEnabledExtensionNames = enabledExtensions.data()
         };
 
         device = vk::raii::Device(physicalDevice, deviceCreateInfo);
@@ -423,6 +570,12 @@ namespace  VanK
 
     void VulkanRendererAPI::createSwapChain()
     {
+        if (m_Headless)
+        {
+            createHeadlessTargets();
+            return;
+        }
+
         auto surfaceCapabilities = physicalDevice.getSurfaceCapabilitiesKHR(*surface);
         swapChainExtent = chooseSwapExtent(surfaceCapabilities);
         
@@ -449,6 +602,26 @@ namespace  VanK
     }
 
     //change this ? from chapter image view
+    void VulkanRendererAPI::createHeadlessTargets()
+    {
+        swapChainExtent = m_HeadlessExtent;
+        swapChainSurfaceFormat = vk::SurfaceFormatKHR{vk::Format::eB8G8R8A8Srgb, vk::ColorSpaceKHR::eSrgbNonlinear};
+
+        // one target per frame slot, BeginFrame hands out the one of the current frame
+        for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        {
+            vk::raii::Image image = nullptr;
+            vk::raii::DeviceMemory imageMemory = nullptr;
+            createImage(swapChainExtent.width, swapChainExtent.height, 1, vk::SampleCountFlagBits::e1, swapChainSurfaceFormat.format,
+                        vk::ImageTiling::eOptimal,
+                        vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eTransferSrc,
+                        vk::MemoryPropertyFlagBits::eDeviceLocal, image, imageMemory);
+            swapChainImages.push_back(*image);
+            m_HeadlessImages.push_back(std::move(image));
+            m_HeadlessImageMemory.push_back(std::move(imageMemory));
+        }
+    }
+
     void VulkanRendererAPI::createImageViews()
     {
         assert(swapChainImageViews.empty());
@@ -543,30 +716,119 @@ namespace  VanK
         VK_CORE_INFO("Removed texture at index %u, remaining textures: %zu", index, images.size());
     }
 
-    VanKPipeLine VulkanRendererAPI::createGraphicsPipeline(VanKGraphicsPipelineSpecification pipelineSpecification)
+    VanKPipeLine VulkanRendererAPI::createGraphicsPipeline(const VanKGraphicsPipelineSpecification& pipelineSpecification)
+    {
+        // Same shader and same state as a live pipeline, hand that one out again
+        std::vector<uint64_t> stateKey = graphicsPipelineStateKey(pipelineSpecification);
+        if (VanKPipeLine cached = findCachedPipeline(stateKey); cached.IsValid())
+            return cached;
+
+        return addPipeline(buildGraphicsPipeline(pipelineSpecification), std::move(stateKey));
+    }
+
+    std::vector<uint64_t> VulkanRendererAPI::graphicsPipelineStateKey(const VanKGraphicsPipelineSpecification& pipelineSpecification)
+    {
+        auto vkShader = dynamic_cast<VulkanShader*>(pipelineSpecification.ShaderStageCreateInfo.VanKShader);
+        const vk::SampleCountFlagBits rasterizationSamples = pipelineSpecification.MultisampleStateCreateInfo.sampleCount == VanK_SAMPLE_COUNT_1_BIT ? vk::SampleCountFlagBits::e1 : msaaSamples;
+
+        std::vector<uint64_t> stateKey = { static_cast<uint64_t>(VanKPipelineBindPoint::Graphics), vkShader->GetModuleId() };
+        appendString(stateKey, vkShader->GetShaderEntryName(vk::ShaderStageFlagBits::eVertex));
+        appendString(stateKey, vkShader->GetShaderEntryName(vk::ShaderStageFlagBits::eFragment));
+        appendSpecialization(stateKey, pipelineSpecification.ShaderStageCreateInfo.specializationInfo);
+        const BufferLayout& vertexLayout = pipelineSpecification.VertexInputStateCreateInfo.VanKBufferLayout;
+        stateKey.insert(stateKey.end(), { vertexLayout.GetStride(), vertexLayout.GetElements().size() });
+        for (const BufferElement& element : vertexLayout.GetElements())
+        {
+            stateKey.insert(stateKey.end(), { static_cast<uint64_t>(element.Type), element.Offset, element.Normalized });
+        }
+        stateKey.insert(stateKey.end(),
+        {
+            static_cast<uint64_t>(pipelineSpecification.InputAssemblyStateCreateInfo.VanKPrimitive),
+            static_cast<uint64_t>(pipelineSpecification.RasterizationStateCreateInfo.VanKPolygon),
+            static_cast<uint64_t>(pipelineSpecification.RasterizationStateCreateInfo.VanKCullMode),
+            static_cast<uint64_t>(pipelineSpecification.RasterizationStateCreateInfo.VanKFrontFace),
+            pipelineSpecification.ColorBlendStateCreateInfo.logicOp,
+            static_cast<uint64_t>(pipelineSpecification.ColorBlendStateCreateInfo.VanKLogicOp),
+            pipelineSpecification.ColorBlendStateCreateInfo.VanKColorBlendAttachmentState.size()
+        });
+        for (const VanKPipelineColorBlendAttachmentState& attachment : pipelineSpecification.ColorBlendStateCreateInfo.VanKColorBlendAttachmentState)
+        {
+            stateKey.insert(stateKey.end(),
+            {
+                attachment.blendEnable,
+                static_cast<uint64_t>(attachment.srcColorBlendFactor),
+                static_cast<uint64_t>(attachment.dstColorBlendFactor),
+                static_cast<uint64_t>(attachment.colorBlendOp),
+                static_cast<uint64_t>(attachment.srcAlphaBlendFactor),
+                static_cast<uint64_t>(attachment.dstAlphaBlendFactor),
+                static_cast<uint64_t>(attachment.alphaBlendOp),
+                attachment.colorWriteMask
+            });
+        }
+        stateKey.insert(stateKey.end(),
+        {
+            static_cast<uint64_t>(rasterizationSamples),
+            pipelineSpecification.MultisampleStateCreateInfo.sampleShadingEnable,
+            floatBits(pipelineSpecification.MultisampleStateCreateInfo.minSampleShading),
+            pipelineSpecification.DepthStateInfo.depthTestEnable,
+            pipelineSpecification.DepthStateInfo.depthWriteEnable,
+            static_cast<uint64_t>(pipelineSpecification.DepthStateInfo.VanKdepthCompareOp),
+            static_cast<uint64_t>(findDepthFormat()),
+            pipelineSpecification.RenderingCreateInfo.VanKColorAttachmentFormats.size()
+        });
+        for (VanKFormat format : pipelineSpecification.RenderingCreateInfo.VanKColorAttachmentFormats)
+        {
+            stateKey.push_back(static_cast<uint64_t>(format));
+        }
+        appendPushConstantRanges(stateKey, pipelineSpecification.PushConstantRanges);
+        return stateKey;
+    }
+
+    VulkanRendererAPI::PipelineResource VulkanRendererAPI::buildGraphicsPipeline(const VanKGraphicsPipelineSpecification& pipelineSpecification)
     {
         vk::raii::Pipeline tempPipeline = VK_NULL_HANDLE;
-        vk::raii::PipelineLayout tempPipelineLayout = VK_NULL_HANDLE;
         
         auto specShader = pipelineSpecification.ShaderStageCreateInfo.VanKShader;
         auto vkShader = dynamic_cast<VulkanShader*>(specShader);
         
         std::string vertShaderEntryName = vkShader->GetShaderEntryName(vk::ShaderStageFlagBits::eVertex);
         std::string fragShaderEntryName = vkShader->GetShaderEntryName(vk::ShaderStageFlagBits::eFragment);
+        const vk::SampleCountFlagBits rasterizationSamples = pipelineSpecification.MultisampleStateCreateInfo.sampleCount == VanK_SAMPLE_COUNT_1_BIT ? vk::SampleCountFlagBits::e1 : msaaSamples;
+        const vk::Format depthFormat = findDepthFormat();
+
         auto& vertShaderModule = vkShader->GetShaderModule(vk::ShaderStageFlagBits::eVertex);
         auto& fragShaderModule = vkShader->GetShaderModule(vk::ShaderStageFlagBits::eFragment);
 
+        // both stages get the same constants, a stage ignores the ids its module doesn't declare
+        std::vector<vk::SpecializationMapEntry> specializationEntries;
+        vk::SpecializationInfo specializationInfo{};
+        const vk::SpecializationInfo* stageSpecialization = nullptr;
+        if (const auto& info = pipelineSpecification.ShaderStageCreateInfo.specializationInfo; info && info->mapEntryCount() > 0)
+        {
+            for (const VanKSpecializationMapEntries& entry : info->MapEntries)
+            {
+                specializationEntries.push_back({ .constantID = entry.constantID, .offset = entry.offset, .size = entry.size });
+            }
+            specializationInfo.mapEntryCount = static_cast<uint32_t>(specializationEntries.size());
+            specializationInfo.pMapEntries = specializationEntries.data();
+            specializationInfo.dataSize = info->dataSize();
+            specializationInfo.pData = info->getData();
+            stageSpecialization = &specializationInfo;
+        }
+
         vk::PipelineShaderStageCreateInfo vertShaderStageInfo
         {
             .stage = vk::ShaderStageFlagBits::eVertex,
             .module = vertShaderModule,
-            .pName = vertShaderEntryName.c_str()
+            .pName = vertShaderEntryName.c_str(),
+            .pSpecializationInfo = stageSpecialization
         };
         vk::PipelineShaderStageCreateInfo fragShaderStageInfo
         {
             .stage = vk::ShaderStageFlagBits::eFragment,
             .module = fragShaderModule,
             .pName = fragShaderEntryName.c_str(),
+            .pSpecializationInfo = stageSpecialization
         };
         
         vk::PipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
@@ -621,7 +883,7 @@ namespace  VanK
         rasterizer.lineWidth = 1.0f; // dont needed dynamic now
         vk::PipelineMultisampleStateCreateInfo multisampling // todo expose this as api
         {
-            .rasterizationSamples = pipelineSpecification.MultisampleStateCreateInfo.sampleCount == VanK_SAMPLE_COUNT_1_BIT ? vk::SampleCountFlagBits::e1 : msaaSamples,
+            .rasterizationSamples = rasterizationSamples,
             .sampleShadingEnable = pipelineSpecification.MultisampleStateCreateInfo.sampleShadingEnable,
             .minSampleShading = pipelineSpecification.MultisampleStateCreateInfo.minSampleShading, // min fraction for sample shading; closer to one is smoother
         };
@@ -679,21 +941,12 @@ namespace  VanK
             .dynamicStateCount = static_cast<uint32_t>(dynamicStates.size()), .pDynamicStates = dynamicStates.data()
         };
 
-        std::array<vk::DescriptorSetLayout, 2> setLayouts =
-        {
-            *descriptorSetLayout,
-            *commonDescriptorSetLayout
-        };
-
-        vk::PipelineLayoutCreateInfo pipelineLayoutInfo
-        {
-            .setLayoutCount = setLayouts.size(),
-            .pSetLayouts = setLayouts.data(),
-            .pushConstantRangeCount = 0
-        };
-
-        tempPipelineLayout = vk::raii::PipelineLayout(device, pipelineLayoutInfo);
-        DBG_VK_NAME(*tempPipelineLayout);
+        // pipelines with the same sets and push constant ranges share one layout
+        auto pipelineLayout = m_LayoutCache->AcquirePipelineLayout
+        ({
+            .SetLayouts = { descriptorSetLayout, commonDescriptorSetLayout },
+            .PushConstantRanges = ConvertPushConstantRanges(pipelineSpecification.PushConstantRanges)
+        });
         
         // Dynamic rendering: provide what the pipeline will render to
         std::vector<vk::Format> colorFormats;
@@ -706,7 +959,7 @@ namespace  VanK
         {
             .colorAttachmentCount = static_cast<uint32_t>(colorFormats.size()),
             .pColorAttachmentFormats = colorFormats.data(), // &swapChainSurfaceFormat.format
-            .depthAttachmentFormat = findDepthFormat()
+            .depthAttachmentFormat = depthFormat
         };
         
         vk::GraphicsPipelineCreateInfo pipelineInfo
@@ -722,7 +975,7 @@ namespace  VanK
             .pDepthStencilState = &depthStencil,
             .pColorBlendState = &colorBlending,
             .pDynamicState = &dynamicState,
-            .layout = tempPipelineLayout,
+            .layout = **pipelineLayout,
             .renderPass = nullptr
         };
 
@@ -731,33 +984,40 @@ namespace  VanK
         
         PipelineResource resource;
         resource.pipeline = std::move(tempPipeline);
-        resource.layout = std::move(tempPipelineLayout);
+        resource.layout = std::move(pipelineLayout);
         resource.bindPoint = VanKPipelineBindPoint::Graphics;
         resource.spec = pipelineSpecification;
 
-        auto rawHandle = *resource.pipeline; // raw VkPipeline before moving
-        m_currentGraphicPipelineLayout = *resource.layout;
-        m_PipelineResources.emplace(rawHandle, std::move(resource));
-        
-        return Wrap(rawHandle);
+        return resource;
     }
 
-    VanKPipeLine VulkanRendererAPI::createComputeShaderPipeline(VanKComputePipelineSpecification computePipelineSpecification)
+    VanKPipeLine VulkanRendererAPI::createComputeShaderPipeline(const VanKComputePipelineSpecification& computePipelineSpecification)
+    {
+        std::vector<uint64_t> stateKey = computePipelineStateKey(computePipelineSpecification);
+        if (VanKPipeLine cached = findCachedPipeline(stateKey); cached.IsValid())
+            return cached;
+
+        return addPipeline(buildComputePipeline(computePipelineSpecification), std::move(stateKey));
+    }
+
+    std::vector<uint64_t> VulkanRendererAPI::computePipelineStateKey(const VanKComputePipelineSpecification& computePipelineSpecification)
+    {
+        auto specShader = dynamic_cast<VulkanShader*>(computePipelineSpecification.ComputePipelineCreateInfo.VanKShader);
+
+        std::vector<uint64_t> stateKey = { static_cast<uint64_t>(VanKPipelineBindPoint::Compute), specShader->GetModuleId() };
+        appendString(stateKey, specShader->GetShaderEntryName(vk::ShaderStageFlagBits::eCompute));
+        appendPushConstantRanges(stateKey, computePipelineSpecification.PushConstantRanges);
+        return stateKey;
+    }
+
+    VulkanRendererAPI::PipelineResource VulkanRendererAPI::buildComputePipeline(const VanKComputePipelineSpecification& computePipelineSpecification)
     {
         vk::raii::Pipeline tempPipeline = VK_NULL_HANDLE;
-        vk::raii::PipelineLayout tempPipelineLayout = VK_NULL_HANDLE;
         
         auto specShader = dynamic_cast<VulkanShader*>(computePipelineSpecification.ComputePipelineCreateInfo.VanKShader);
         std::string computeEntryName = specShader->GetShaderEntryName(vk::ShaderStageFlagBits::eCompute);
-        auto& compute = specShader->GetShaderModule(vk::ShaderStageFlagBits::eCompute);
 
-        // Create the pipeline layout used by the compute shader
-        /*
-        const std::array<VkPushConstantRange, 1> pushRanges =
-        {
-            {{.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT, .offset = 0, .size = sizeof(shaderio::PushConstantCompute)}}
-        };
-        */
+        auto& compute = specShader->GetShaderModule(vk::ShaderStageFlagBits::eCompute);
 
         vk::PipelineShaderStageCreateInfo computeShaderStageInfo
         {
@@ -766,49 +1026,146 @@ namespace  VanK
             .pName = computeEntryName.c_str()
         };
 
-        const std::array<vk::DescriptorSetLayout, 2> computeDescriptorSetLayouts =
-        {
-            descriptorSetLayout,
-            commonDescriptorSetLayout // <-- This is your new, shared layout
-        };
-
-        // The pipeline layout is used to pass data to the pipeline, anything with "layout" in the shader
-        const vk::PipelineLayoutCreateInfo pipelineLayoutInfo
-        {
-            .setLayoutCount = uint32_t(computeDescriptorSetLayouts.size()),
-            .pSetLayouts = computeDescriptorSetLayouts.data(),
-            /*.pushConstantRangeCount = uint32_t(pushRanges.size()),
-            .pPushConstantRanges = pushRanges.data(),*/
-        };
-        tempPipelineLayout = vk::raii::PipelineLayout( device, pipelineLayoutInfo );
-        DBG_VK_NAME(*tempPipelineLayout);
+        // The pipeline layout is used to pass data to the pipeline, anything with "layout" in the shader.
+        // Same sets as the graphics pipelines, so without push constants both share one layout.
+        auto pipelineLayout = m_LayoutCache->AcquirePipelineLayout
+        ({
+            .SetLayouts = { descriptorSetLayout, commonDescriptorSetLayout },
+            .PushConstantRanges = ConvertPushConstantRanges(computePipelineSpecification.PushConstantRanges)
+        });
 
         // Creating the pipeline to run the compute shader
         vk::ComputePipelineCreateInfo pipelineInfo
         {
             .stage = computeShaderStageInfo,
-            .layout = tempPipelineLayout
+            .layout = **pipelineLayout
         };
         tempPipeline = vk::raii::Pipeline( device, nullptr, pipelineInfo );
         DBG_VK_NAME(*tempPipeline);
         
         PipelineResource resource;
         resource.pipeline = std::move(tempPipeline);
-        resource.layout = std::move(tempPipelineLayout);
+        resource.layout = std::move(pipelineLayout);
         resource.bindPoint = VanKPipelineBindPoint::Compute;
         resource.computeSpec = computePipelineSpecification;
 
-        auto rawHandle = *resource.pipeline; // raw VkPipeline before moving
-        m_currentComputePipelineLayout = *resource.layout;
-        m_PipelineResources.emplace(rawHandle, std::move(resource));
+        return resource;
+    }
+
+    VanKPipeLine VulkanRendererAPI::findCachedPipeline(const std::vector<uint64_t>& stateKey)
+    {
+        auto cached = m_PipelineByState.find(stateKey);
+        if (cached == m_PipelineByState.end())
+        {
+            m_PipelineCacheMisses++;
+            return {};
+        }
+
+        PipelineResource& resource = m_Pipelines[cached->second];
+        resource.refCount++;
+        m_PipelineCacheHits++;
+
+        // same side effect as creating it
+        if (resource.bindPoint == VanKPipelineBindPoint::Graphics)
+            m_currentGraphicPipelineLayout = **resource.layout;
+        else
+            m_currentComputePipelineLayout = **resource.layout;
+        return { cached->second, resource.generation };
+    }
+
+    VanKPipeLine VulkanRendererAPI::addPipeline(PipelineResource&& resource, std::vector<uint64_t>&& stateKey)
+    {
+        uint32_t index;
+        if (!m_FreePipelineSlots.empty())
+        {
+            index = m_FreePipelineSlots.back();
+            m_FreePipelineSlots.pop_back();
+        }
+        else
+        {
+            index = static_cast<uint32_t>(m_Pipelines.size());
+            m_Pipelines.emplace_back();
+        }
+
+        PipelineResource& slot = m_Pipelines[index];
+        const uint32_t generation = slot.generation;
+        slot = std::move(resource);
+        slot.generation = generation;
+        slot.alive = true;
+        slot.refCount = 1;
+        slot.stateKey = stateKey;
+        m_PipelineByState.emplace(std::move(stateKey), index);
+        m_PipelineCount++;
+
+        if (slot.bindPoint == VanKPipelineBindPoint::Graphics)
+            m_currentGraphicPipelineLayout = **slot.layout;
+        else
+            m_currentComputePipelineLayout = **slot.layout;
+        return { index, generation };
+    }
+
+    void VulkanRendererAPI::replacePipeline(PipelineResource& slot, PipelineResource&& resource, std::vector<uint64_t>&& stateKey)
+    {
+        const uint32_t index = static_cast<uint32_t>(&slot - m_Pipelines.data());
+        if (auto cached = m_PipelineByState.find(slot.stateKey); cached != m_PipelineByState.end() && cached->second == index)
+            m_PipelineByState.erase(cached);
 
-        return Wrap(rawHandle);
+        // everyone holding the handle, creators deduplicated into this slot included, gets the new pipeline
+        slot.pipeline = std::move(resource.pipeline);
+        slot.layout = std::move(resource.layout);
+        slot.spec = std::move(resource.spec);
+        slot.computeSpec = std::move(resource.computeSpec);
+        slot.stateKey = stateKey;
+        m_PipelineByState.emplace(std::move(stateKey), index); // keeps an existing slot with the same state
+    }
+
+    bool VulkanRendererAPI::ReloadPipeline(VanKPipeLine pipeline, const VanKGraphicsPipelineSpecification& pipelineSpecification)
+    {
+        PipelineResource* slot = tryGetPipeline(pipeline);
+        if (!slot || slot->bindPoint != VanKPipelineBindPoint::Graphics)
+        {
+            VK_CORE_ERROR("ReloadPipeline: not a live graphics pipeline");
+            return false;
+        }
+
+        replacePipeline(*slot, buildGraphicsPipeline(pipelineSpecification), graphicsPipelineStateKey(pipelineSpecification));
+        return true;
+    }
+
+    bool VulkanRendererAPI::ReloadPipeline(VanKPipeLine pipeline, const VanKComputePipelineSpecification& computePipelineSpecification)
+    {
+        PipelineResource* slot = tryGetPipeline(pipeline);
+        if (!slot || slot->bindPoint != VanKPipelineBindPoint::Compute)
+        {
+            VK_CORE_ERROR("ReloadPipeline: not a live compute pipeline");
+            return false;
+        }
+
+        replacePipeline(*slot, buildComputePipeline(computePipelineSpecification), computePipelineStateKey(computePipelineSpecification));
+        return true;
     }
 
     void VulkanRendererAPI::DestroyAllPipelines()
     {
-        // Clear the map completely
-        m_PipelineResources.clear();
+        // Release every live slot, the generations survive so old handles stay detectable
+        for (uint32_t index = 0; index < m_Pipelines.size(); index++)
+        {
+            if (!m_Pipelines[index].alive)
+                continue;
+            m_Pipelines[index].refCount = 1;
+            DestroyPipeline({ index, m_Pipelines[index].generation });
+        }
+        m_PipelineByState.clear();
+    }
+
+    VanKPipelineCacheStats VulkanRendererAPI::GetPipelineCacheStats() const
+    {
+        return { m_PipelineCacheHits, m_PipelineCacheMisses, m_PipelineCount };
+    }
+
+    VanKCommandStats VulkanRendererAPI::GetCommandStats() const
+    {
+        return m_LastCommandStats;
     }
 
     /*--
@@ -817,8 +1174,7 @@ namespace  VanK
 
     void VulkanRendererAPI::DestroyPipeline(VanKPipeLine pipeline)
     {
-        auto it = m_PipelineResources.find(Unwrap(pipeline));
-        if (it != m_PipelineResources.end())
+        if (PipelineResource* resource = tryGetPipeline(pipeline))
         {
             // not needed because of RAII
             /*if (it->second.pipeline != VK_NULL_HANDLE)
@@ -832,7 +1188,18 @@ namespace  VanK
                 it->second.layout = VK_NULL_HANDLE;
             }*/
 
-            m_PipelineResources.erase(it);
+            // still handed out to another creator with the same state
+            if (--resource->refCount > 0)
+                return;
+
+            if (auto cached = m_PipelineByState.find(resource->stateKey); cached != m_PipelineByState.end() && cached->second == pipeline.Index)
+                m_PipelineByState.erase(cached);
+
+            const uint32_t generation = resource->generation + 1;
+            *resource = PipelineResource{};
+            resource->generation = generation;
+            m_FreePipelineSlots.push_back(pipeline.Index);
+            m_PipelineCount--;
         }
     }
 
@@ -842,24 +1209,51 @@ namespace  VanK
         
         commandBuffers[currentFrame].begin({});
 
+        // BeginFrame waited for the last frame that used these, the secondaries recorded for it are done
+        for (uint32_t thread = 0; thread < m_RecordingThreadCount; thread++)
+        {
+            RecordingPool& recordingPool = m_RecordingPools[currentFrame * m_RecordingThreadCount + thread];
+            recordingPool.Pool.reset();
+            recordingPool.Used = 0;
+        }
+
+        // StorageBuffer::Upload() calls since the last frame, copied before anything in this frame reads them
+        m_UploadContext->BeginFrame(commandBuffers[currentFrame]);
+
         //statistics
         commandBuffers[currentFrame].resetQueryPool(queryPool, 0, 1);
         commandBuffers[currentFrame].beginQuery(queryPool, 0);
         
-        auto cmd = new VanKCommandBuffer_T{&commandBuffers[currentFrame]};
+        // the wrapper is reused every frame, this also clears the bound state of the last recording
+        VanKCommandBuffer_T& cmd = m_FrameCommandBuffers[currentFrame];
+        cmd = { .handle = &commandBuffers[currentFrame] };
         
-        return cmd;
+        return &cmd;
     }
     
     void VulkanRendererAPI::EndCommandBuffer(VanKCommandBuffer cmd)
     {
         Unwrap(cmd).endQuery(queryPool, 0);
         Unwrap(cmd).end();
+
+        m_LastCommandStats = { cmd->state.Issued, cmd->state.Filtered };
     }
 
     void VulkanRendererAPI::BeginFrame()
     {
-        while (vk::Result::eTimeout == device.waitForFences(*inFlightFences[currentFrame], vk::True, UINT64_MAX));
+        // the frame that used this frame's resources last has to be done with them, the ones after it may still run
+        if (frameNumber >= m_FramesInFlight)
+            waitForFrame(frameNumber + 1 - m_FramesInFlight);
+        updateFrameTimings();
+
+        if (m_Headless)
+        {
+            // the target of this frame slot, the wait above made sure the frame that used it last is done
+            currentImageIndex = currentFrame;
+            currentResult = vk::Result::eSuccess;
+            return;
+        }
+
         auto [result, imageIndex] = swapChain.acquireNextImage(UINT64_MAX, *presentCompleteSemaphores[currentFrame],
                                                                nullptr);
 
@@ -877,25 +1271,66 @@ namespace  VanK
         {
             throw std::runtime_error("failed to acquire swap chain image!");
         }
-        
-        device.resetFences(*inFlightFences[currentFrame]);
     }
 
     void VulkanRendererAPI::EndFrame()
     {
-        vk::PipelineStageFlags waitDestinationStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput);
-        const vk::SubmitInfo submitInfo{
-            .waitSemaphoreCount = 1,
-            .pWaitSemaphores = &*presentCompleteSemaphores[currentFrame],
-            .pWaitDstStageMask = &waitDestinationStageMask,
-            .commandBufferCount = 1,
-            .pCommandBuffers = &*commandBuffers[currentFrame],
-            .signalSemaphoreCount = 1,
-            .pSignalSemaphores = &*renderFinishedSemaphores[currentImageIndex]
+        // uploads recorded inline retire when this submit signals their timeline value
+        const uint64_t uploadSignalValue = m_UploadContext->TakeFrameSignalValue();
+        const vk::SemaphoreSubmitInfo waitInfo
+        {
+            .semaphore = *presentCompleteSemaphores[currentFrame],
+            .stageMask = vk::PipelineStageFlagBits2::eColorAttachmentOutput
+        };
+        // headless has no image to acquire and no present waiting on the frame
+        std::array<vk::SemaphoreSubmitInfo, 3> signalInfos;
+        uint32_t signalCount = 0;
+        if (!m_Headless)
+            signalInfos[signalCount++] = { .semaphore = *renderFinishedSemaphores[currentImageIndex], .stageMask = vk::PipelineStageFlagBits2::eAllCommands };
+        signalInfos[signalCount++] = { .semaphore = *m_FrameTimeline, .value = GetRecordingFrame(), .stageMask = vk::PipelineStageFlagBits2::eAllCommands };
+        if (uploadSignalValue != 0)
+            signalInfos[signalCount++] = { .semaphore = m_UploadContext->GetTimelineSemaphore(), .value = uploadSignalValue, .stageMask = vk::PipelineStageFlagBits2::eAllCommands };
+        // the secondaries recorded by workers are already executed inside this one
+        const vk::CommandBufferSubmitInfo commandBufferInfo{ .commandBuffer = *commandBuffers[currentFrame] };
+        const vk::SubmitInfo2 submitInfo
+        {
+            .waitSemaphoreInfoCount = m_Headless ? 0u : 1u,
+            .pWaitSemaphoreInfos = &waitInfo,
+            .commandBufferInfoCount = 1,
+            .pCommandBufferInfos = &commandBufferInfo,
+            .signalSemaphoreInfoCount = signalCount,
+            .pSignalSemaphoreInfos = signalInfos.data()
         };
-        queue.submit(submitInfo, *inFlightFences[currentFrame]);
+        queue.submit2(submitInfo);
 
+        const uint64_t frame = GetRecordingFrame();
+        FrameTimingSlot& timing = m_FrameTimings[frame % m_FrameTimings.size()];
+        timing = { .Frame = frame, .Timing = { .SubmitNs = SDL_GetTicksNS(), .PresentNs = 0, .PresentWait = false } };
+
+        if (!m_Headless)
+            present(timing);
+
+        if (m_LowLatency)
+            waitForPresent(frame);
+        updateFrameTimings();
+
+        frameNumber++;
+        if (m_PendingFramesInFlight != 0)
+        {
+            // frames map to different per-frame resources after the change, none of them may be in use
+            waitForFrame(frameNumber);
+            m_FramesInFlight = m_PendingFramesInFlight;
+            m_PendingFramesInFlight = 0;
+        }
+        currentFrame = static_cast<uint32_t>(frameNumber % m_FramesInFlight);
+        /*downloadQueryBuffer();*/
+    }
+
+    void VulkanRendererAPI::present(FrameTimingSlot& timing)
+    {
+        const vk::PresentIdKHR presentId{ .swapchainCount = 1, .pPresentIds = &timing.Frame };
         const vk::PresentInfoKHR presentInfoKHR{
+            .pNext = m_PresentWaitSupported ? &presentId : nullptr,
             .waitSemaphoreCount = 1,
             .pWaitSemaphores = &*renderFinishedSemaphores[currentImageIndex],
             .swapchainCount = 1,
@@ -904,6 +1339,7 @@ namespace  VanK
         };
         VkResult rawResult = vkQueuePresentKHR(*queue, reinterpret_cast<const VkPresentInfoKHR*>(&presentInfoKHR));
         currentResult = static_cast<vk::Result>(rawResult);
+        timing.Presented = m_PresentWaitSupported && (currentResult == vk::Result::eSuccess || currentResult == vk::Result::eSuboptimalKHR);
         //result = queue.presentKHR(presentInfoKHR); when resizing in hpp is fixed then use this https://github.com/KhronosGroup/Vulkan-Tutorial/issues/73
         if (currentResult == vk::Result::eErrorOutOfDateKHR || currentResult == vk::Result::eSuboptimalKHR || framebufferResized)
         {
@@ -914,8 +1350,76 @@ namespace  VanK
         {
             throw std::runtime_error("failed to present swap chain image!");
         }
-        currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
-        /*downloadQueryBuffer();*/
+    }
+
+    void VulkanRendererAPI::SetFramesInFlight(uint32_t framesInFlight)
+    {
+        framesInFlight = std::clamp(framesInFlight, 1u, MAX_FRAMES_IN_FLIGHT);
+        m_PendingFramesInFlight = framesInFlight != m_FramesInFlight ? framesInFlight : 0;
+    }
+
+    uint64_t VulkanRendererAPI::GetCompletedFrame() const
+    {
+        return m_FrameTimeline.getCounterValue();
+    }
+
+    void VulkanRendererAPI::waitForFrame(uint64_t frame) const
+    {
+        const vk::SemaphoreWaitInfo waitInfo
+        {
+            .semaphoreCount = 1,
+            .pSemaphores = &*m_FrameTimeline,
+            .pValues = &frame
+        };
+        if (device.waitSemaphores(waitInfo, UINT64_MAX) != vk::Result::eSuccess)
+            throw std::runtime_error("failed to wait for a frame to finish!");
+    }
+
+    void VulkanRendererAPI::waitForPresent(uint64_t frame)
+    {
+        const FrameTimingSlot& slot = m_FrameTimings[frame % m_FrameTimings.size()];
+        if (slot.Frame == frame && slot.Presented)
+        {
+            // bounded, a present that never happens must not hang the frame, the GPU wait below still holds then
+            constexpr uint64_t timeoutNs = 100'000'000;
+            const VkResult result = swapChain.getDispatcher()->vkWaitForPresentKHR(*device, *swapChain, frame, timeoutNs);
+            if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR)
+                return;
+        }
+        waitForFrame(frame);
+    }
+
+    void VulkanRendererAPI::updateFrameTimings()
+    {
+        const uint64_t now = SDL_GetTicksNS();
+        const uint64_t completedFrame = GetCompletedFrame();
+        for (FrameTimingSlot& slot : m_FrameTimings)
+        {
+            if (slot.Frame == 0 || slot.Timing.PresentNs != 0)
+                continue;
+
+            if (slot.Presented)
+            {
+                // a zero timeout only polls, a frame mailbox replaced counts as presented with the one replacing it
+                const VkResult result = swapChain.getDispatcher()->vkWaitForPresentKHR(*device, *swapChain, slot.Frame, 0);
+                if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR)
+                {
+                    slot.Timing.PresentNs = now;
+                    slot.Timing.PresentWait = true;
+                }
+            }
+            else if (slot.Frame <= completedFrame)
+                slot.Timing.PresentNs = now;
+        }
+    }
+
+    bool VulkanRendererAPI::GetFrameTiming(uint64_t frame, VanKFrameTiming& timing) const
+    {
+        const FrameTimingSlot& slot = m_FrameTimings[frame % m_FrameTimings.size()];
+        if (slot.Frame != frame || slot.Timing.PresentNs == 0)
+            return false;
+        timing = slot.Timing;
+        return true;
     }
 
     VanKComputePass* VulkanRendererAPI::BeginComputePass(VanKCommandBuffer cmd, VertexBuffer* buffer)
@@ -937,6 +1441,21 @@ namespace  VanK
                 vk::PipelineStageFlagBits2::eTransfer
             );
         }
+
+        // The previous frame may still be reading indirect commands that this pass overwrites
+        const vk::MemoryBarrier2 indirectBarrier
+        {
+            .srcStageMask = vk::PipelineStageFlagBits2::eDrawIndirect,
+            .srcAccessMask = vk::AccessFlagBits2::eIndirectCommandRead,
+            .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+            .dstAccessMask = vk::AccessFlagBits2::eShaderWrite
+        };
+        const vk::DependencyInfo dependencyInfo
+        {
+            .memoryBarrierCount = 1,
+            .pMemoryBarriers = &indirectBarrier
+        };
+        Unwrap(cmd).pipelineBarrier2(dependencyInfo);
         
         return result;
     }
@@ -961,21 +1480,87 @@ namespace  VanK
                 vk::PipelineStageFlagBits2::eVertexShader
             );
         }
+
+        // Indirect commands and counts written by the pass are consumed by the draws and read back on the host
+        const vk::MemoryBarrier2 indirectBarrier
+        {
+            .srcStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+            .srcAccessMask = vk::AccessFlagBits2::eShaderWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eDrawIndirect | vk::PipelineStageFlagBits2::eVertexShader | vk::PipelineStageFlagBits2::eHost,
+            .dstAccessMask = vk::AccessFlagBits2::eIndirectCommandRead | vk::AccessFlagBits2::eShaderRead | vk::AccessFlagBits2::eHostRead
+        };
+        const vk::DependencyInfo dependencyInfo
+        {
+            .memoryBarrierCount = 1,
+            .pMemoryBarriers = &indirectBarrier
+        };
+        Unwrap(computePass->VanKCommandBuffer).pipelineBarrier2(dependencyInfo);
         
         delete computePass;
     }
 
+    void VulkanRendererAPI::CopyBuffer(VanKCommandBuffer cmd, const VanKBuffer& srcBuffer, uint64_t srcOffset, const VanKBuffer& dstBuffer, uint64_t dstOffset, uint64_t size)
+    {
+        if (size == 0)
+            return;
+
+        // Geometry buffers are read as index/vertex input, by shaders through device addresses and as indirect
+        // arguments, any of those may still be in flight on the ranges this copy touches
+        constexpr vk::PipelineStageFlags2 readStages = vk::PipelineStageFlagBits2::eIndexInput | vk::PipelineStageFlagBits2::eVertexAttributeInput |
+            vk::PipelineStageFlagBits2::eVertexShader | vk::PipelineStageFlagBits2::eFragmentShader | vk::PipelineStageFlagBits2::eComputeShader |
+            vk::PipelineStageFlagBits2::eDrawIndirect;
+        constexpr vk::AccessFlags2 readAccess = vk::AccessFlagBits2::eIndexRead | vk::AccessFlagBits2::eVertexAttributeRead |
+            vk::AccessFlagBits2::eShaderRead | vk::AccessFlagBits2::eIndirectCommandRead;
+
+        // earlier uploads and copies into the source must land first, readers of the destination must be done
+        const vk::MemoryBarrier2 beforeCopy
+        {
+            .srcStageMask = readStages | vk::PipelineStageFlagBits2::eTransfer,
+            .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eTransfer,
+            .dstAccessMask = vk::AccessFlagBits2::eTransferRead | vk::AccessFlagBits2::eTransferWrite
+        };
+        const vk::DependencyInfo beforeDependency
+        {
+            .memoryBarrierCount = 1,
+            .pMemoryBarriers = &beforeCopy
+        };
+        Unwrap(cmd).pipelineBarrier2(beforeDependency);
+
+        const vk::BufferCopy copyRegion
+        {
+            .srcOffset = srcOffset,
+            .dstOffset = dstOffset,
+            .size = size
+        };
+        Unwrap(cmd).copyBuffer(static_cast<VkBuffer>(srcBuffer.GetNativeHandle()), static_cast<VkBuffer>(dstBuffer.GetNativeHandle()), copyRegion);
+
+        const vk::MemoryBarrier2 afterCopy
+        {
+            .srcStageMask = vk::PipelineStageFlagBits2::eTransfer,
+            .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+            .dstStageMask = readStages | vk::PipelineStageFlagBits2::eTransfer,
+            .dstAccessMask = readAccess | vk::AccessFlagBits2::eTransferRead | vk::AccessFlagBits2::eTransferWrite
+        };
+        const vk::DependencyInfo afterDependency
+        {
+            .memoryBarrierCount = 1,
+            .pMemoryBarriers = &afterCopy
+        };
+        Unwrap(cmd).pipelineBarrier2(afterDependency);
+    }
+
     void VulkanRendererAPI::BindPipeline(VanKCommandBuffer cmd, VanKPipelineBindPoint pipelineBindPoint, VanKPipeLine pipeline)
     {
-        auto it = m_PipelineResources.find(Unwrap(pipeline));
-        if (it == m_PipelineResources.end())
+        PipelineResource* resource = tryGetPipeline(pipeline);
+        if (!resource)
         {
-            VK_CORE_ERROR("BindPipeline: pipeline not found in resources");
+            VK_CORE_ERROR("BindPipeline: stale or invalid pipeline handle");
             return;
         }
 
-        vk::Pipeline pipelineToBind = it->second.pipeline;
-        vk::PipelineLayout layoutToBind = it->second.layout;
+        vk::Pipeline pipelineToBind = resource->pipeline;
+        vk::PipelineLayout layoutToBind = **resource->layout;
 
         if (!pipelineToBind || !layoutToBind)
         {
@@ -985,21 +1570,53 @@ namespace  VanK
 
         vk::PipelineBindPoint vkBindPoint = (pipelineBindPoint == VanKPipelineBindPoint::Graphics) ? vk::PipelineBindPoint::eGraphics : vk::PipelineBindPoint::eCompute;
 
-        Unwrap(cmd).bindPipeline(vkBindPoint, pipelineToBind);
+        VulkanBindPointState& bound = cmd->state[pipelineBindPoint];
+        if (cmd->state.Record(bound.Pipeline != pipelineToBind))
+        {
+            Unwrap(cmd).bindPipeline(vkBindPoint, pipelineToBind);
+            bound.Pipeline = pipelineToBind;
+        }
+
+        // descriptors bound through another layout may not be compatible, rebind them on the next request
+        if (bound.Layout != layoutToBind)
+            bound = { .Pipeline = pipelineToBind, .Layout = layoutToBind };
 
-        // Update current pipeline layout for push descriptors / push constants
+        // Update current pipeline layout for push descriptors / push constants, workers only read it
+        if (cmd->secondary)
+            return;
         if (pipelineBindPoint == VanKPipelineBindPoint::Graphics)
             m_currentGraphicPipelineLayout = layoutToBind;
         else
             m_currentComputePipelineLayout = layoutToBind;
     }
 
-    void VulkanRendererAPI::BindUniformBuffer(VanKCommandBuffer cmd, VanKPipelineBindPoint bindPoint, UniformBuffer* buffer, uint32_t set, uint32_t binding, uint32_t arrayElement)
+    vk::PipelineLayout VulkanRendererAPI::currentLayout(VanKCommandBuffer cmd, VanKPipelineBindPoint bindPoint) const
     {
-        vk::PipelineLayout layout = VK_NULL_HANDLE;
+        if (vk::PipelineLayout layout = cmd->state[bindPoint].Layout)
+            return layout;
+        // nothing bound on this command buffer yet, the layouts are shared so the last one bound is compatible
+        return bindPoint == VanKPipelineBindPoint::Graphics ? m_currentGraphicPipelineLayout : m_currentComputePipelineLayout;
+    }
 
-        if (bindPoint == VanKPipelineBindPoint::Graphics) layout = m_currentGraphicPipelineLayout;
-        if (bindPoint == VanKPipelineBindPoint::Compute) layout = m_currentComputePipelineLayout;
+    void VulkanRendererAPI::PushConstants(VanKCommandBuffer cmd, VanKShaderStageMask stageFlags, const void* data, uint32_t size, uint32_t offset)
+    {
+        const bool compute = (stageFlags & VanK_SHADER_STAGE_COMPUTE_BIT) != 0;
+        VK_CORE_ASSERT(!compute || stageFlags == VanK_SHADER_STAGE_COMPUTE_BIT, "PushConstants: compute and graphics stages can't share one push");
+
+        // push constants live in the pipeline layout, so they go to whatever was bound last for that bind point
+        vk::PipelineLayout layout = currentLayout(cmd, compute ? VanKPipelineBindPoint::Compute : VanKPipelineBindPoint::Graphics);
+        if (!layout)
+        {
+            VK_CORE_ERROR("PushConstants: no pipeline bound");
+            return;
+        }
+
+        vkCmdPushConstants(*Unwrap(cmd), layout, static_cast<VkShaderStageFlags>(ConvertToVkShaderStageFlags(stageFlags)), offset, size, data);
+    }
+
+    void VulkanRendererAPI::BindUniformBuffer(VanKCommandBuffer cmd, VanKPipelineBindPoint bindPoint, UniformBuffer* buffer, uint32_t set, uint32_t binding, uint32_t arrayElement)
+    {
+        vk::PipelineLayout layout = currentLayout(cmd, bindPoint);
     
         VulkanUniformBuffer* vulkanUBO = dynamic_cast<VulkanUniformBuffer*>(buffer);
         if (!vulkanUBO)
@@ -1008,9 +1625,21 @@ namespace  VanK
         }
 
         const utils::Buffer& vkBuffer = vulkanUBO->GetBuffer();
+
+        // the same ring slot pushed again changes nothing, a new Update() moves the offset
+        VulkanBindPointState& bound = cmd->state[bindPoint];
+        const bool changed = bound.UniformBuffer != vkBuffer.buffer || bound.UniformOffset != vulkanUBO->GetCurrentOffset()
+            || bound.UniformSet != set || bound.UniformBinding != binding || bound.UniformArrayElement != arrayElement;
+        if (!cmd->state.Record(changed))
+            return;
+        bound.UniformBuffer = vkBuffer.buffer;
+        bound.UniformOffset = vulkanUBO->GetCurrentOffset();
+        bound.UniformSet = set;
+        bound.UniformBinding = binding;
+        bound.UniformArrayElement = arrayElement;
     
-        // Setting up push descriptor information, we could choose dynamically the buffer to work on
-        const vk::DescriptorBufferInfo bufferInfo = { .buffer = vkBuffer.buffer, .offset = 0, .range = vk::WholeSize };
+        // Setting up push descriptor information, the offset selects the slot of the last Update() in the ring
+        const vk::DescriptorBufferInfo bufferInfo = { .buffer = vkBuffer.buffer, .offset = vulkanUBO->GetCurrentOffset(), .range = vulkanUBO->GetSlotSize() };
 
         std::array<vk::WriteDescriptorSet, 1> writeDescriptorSets;
         writeDescriptorSets[0] = vk::WriteDescriptorSet{};
@@ -1046,11 +1675,16 @@ namespace  VanK
         Unwrap(cmd).pushDescriptorSet2(pushDescriptorSetInfo);
     }
 
-    void VulkanRendererAPI::BeginRendering(VanKCommandBuffer cmd, const VanKColorTargetInfo* color_target_info = {}, uint32_t num_color_targets = 0, VanKDepthStencilTargetInfo depth_stencil_target_info = {}, VanKRenderOption render_option = VanK_Render_None)
+    void VulkanRendererAPI::BeginRendering(VanKCommandBuffer cmd, const VanKColorTargetInfo* color_target_info, uint32_t num_color_targets, VanKDepthStencilTargetInfo depth_stencil_target_info, VanKRenderOption render_option,
+                                           VanKRenderingContents contents)
     {
         DBG_VK_SCOPE(Unwrap(cmd));  // <-- Helps to debug in NSight
 
         m_renderOption = render_option;
+        // ImGui records inline in EndRendering
+        VK_CORE_ASSERT(contents == VanK_RenderingContents_Inline || render_option == VanK_Render_None, "only the scene pass can be recorded by workers");
+        const vk::RenderingFlags renderingFlags = contents == VanK_RenderingContents_SecondaryCommandBuffers
+            ? vk::RenderingFlagBits::eContentsSecondaryCommandBuffers : vk::RenderingFlags{};
         
         if (render_option == VanK_Render_None)
         {
@@ -1121,8 +1755,13 @@ namespace  VanK
                 .clearValue = clearDepth
             };
 
+            m_RenderingColorFormat = swapChainSurfaceFormat.format;
+            m_RenderingDepthFormat = findDepthFormat();
+            m_RenderingSamples = msaaSamples;
+
             vk::RenderingInfo renderingInfo =
             {
+                .flags = renderingFlags,
                 .renderArea = {.offset = {0, 0}, .extent = viewport},
                 .layerCount = 1,
                 .colorAttachmentCount = 1,
@@ -1181,10 +1820,77 @@ namespace  VanK
         }
     }
 
+    VanKCommandBuffer VulkanRendererAPI::BeginSecondaryCommandBuffer(VanKCommandBuffer primary, uint32_t thread)
+    {
+        VK_CORE_ASSERT(thread < m_RecordingThreadCount, "BeginSecondaryCommandBuffer: no pool for this thread");
+        VK_CORE_ASSERT(!primary->secondary, "BeginSecondaryCommandBuffer: secondaries can't be nested");
+
+        // only this thread touches its pool, allocating from it needs no lock
+        RecordingPool& recordingPool = m_RecordingPools[currentFrame * m_RecordingThreadCount + thread];
+        if (recordingPool.Used == recordingPool.Buffers.size())
+        {
+            const vk::CommandBufferAllocateInfo allocInfo{
+                .commandPool = *recordingPool.Pool, .level = vk::CommandBufferLevel::eSecondary, .commandBufferCount = 1
+            };
+            recordingPool.Buffers.push_back(std::move(vk::raii::CommandBuffers(device, allocInfo).front()));
+            recordingPool.Wrappers.emplace_back();
+            DBG_VK_NAME(*recordingPool.Buffers.back());
+        }
+
+        vk::raii::CommandBuffer& buffer = recordingPool.Buffers[recordingPool.Used];
+        VanKCommandBuffer_T& wrapper = recordingPool.Wrappers[recordingPool.Used++];
+        wrapper = { .handle = &buffer, .secondary = true };
+
+        const vk::CommandBufferInheritanceRenderingInfo renderingInfo
+        {
+            .colorAttachmentCount = 1,
+            .pColorAttachmentFormats = &m_RenderingColorFormat,
+            .depthAttachmentFormat = m_RenderingDepthFormat,
+            .rasterizationSamples = m_RenderingSamples
+        };
+        const vk::CommandBufferInheritanceInfo inheritanceInfo
+        {
+            .pNext = &renderingInfo,
+            .pipelineStatistics = QueryStatistics // the frame's statistics query is active in the primary, needs inheritedQueries
+        };
+        buffer.begin({
+            .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue,
+            .pInheritanceInfo = &inheritanceInfo
+        });
+        return &wrapper;
+    }
+
+    void VulkanRendererAPI::EndSecondaryCommandBuffer(VanKCommandBuffer cmd)
+    {
+        Unwrap(cmd).end();
+    }
+
+    void VulkanRendererAPI::ExecuteSecondaryCommandBuffers(VanKCommandBuffer primary, const VanKCommandBuffer* secondaries, uint32_t count)
+    {
+        VK_CORE_ASSERT(m_InheritedQueriesSupported, "Secondaries inside the statistics query need the inheritedQueries feature");
+        std::vector<vk::CommandBuffer> handles(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            handles[i] = *Unwrap(secondaries[i]);
+            primary->state.Issued += secondaries[i]->state.Issued;
+            primary->state.Filtered += secondaries[i]->state.Filtered;
+        }
+        Unwrap(primary).executeCommands(handles);
+
+        // whatever the secondaries bound is undefined in the primary afterwards
+        primary->state.Invalidate();
+    }
+
     void VulkanRendererAPI::SetViewport(VanKCommandBuffer cmd, uint32_t viewportCount, VanKViewport viewport)
     {
         vk::Viewport vkViewport{ viewport.x, viewport.y, (float)viewport.width, (float)viewport.height, viewport.minDepth, viewport.maxDepth };
 
+        VulkanCommandState& state = cmd->state;
+        if (!state.Record(state.ViewportCount != viewportCount || state.Viewport != vkViewport))
+            return;
+        state.ViewportCount = viewportCount;
+        state.Viewport = vkViewport;
+
         // Wrap the single viewport in an ArrayProxy (RAII-friendly)
         std::vector<vk::Viewport> viewports(viewportCount, vkViewport);
         
@@ -1195,6 +1901,12 @@ namespace  VanK
     {
         vk::Rect2D vkScissor( vk::Offset2D(scissor.x, scissor.y), {scissor.width, scissor.height} );
 
+        VulkanCommandState& state = cmd->state;
+        if (!state.Record(state.ScissorCount != scissorCount || state.Scissor != vkScissor))
+            return;
+        state.ScissorCount = scissorCount;
+        state.Scissor = vkScissor;
+
         // Wrap the single scissor in an ArrayProxy (RAII-friendly)
         std::vector<vk::Rect2D> scissors(scissorCount, vkScissor);
         
@@ -1217,6 +1929,14 @@ namespace  VanK
         }
 
         const utils::Buffer& vkBuffer = vulkanVB->GetBuffer();
+
+        VulkanCommandState& state = cmd->state;
+        if (!state.Record(state.VertexBuffer != vkBuffer.buffer || state.VertexFirstSlot != first_slot || state.VertexBindings != num_bindings))
+            return;
+        state.VertexBuffer = vkBuffer.buffer;
+        state.VertexFirstSlot = first_slot;
+        state.VertexBindings = num_bindings;
+
         std::vector<vk::Buffer> buffers(num_bindings, vkBuffer.buffer); // The actual VkBuffer
 
         std::vector<vk::DeviceSize> offsets(num_bindings, 0);
@@ -1244,6 +1964,12 @@ namespace  VanK
         case VanKIndexElementSize::Uint32: vkIndexType = vk::IndexType::eUint32; break;
         }
 
+        VulkanCommandState& state = cmd->state;
+        if (!state.Record(state.IndexBuffer != buffer || state.IndexType != vkIndexType))
+            return;
+        state.IndexBuffer = buffer;
+        state.IndexType = vkIndexType;
+
         Unwrap(cmd).bindIndexBuffer(buffer, 0, vkIndexType);
     }
 
@@ -1257,6 +1983,18 @@ namespace  VanK
         Unwrap(cmd).drawIndexed(indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
     }
 
+    void VulkanRendererAPI::DrawIndexedIndirect(VanKCommandBuffer cmd, IndirectBuffer& indirectBuffer, uint32_t indirectBufferOffset, uint32_t drawCount, uint32_t stride)
+    {
+        if (drawCount > 1 && stride < sizeof(vk::DrawIndexedIndirectCommand))
+            throw std::runtime_error("DrawIndexedIndirect: stride too small");
+
+        const VulkanIndirectBuffer* vulkanIB = dynamic_cast<const VulkanIndirectBuffer*>(&indirectBuffer);
+        if (!vulkanIB)
+            throw std::runtime_error("DrawIndexedIndirect: indirectBuffer is not a VulkanIndirectBuffer");
+
+        Unwrap(cmd).drawIndexedIndirect(vulkanIB->GetBuffer().buffer, indirectBufferOffset, drawCount, stride);
+    }
+
     void VulkanRendererAPI::DrawIndexedIndirectCount(VanKCommandBuffer cmd, IndirectBuffer& indirectBuffer, uint32_t indirectBufferOffset, IndirectBuffer& countBuffer, uint32_t countBufferOffset, uint32_t maxDrawCount, uint32_t stride)
     {
         if (stride < sizeof(vk::DrawIndexedIndirectCommand))
@@ -1316,7 +2054,9 @@ namespace  VanK
         
         if (m_renderOption == VanK_Render_ImGui)
         {
-            ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), *Unwrap(cmd));
+            ImGui_ImplVulkan_RenderDrawData(m_ImGuiDrawData ? m_ImGuiDrawData : ImGui::GetDrawData(), *Unwrap(cmd));
+            // ImGui binds its own pipeline, descriptors, buffers and viewport
+            cmd->state.Invalidate();
 
             Unwrap(cmd).endRendering();
             
@@ -1325,7 +2065,7 @@ namespace  VanK
             (
                 currentImageIndex,
                 vk::ImageLayout::eColorAttachmentOptimal,
-                vk::ImageLayout::ePresentSrcKHR,
+                m_PresentLayout,
                 vk::AccessFlagBits2::eColorAttachmentWrite, // srcAccessMask
                 {}, // dstAccessMask
                 vk::PipelineStageFlagBits2::eColorAttachmentOutput, // srcStage
@@ -1407,7 +2147,7 @@ namespace  VanK
             (
                 currentImageIndex,
                 vk::ImageLayout::eTransferDstOptimal,
-                vk::ImageLayout::ePresentSrcKHR,
+                m_PresentLayout,
                 vk::AccessFlagBits2::eTransferWrite, // srcAccessMask
                 {}, // dstAccessMask
                 vk::PipelineStageFlagBits2::eTransfer, // srcStage
@@ -1426,10 +2166,16 @@ namespace  VanK
          * but only the texture is a set, the scene information is a push descriptor.
         -*/
         vk::DescriptorSet rawDescriptorSet = *descriptorSets[0];
+
+        VulkanBindPointState& bound = cmd->state[VanKPipelineBindPoint::Graphics];
+        if (!cmd->state.Record(bound.SamplerSet != rawDescriptorSet))
+            return;
+        bound.SamplerSet = rawDescriptorSet;
+
         vk::BindDescriptorSetsInfoKHR bindDescriptorSetsInfo =
         {
             .stageFlags = vk::ShaderStageFlagBits::eAllGraphics,
-            .layout = m_currentGraphicPipelineLayout,
+            .layout = currentLayout(cmd, VanKPipelineBindPoint::Graphics),
             .firstSet = 0,
             .descriptorSetCount = 1,
             .pDescriptorSets = &rawDescriptorSet,
@@ -1450,6 +2196,20 @@ namespace  VanK
         };
         commandPool = vk::raii::CommandPool(device, poolInfo);
         DBG_VK_NAME(*commandPool);
+
+        // ranges are recorded as jobs, the job system can't run more at once than it has threads
+        m_RecordingThreadCount = std::clamp(JobSystem::Get().GetThreadCount(), 1u, 8u);
+        const vk::CommandPoolCreateInfo recordingPoolInfo{
+            .flags = vk::CommandPoolCreateFlagBits::eTransient,
+            .queueFamilyIndex = queueIndex
+        };
+        m_RecordingPools.clear();
+        m_RecordingPools.resize(MAX_FRAMES_IN_FLIGHT * m_RecordingThreadCount);
+        for (RecordingPool& recordingPool : m_RecordingPools)
+        {
+            recordingPool.Pool = vk::raii::CommandPool(device, recordingPoolInfo);
+            DBG_VK_NAME(*recordingPool.Pool);
+        }
     }
 
     void VulkanRendererAPI::createSceneResources()
@@ -1883,45 +2643,35 @@ namespace  VanK
             uint32_t numTextures = 10000; // We don't need to set the exact number of texture the scene have.
 
             // In comment, the layout for a storage buffer, which is not used in this sample, but rather a push descriptor (below)
-            std::array<vk::DescriptorSetLayoutBinding, 1> layoutBindings{
+            VulkanLayoutCache::DescriptorSetLayoutKey layoutKey
+            {
+                // Allows to update the descriptor set after it has been bound
+                .Flags = vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool,
+                .Bindings =
+                {
                     {
-                        {
-                            .binding = 0,
-                            .descriptorType = vk::DescriptorType::eCombinedImageSampler,
-                            .descriptorCount = numTextures,
-                            .stageFlags = vk::ShaderStageFlagBits::eAllGraphics
-                        },
+                        .binding = 0,
+                        .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+                        .descriptorCount = numTextures,
+                        .stageFlags = vk::ShaderStageFlagBits::eAllGraphics
+                    },
                 
-                        // This is if we would add another binding for the scene info, but instead we make another set, see below
-                        // {.binding = 1, .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS},
-                    }
-            };
-
-            std::array<vk::DescriptorBindingFlags, 1> flags = {
-                // Flags for binding 0 (texture array):
-                vk::DescriptorBindingFlagBits::eUpdateAfterBind | // Can update while in use
-                vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending | // Can update unused entries
-                vk::DescriptorBindingFlagBits::ePartiallyBound // Not all array elements need to be valid (0,2,3 vs 0,1,2,3)
-
-                // Flags for binding 1 (scene info buffer):
-                // VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT  // flags for storage buffer binding
-            };
-            
-            vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlags{
-                .bindingCount = uint32_t(layoutBindings.size()), // matches our number of bindings
-                .pBindingFlags = flags.data(), // the flags for each binding
-            };
+                    // This is if we would add another binding for the scene info, but instead we make another set, see below
+                    // {.binding = 1, .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS},
+                },
+                .BindingFlags =
+                {
+                    // Flags for binding 0 (texture array):
+                    vk::DescriptorBindingFlagBits::eUpdateAfterBind | // Can update while in use
+                    vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending | // Can update unused entries
+                    vk::DescriptorBindingFlagBits::ePartiallyBound // Not all array elements need to be valid (0,2,3 vs 0,1,2,3)
 
-            vk::DescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{
-                .pNext = &bindingFlags,
-                .flags = vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool,
-                // Allows to update the descriptor set after it has been bound
-                .bindingCount = uint32_t(layoutBindings.size()),
-                .pBindings = layoutBindings.data(),
+                    // Flags for binding 1 (scene info buffer):
+                    // VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT  // flags for storage buffer binding
+                }
             };
-            descriptorSetLayout = device.createDescriptorSetLayout(descriptorSetLayoutInfo);
-            DBG_VK_NAME(*descriptorSetLayout);
-            std::vector<vk::DescriptorSetLayout> layouts = { *descriptorSetLayout };
+            descriptorSetLayout = m_LayoutCache->AcquireDescriptorSetLayout(layoutKey);
+            std::vector<vk::DescriptorSetLayout> layouts = { **descriptorSetLayout };
             // Allocate the descriptor set, needed only for larger descriptor sets
             vk::DescriptorSetAllocateInfo allocInfo = {
                 .descriptorPool = descriptorPool,
@@ -1935,7 +2685,10 @@ namespace  VanK
         // Second this is another set which will be pushed
         {
             // This is the scene buffer information
-            std::array<vk::DescriptorSetLayoutBinding, 1> layoutBindings{
+            commonDescriptorSetLayout = m_LayoutCache->AcquireDescriptorSetLayout
+            ({
+                .Flags = vk::DescriptorSetLayoutCreateFlagBits::ePushDescriptor,
+                .Bindings =
                 {
                     {
                         .binding = 0,
@@ -1944,14 +2697,7 @@ namespace  VanK
                         .stageFlags = vk::ShaderStageFlagBits::eAllGraphics | vk::ShaderStageFlagBits::eCompute
                     }
                 }
-            };
-            vk::DescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{
-                .flags = vk::DescriptorSetLayoutCreateFlagBits::ePushDescriptor,
-                .bindingCount = uint32_t(layoutBindings.size()),
-                .pBindings = layoutBindings.data(),
-            };
-            commonDescriptorSetLayout = device.createDescriptorSetLayout(descriptorSetLayoutInfo);
-            DBG_VK_NAME(*commonDescriptorSetLayout);
+            });
         }
         updateGraphicsDescriptorSet();
     }
@@ -2078,6 +2824,7 @@ namespace  VanK
         {
             DBG_VK_NAME(*commandBuffer);
         }
+        m_FrameCommandBuffers.resize(commandBuffers.size());
     }
 
     void VulkanRendererAPI::transition_image_layout(
@@ -2156,21 +2903,29 @@ namespace  VanK
     void VulkanRendererAPI::createSyncObjects()
     {
         presentCompleteSemaphores.clear();
-        renderFinishedSemaphores.clear();
-        inFlightFences.clear();
-
-        for (size_t i = 0; i < swapChainImages.size(); i++)
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
         {
             presentCompleteSemaphores.emplace_back(device, vk::SemaphoreCreateInfo());
             DBG_VK_NAME(*presentCompleteSemaphores.back());
-            renderFinishedSemaphores.emplace_back(device, vk::SemaphoreCreateInfo());
-            DBG_VK_NAME(*renderFinishedSemaphores.back());
         }
+        createRenderFinishedSemaphores();
 
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        vk::SemaphoreTypeCreateInfo timelineInfo
         {
-            inFlightFences.emplace_back(device, vk::FenceCreateInfo{.flags = vk::FenceCreateFlagBits::eSignaled});
-            DBG_VK_NAME(*inFlightFences.back());
+            .semaphoreType = vk::SemaphoreType::eTimeline,
+            .initialValue = frameNumber
+        };
+        m_FrameTimeline = vk::raii::Semaphore(device, vk::SemaphoreCreateInfo{.pNext = &timelineInfo});
+        DBG_VK_NAME(*m_FrameTimeline);
+    }
+
+    void VulkanRendererAPI::createRenderFinishedSemaphores()
+    {
+        renderFinishedSemaphores.clear();
+        for (size_t i = 0; i < swapChainImages.size(); i++)
+        {
+            renderFinishedSemaphores.emplace_back(device, vk::SemaphoreCreateInfo());
+            DBG_VK_NAME(*renderFinishedSemaphores.back());
         }
     }
 
@@ -2180,14 +2935,7 @@ namespace  VanK
         {
             .queryType = vk::QueryType::ePipelineStatistics,
             .queryCount = 1,
-            .pipelineStatistics =
-                vk::QueryPipelineStatisticFlagBits::eInputAssemblyVertices |
-                vk::QueryPipelineStatisticFlagBits::eInputAssemblyPrimitives |
-                vk::QueryPipelineStatisticFlagBits::eVertexShaderInvocations |
-                vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations |
-                vk::QueryPipelineStatisticFlagBits::eComputeShaderInvocations |
-                vk::QueryPipelineStatisticFlagBits::eClippingInvocations |
-                vk::QueryPipelineStatisticFlagBits::eClippingPrimitives
+            .pipelineStatistics = QueryStatistics
         };
 
         queryPool = vk::raii::QueryPool(device, poolInfo);
@@ -2281,10 +3029,14 @@ namespace  VanK
 
     std::vector<const char*> VulkanRendererAPI::getRequiredExtensions()
     {
-        uint32_t sdlExtensionCount = 0;
-        auto sdlExtensions = SDL_Vulkan_GetInstanceExtensions(&sdlExtensionCount);
-
-        std::vector extensions(sdlExtensions, sdlExtensions + sdlExtensionCount);
+        std::vector<const char*> extensions;
+        // headless creates no surface, so it doesn't need the window system extensions
+        if (!m_Headless)
+        {
+            uint32_t sdlExtensionCount = 0;
+            auto sdlExtensions = SDL_Vulkan_GetInstanceExtensions(&sdlExtensionCount);
+            extensions.assign(sdlExtensions, sdlExtensions + sdlExtensionCount);
+        }
         if (enableValidationLayers)
         {
             extensions.push_back(vk::EXTDebugUtilsExtensionName);
@@ -4,6 +4,7 @@
 #include <fstream>
 #include <stdexcept>
 #include <vector>
+#include <deque>
 #include <cstring>
 #include <cstdlib>
 #include <memory>
@@ -68,7 +69,8 @@ import vulkan_hpp;
 
 constexpr uint32_t WIDTH = 800;
 constexpr uint32_t HEIGHT = 600;
-constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+// per-frame resources are created for this many frames, RendererAPI::SetFramesInFlight picks how many are used
+constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 4;
 
 const std::string TEXTURE_PATH = "../build/VanK/textures/viking_room.ktx2";
 // Define the number of objects to render
@@ -109,36 +111,74 @@ throw std::runtime_error(message);
 
 namespace VanK
 {
-    struct VanKCommandBuffer_T
+    class VulkanUploadContext;
+    class VulkanLayoutCache;
+
+    // What one bind point of a command buffer has bound so far
+    struct VulkanBindPointState
     {
-        vk::raii::CommandBuffer* handle;
+        vk::Pipeline Pipeline;
+        vk::PipelineLayout Layout;
+        vk::DescriptorSet SamplerSet;   // set 0, BindFragmentSamplers
+        vk::Buffer UniformBuffer;       // last pushed uniform buffer
+        vk::DeviceSize UniformOffset = 0;
+        uint32_t UniformSet = UINT32_MAX;
+        uint32_t UniformBinding = UINT32_MAX;
+        uint32_t UniformArrayElement = UINT32_MAX;
     };
 
-    inline vk::raii::CommandBuffer& Unwrap(VanKCommandBuffer cmd)
+    /*--
+     * Per command buffer record of the bound state, binds that would not change anything are dropped.
+     * Anything recorded behind the renderer's back (ImGui) has to Invalidate() it.
+    -*/
+    struct VulkanCommandState
     {
-        assert(cmd && "VanKCommandBuffer is null!");
-        return *cmd->handle;
-    }
+        std::array<VulkanBindPointState, 2> BindPoints; // indexed by VanKPipelineBindPoint
+        vk::Buffer IndexBuffer;
+        vk::IndexType IndexType = vk::IndexType::eNoneKHR;
+        vk::Buffer VertexBuffer;
+        uint32_t VertexFirstSlot = UINT32_MAX;
+        uint32_t VertexBindings = 0;
+        vk::Viewport Viewport;
+        uint32_t ViewportCount = 0;
+        vk::Rect2D Scissor;
+        uint32_t ScissorCount = 0;
+
+        uint32_t Issued = 0;
+        uint32_t Filtered = 0;
+
+        VulkanBindPointState& operator[](VanKPipelineBindPoint bindPoint) { return BindPoints[static_cast<size_t>(bindPoint)]; }
+
+        // forget what is bound, the counters keep running
+        void Invalidate()
+        {
+            uint32_t issued = Issued, filtered = Filtered;
+            *this = {};
+            Issued = issued;
+            Filtered = filtered;
+        }
 
-    struct VanKPipeLine_T
-    {
-        vk::Pipeline handle;
+        // true when the command has to be recorded
+        bool Record(bool changed)
+        {
+            (changed ? Issued : Filtered)++;
+            return changed;
+        }
     };
 
-    inline vk::Pipeline Unwrap(VanKPipeLine pipeline)
+    struct VanKCommandBuffer_T
     {
-        assert(pipeline && "VanKPipeLine is null!");
-        return pipeline->handle;
-    }
+        vk::raii::CommandBuffer* handle;
+        VulkanCommandState state;
+        bool secondary = false; // recorded on a worker thread, must not touch renderer wide state
+    };
 
-    inline VanKPipeLine Wrap(vk::Pipeline pipeline)
+    inline vk::raii::CommandBuffer& Unwrap(VanKCommandBuffer cmd)
     {
-        if (!pipeline)
-            return nullptr;
-       
-        return new VanKPipeLine_T(pipeline);
+        assert(cmd && "VanKCommandBuffer is null!");
+        return *cmd->handle;
     }
-    
+
 //--- Vulkan Helpers ------------------------------------------------------------------------------------------------------------
 #ifdef NDEBUG
     #define VK_CHECK(vkFnc) vkFnc
@@ -282,6 +322,8 @@ namespace VanK
                 access |= vk::AccessFlagBits2::eVertexAttributeRead; // Always read-only
             if ((stage & vk::PipelineStageFlagBits2::eTransfer))
                 access |= src ? vk::AccessFlagBits2::eTransferRead : vk::AccessFlagBits2::eTransferWrite;
+            if ((stage & vk::PipelineStageFlagBits2::eDrawIndirect))
+                access |= vk::AccessFlagBits2::eIndirectCommandRead; // Always read-only
             ASSERT(access, "Missing stage implementation");
             return access;
         }
@@ -828,17 +870,36 @@ namespace VanK
     private:
         uint32_t AddTextureToPool(utils::ImageResource&& imageResource);
         void RemoveTextureFromPool(uint32_t index);
-        VanKPipeLine createGraphicsPipeline(VanKGraphicsPipelineSpecification pipelineSpecification) override;
-        VanKPipeLine createComputeShaderPipeline(VanKComputePipelineSpecification computePipelineSpecification) override;
+        VanKPipeLine createGraphicsPipeline(const VanKGraphicsPipelineSpecification& pipelineSpecification) override;
+        VanKPipeLine createComputeShaderPipeline(const VanKComputePipelineSpecification& computePipelineSpecification) override;
+        VanKPipelineCacheStats GetPipelineCacheStats() const override;
+        VanKCommandStats GetCommandStats() const override;
         void DestroyAllPipelines() override;
         void DestroyPipeline(VanKPipeLine pipeline) override;
+        bool ReloadPipeline(VanKPipeLine pipeline, const VanKGraphicsPipelineSpecification& pipelineSpecification) override;
+        bool ReloadPipeline(VanKPipeLine pipeline, const VanKComputePipelineSpecification& computePipelineSpecification) override;
         VanKCommandBuffer BeginCommandBuffer() override;
         void EndCommandBuffer(VanKCommandBuffer cmd) override;
         void BeginFrame() override;
         void EndFrame() override;
+        void SetFramesInFlight(uint32_t framesInFlight) override;
+        uint32_t GetFramesInFlight() const override { return m_FramesInFlight; }
+        uint64_t GetRecordingFrame() const override { return frameNumber + 1; }
+        uint64_t GetCompletedFrame() const override;
+        void SetLowLatency(bool enabled) override { m_LowLatency = enabled; }
+        bool IsPresentWaitSupported() const override { return m_PresentWaitSupported; }
+        bool GetFrameTiming(uint64_t frame, VanKFrameTiming& timing) const override;
+        bool IsHeadless() const override { return m_Headless; }
         void BindPipeline(VanKCommandBuffer cmd, VanKPipelineBindPoint pipelineBindPoint, VanKPipeLine pipeline) override;
         void BindUniformBuffer(VanKCommandBuffer cmd, VanKPipelineBindPoint bindPoint, UniformBuffer* buffer, uint32_t set, uint32_t binding, uint32_t arrayElement) override;
-        void BeginRendering(VanKCommandBuffer cmd, const VanKColorTargetInfo* color_target_info, uint32_t num_color_targets, VanKDepthStencilTargetInfo depth_stencil_target_info, VanKRenderOption render_option) override;
+        void PushConstants(VanKCommandBuffer cmd, VanKShaderStageMask stageFlags, const void* data, uint32_t size, uint32_t offset = 0) override;
+        void BeginRendering(VanKCommandBuffer cmd, const VanKColorTargetInfo* color_target_info, uint32_t num_color_targets, VanKDepthStencilTargetInfo depth_stencil_target_info, VanKRenderOption render_option,
+                            VanKRenderingContents contents = VanK_RenderingContents_Inline) override;
+        uint32_t GetRecordingThreadCount() const override { return m_RecordingThreadCount; }
+        bool IsParallelRecordingSupported() const override { return m_InheritedQueriesSupported; }
+        VanKCommandBuffer BeginSecondaryCommandBuffer(VanKCommandBuffer primary, uint32_t thread) override;
+        void EndSecondaryCommandBuffer(VanKCommandBuffer cmd) override;
+        void ExecuteSecondaryCommandBuffers(VanKCommandBuffer primary, const VanKCommandBuffer* secondaries, uint32_t count) override;
         void BindFragmentSamplers(VanKCommandBuffer cmd, uint32_t firstSlot, const TextureSamplerBinding* samplers, uint32_t num_bindings) override;
         void SetViewport(VanKCommandBuffer cmd, uint32_t viewportCount, VanKViewport viewport) override;
         void SetScissor(VanKCommandBuffer cmd, uint32_t scissorCount, VankRect scissor) override;
@@ -846,11 +907,13 @@ namespace VanK
         void BindIndexBuffer(VanKCommandBuffer cmd, const IndexBuffer& indexBuffer, VanKIndexElementSize elementSize) override;
         void Draw(VanKCommandBuffer cmd, uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance) override;
         void DrawIndexed(VanKCommandBuffer cmd, uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance) override;
+        void DrawIndexedIndirect(VanKCommandBuffer cmd, IndirectBuffer& indirectBuffer, uint32_t indirectBufferOffset, uint32_t drawCount, uint32_t stride) override;
         void DrawIndexedIndirectCount(VanKCommandBuffer cmd, IndirectBuffer& indirectBuffer, uint32_t indirectBufferOffset, IndirectBuffer& countBuffer, uint32_t countBufferOffset, uint32_t maxDrawCount, uint32_t stride) override;
         void EndRendering(VanKCommandBuffer cmd) override;
         VanKComputePass* BeginComputePass(VanKCommandBuffer cmd, VertexBuffer* buffer) override;
         void DispatchCompute(VanKComputePass* computePass, uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) override;
         void EndComputePass(VanKComputePass* computePass) override;
+        void CopyBuffer(VanKCommandBuffer cmd, const VanKBuffer& srcBuffer, uint64_t srcOffset, const VanKBuffer& dstBuffer, uint64_t dstOffset, uint64_t size) override;
         
         /*-- Wait until GPU is done using the pipeline to safly destroy --*/
         void waitForGraphicsQueueIdle() override;
@@ -858,13 +921,60 @@ namespace VanK
         struct PipelineResource
         {
             vk::raii::Pipeline pipeline = VK_NULL_HANDLE;
-            vk::raii::PipelineLayout layout = VK_NULL_HANDLE;
+            std::shared_ptr<const vk::raii::PipelineLayout> layout; // shared through the layout cache
             VanKPipelineBindPoint bindPoint;
             VanKGraphicsPipelineSpecification spec;
             VanKComputePipelineSpecification computeSpec;
+            std::vector<uint64_t> stateKey;
+            uint32_t refCount = 0; // creates answered by this pipeline, destroyed when the last one is released
+            uint32_t generation = 0;
+            bool alive = false;
+        };
+        // dense table addressed by VanKPipeLine, freed slots are reused with a bumped generation
+        std::vector<PipelineResource> m_Pipelines;
+        std::vector<uint32_t> m_FreePipelineSlots;
+        uint32_t m_PipelineCount = 0;
+
+        PipelineResource* tryGetPipeline(VanKPipeLine pipeline)
+        {
+            if (pipeline.Index >= m_Pipelines.size())
+                return nullptr;
+            PipelineResource& resource = m_Pipelines[pipeline.Index];
+            return resource.alive && resource.generation == pipeline.Generation ? &resource : nullptr;
+        }
+
+        // Everything that ends up in the driver pipeline packed into words, compared in full so a hash collision
+        // can never hand out the wrong pipeline
+        struct PipelineStateKeyHash
+        {
+            std::size_t operator()(const std::vector<uint64_t>& key) const
+            {
+                std::size_t seed = key.size();
+                for (uint64_t word : key)
+                    seed = hashCombine(seed, word);
+                return seed;
+            }
         };
-        std::unordered_map<vk::Pipeline, PipelineResource> m_PipelineResources;
+        std::unordered_map<std::vector<uint64_t>, uint32_t, PipelineStateKeyHash> m_PipelineByState; // state -> table index
+        uint64_t m_PipelineCacheHits = 0;
+        uint64_t m_PipelineCacheMisses = 0;
+
+    private:
+        std::vector<uint64_t> graphicsPipelineStateKey(const VanKGraphicsPipelineSpecification& pipelineSpecification);
+        std::vector<uint64_t> computePipelineStateKey(const VanKComputePipelineSpecification& computePipelineSpecification);
+        PipelineResource buildGraphicsPipeline(const VanKGraphicsPipelineSpecification& pipelineSpecification);
+        PipelineResource buildComputePipeline(const VanKComputePipelineSpecification& computePipelineSpecification);
+        VanKPipeLine findCachedPipeline(const std::vector<uint64_t>& stateKey);
+        VanKPipeLine addPipeline(PipelineResource&& resource, std::vector<uint64_t>&& stateKey);
+        void replacePipeline(PipelineResource& slot, PipelineResource&& resource, std::vector<uint64_t>&& stateKey);
+
+        // layout for descriptors and push constants, the one bound on cmd or the last one bound anywhere
+        vk::PipelineLayout currentLayout(VanKCommandBuffer cmd, VanKPipelineBindPoint bindPoint) const;
 
+        std::vector<VanKCommandBuffer_T> m_FrameCommandBuffers; // one per frame in flight, reset by BeginCommandBuffer
+        VanKCommandStats m_LastCommandStats{};
+
+    public:
         vk::PipelineLayout m_currentGraphicPipelineLayout;
         vk::PipelineLayout m_currentComputePipelineLayout;
 
@@ -872,10 +982,15 @@ namespace VanK
         void setFramebufferResized(bool resized) { framebufferResized = resized; }
         uint32_t getAPIVersion() const { return apiVersion; };
         vk::raii::Device& GetDevice() { return device; }
+        vk::raii::PhysicalDevice& GetPhysicalDevice() { return physicalDevice; }
         utils::ResourceAllocator& GetAllocator() { return allocator; }
+        VulkanUploadContext& GetUploadContext() { return *m_UploadContext; }
+        uint32_t GetCurrentFrame() const { return currentFrame; }
+        uint64_t GetFrameNumber() const { return frameNumber; }
         ImTextureID getImTextureID(uint32_t index = 0) const override { return reinterpret_cast<ImTextureID>(uiDescriptorSet[index]); }
         void setViewportSize(Extent2D viewportSize) override
         { viewport = vk::Extent2D{viewportSize.width, viewportSize.height}; recreateImages(); }
+        void SetImGuiDrawData(ImDrawData* drawData) override { m_ImGuiDrawData = drawData; }
     private:
         inline static VulkanRendererAPI* s_instance = nullptr;
         SDL_Window* window = nullptr;
@@ -890,11 +1005,20 @@ namespace VanK
         uint32_t queueIndex = ~0;
         vk::raii::Queue queue = nullptr;
         utils::ResourceAllocator allocator;
+        std::unique_ptr<VulkanUploadContext> m_UploadContext; // staging for StorageBuffer::Upload()
+        std::unique_ptr<VulkanLayoutCache> m_LayoutCache; // shared descriptor set and pipeline layouts
         vk::raii::SwapchainKHR swapChain = nullptr;
         std::vector<vk::Image> swapChainImages;
         vk::SurfaceFormatKHR swapChainSurfaceFormat;
         vk::Extent2D swapChainExtent;
         std::vector<vk::raii::ImageView> swapChainImageViews;
+        // Headless: swapChainImages point at these, one per frame in flight, and are left in m_PresentLayout
+        // (transfer source) so a test can copy the finished frame out
+        bool m_Headless = false;
+        vk::Extent2D m_HeadlessExtent;
+        std::vector<vk::raii::Image> m_HeadlessImages;
+        std::vector<vk::raii::DeviceMemory> m_HeadlessImageMemory;
+        vk::ImageLayout m_PresentLayout = vk::ImageLayout::ePresentSrcKHR;
 
         vk::raii::PipelineLayout* pipelineLayout = nullptr;
         vk::raii::Pipeline* graphicsPipeline = nullptr;
@@ -926,27 +1050,60 @@ namespace VanK
         vk::raii::DescriptorPool uiDescriptorPool = nullptr; // imgui 
         std::vector<vk::raii::DescriptorSet> descriptorSets;
         std::vector<VkDescriptorSet> uiDescriptorSet{}; // imgui
-        vk::raii::DescriptorSetLayout descriptorSetLayout = nullptr;
-        vk::raii::DescriptorSetLayout commonDescriptorSetLayout = nullptr;
+        std::shared_ptr<const vk::raii::DescriptorSetLayout> descriptorSetLayout;
+        std::shared_ptr<const vk::raii::DescriptorSetLayout> commonDescriptorSetLayout;
 
         vk::raii::CommandPool commandPool = nullptr;
         std::vector<vk::raii::CommandBuffer> commandBuffers;
+
+        // Secondary command buffers of one recording thread in one frame in flight. The pool is reset as a whole when
+        // its frame starts again, deques keep the handles the wrappers point at in place while more are allocated.
+        struct RecordingPool
+        {
+            vk::raii::CommandPool Pool = nullptr;
+            std::deque<vk::raii::CommandBuffer> Buffers;
+            std::deque<VanKCommandBuffer_T> Wrappers;
+            uint32_t Used = 0;
+        };
+        std::vector<RecordingPool> m_RecordingPools; // frame * m_RecordingThreadCount + thread
+        uint32_t m_RecordingThreadCount = 0;
+        // attachment formats of the rendering begun last, secondaries have to declare them
+        vk::Format m_RenderingColorFormat = vk::Format::eUndefined;
+        vk::Format m_RenderingDepthFormat = vk::Format::eUndefined;
+        vk::SampleCountFlagBits m_RenderingSamples = vk::SampleCountFlagBits::e1;
         uint32_t currentImageIndex = {};
         vk::Result currentResult = {};
         
-        std::vector<vk::raii::Semaphore> presentCompleteSemaphores;
+        std::vector<vk::raii::Semaphore> presentCompleteSemaphores; // per frame in flight, signaled by the acquire
+        // Per swapchain image, the present waits on it. Nothing tells when a present is done with its semaphore, but
+        // it is by the time its image is acquired again.
         std::vector<vk::raii::Semaphore> renderFinishedSemaphores;
-        // Update timeline value for this frame
 
-        vk::raii::Semaphore semaphore = nullptr;
-        uint64_t timelineValue = 0;
-        std::vector<vk::raii::Fence> inFlightFences;
-        uint32_t currentFrame = 0;
+        // every frame submit signals its frame number, m_FrameTimeline's value is the number of the last finished frame
+        vk::raii::Semaphore m_FrameTimeline = nullptr;
+        uint32_t m_FramesInFlight = 2;
+        uint32_t m_PendingFramesInFlight = 0; // applied in EndFrame, 0 when unchanged
+        uint32_t currentFrame = 0; // frameNumber % m_FramesInFlight, picks the per-frame resources
+        uint64_t frameNumber = 0; // submitted frames, never wraps like currentFrame
+
+        // Timings of the last frames, frame % size. Frames are presented with their number as present id, so with
+        // VK_KHR_present_wait the present itself can be waited on, otherwise the frame timeline stands in for it.
+        struct FrameTimingSlot
+        {
+            uint64_t Frame = 0;
+            VanKFrameTiming Timing{};
+            bool Presented = false; // has a present id on the current swapchain
+        };
+        std::array<FrameTimingSlot, MAX_FRAMES_IN_FLIGHT * 2> m_FrameTimings{};
+        bool m_PresentWaitSupported = false;
+        bool m_InheritedQueriesSupported = false; // secondaries may run while the frame's statistics query is active
+        bool m_LowLatency = false;
 
         bool framebufferResized = false;
         bool vSync = false;
         bool sceneImageInitialized = false;
         VanKRenderOption m_renderOption = {};
+        ImDrawData* m_ImGuiDrawData = nullptr;
 
         //statistic
         vk::raii::QueryPool queryPool = nullptr;
@@ -990,6 +1147,8 @@ namespace VanK
         //change this ? from chapter image view
         void createImageViews();
 
+        void createHeadlessTargets();
+
         void createCommandPool();
 
         void createSceneResources();
@@ -1063,6 +1222,17 @@ namespace VanK
 
         void createSyncObjects();
 
+        void createRenderFinishedSemaphores();
+
+        void waitForFrame(uint64_t frame) const;
+        // presents the image of the frame in timing, recreates the swapchain when it's out of date
+        void present(FrameTimingSlot& timing);
+
+        // the low latency wait, for the present with present wait and for the GPU without
+        void waitForPresent(uint64_t frame);
+        // notes the present time of every tracked frame that has been presented since the last call, doesn't block
+        void updateFrameTimings();
+
         //statisitcs
         void createQueryPool();
         
@@ -1255,6 +1425,26 @@ namespace VanK
     }
 
 
+    inline vk::ShaderStageFlags ConvertToVkShaderStageFlags(VanKShaderStageMask stageFlags)
+    {
+        vk::ShaderStageFlags flags = {};
+        if (stageFlags & VanK_SHADER_STAGE_VERTEX_BIT) flags |= vk::ShaderStageFlagBits::eVertex;
+        if (stageFlags & VanK_SHADER_STAGE_FRAGMENT_BIT) flags |= vk::ShaderStageFlagBits::eFragment;
+        if (stageFlags & VanK_SHADER_STAGE_COMPUTE_BIT) flags |= vk::ShaderStageFlagBits::eCompute;
+        return flags;
+    }
+
+    inline std::vector<vk::PushConstantRange> ConvertPushConstantRanges(const std::vector<VanKPushConstantRange>& ranges)
+    {
+        std::vector<vk::PushConstantRange> vkRanges;
+        vkRanges.reserve(ranges.size());
+        for (const VanKPushConstantRange& range : ranges)
+        {
+            vkRanges.push_back({ .stageFlags = ConvertToVkShaderStageFlags(range.stageFlags), .offset = range.offset, .size = range.size });
+        }
+        return vkRanges;
+    }
+
     inline vk::CompareOp ConvertToVkCompareOp(VanKdepthCompareOp compareOp)
     {
         switch (compareOp)
@@ -26,6 +26,8 @@ namespace VanK
         std::string GetShaderEntryName(vk::ShaderStageFlagBits stage) const;
         virtual const std::string& GetName() const override { return m_Name; };
         const std::string& GetFilePath() const override { return m_FilePath; }
+        // unique for every loaded shader, module handles can come back from the driver after a reload
+        uint64_t GetModuleId() const { return m_ModuleId; }
 
     private:
         std::unordered_map<vk::ShaderStageFlagBits, ShaderStageInfo> loadCachedSpv(
@@ -38,5 +40,8 @@ namespace VanK
         std::string m_Name;
         std::string m_FilePath;
         std::unordered_map<vk::ShaderStageFlagBits, ShaderModuleInfo> m_ShaderModules;
+
+        inline static uint64_t s_NextModuleId = 1;
+        uint64_t m_ModuleId = s_NextModuleId++;
     };
 }
\ No newline at end of file
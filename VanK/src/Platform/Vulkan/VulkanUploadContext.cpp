@@ -0,0 +1,341 @@
+#include "VulkanUploadContext.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+#include "VanK/Core/core.h"
+
+namespace VanK
+{
+    namespace
+    {
+        // keeps every staged block 16 byte aligned inside its page
+        constexpr vk::DeviceSize StagingAlignment = 16;
+
+        vk::DeviceSize AlignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+        {
+            return (value + alignment - 1) & ~(alignment - 1);
+        }
+
+        bool Overlaps(const vk::BufferCopy& a, const vk::BufferCopy& b)
+        {
+            return a.dstOffset < b.dstOffset + b.size && b.dstOffset < a.dstOffset + a.size;
+        }
+    }
+
+    VulkanUploadContext::VulkanUploadContext(vk::raii::Device& device, vk::raii::Queue& queue, uint32_t queueFamilyIndex, utils::ResourceAllocator& allocator)
+        : m_Device(device), m_Queue(queue), m_Allocator(allocator)
+    {
+        vk::SemaphoreTypeCreateInfo timelineInfo
+        {
+            .semaphoreType = vk::SemaphoreType::eTimeline,
+            .initialValue = 0
+        };
+        m_Timeline = vk::raii::Semaphore(m_Device, vk::SemaphoreCreateInfo{.pNext = &timelineInfo});
+        DBG_VK_NAME(*m_Timeline);
+
+        vk::CommandPoolCreateInfo poolInfo
+        {
+            .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer | vk::CommandPoolCreateFlagBits::eTransient,
+            .queueFamilyIndex = queueFamilyIndex
+        };
+        m_CommandPool = vk::raii::CommandPool(m_Device, poolInfo);
+        DBG_VK_NAME(*m_CommandPool);
+    }
+
+    VulkanUploadContext::~VulkanUploadContext()
+    {
+        // the owner waited for the device, every page is free to go
+        for (StagingPage& page : m_Pages)
+        {
+            if (page.Buffer.buffer)
+                m_Allocator.destroyBuffer(page.Buffer);
+        }
+    }
+
+    void VulkanUploadContext::Stage(vk::Buffer dstBuffer, vk::DeviceSize dstOffset, const void* data, vk::DeviceSize size)
+    {
+        if (size == 0)
+            return;
+
+        VK_CORE_ASSERT(dstBuffer && data, "Upload without a destination buffer or data");
+
+        std::scoped_lock lock(m_Mutex);
+        uint32_t pageIndex = AcquirePage(size);
+        StagingPage& page = m_Pages[pageIndex];
+        std::memcpy(page.Mapped + page.Head, data, size);
+
+        m_PendingCopies.push_back({ pageIndex, dstBuffer, vk::BufferCopy{ .srcOffset = page.Head, .dstOffset = dstOffset, .size = size } });
+        page.Head = AlignUp(page.Head + size, StagingAlignment);
+        m_StagedBytes += size;
+    }
+
+    void VulkanUploadContext::BeginFrame(const vk::raii::CommandBuffer& cmd)
+    {
+        std::scoped_lock lock(m_Mutex);
+        Retire();
+
+        if (m_PendingCopies.empty())
+            return;
+
+        // staging memory is not guaranteed to be host coherent
+        for (uint32_t pageIndex : m_BatchPages)
+            vmaFlushAllocation(m_Allocator, m_Pages[pageIndex].Buffer.allocation, 0, m_Pages[pageIndex].Head);
+
+        uint64_t value = ++m_TimelineValue;
+        if (m_Mode == SubmitMode::Inline)
+        {
+            RecordCopies(cmd);
+            m_FrameSignalValue = value;
+        }
+        else
+        {
+            SubmitCopies();
+        }
+
+        for (uint32_t pageIndex : m_BatchPages)
+        {
+            m_Pages[pageIndex].RetireValue = value;
+            m_InFlightPages.push_back(pageIndex);
+        }
+        m_BatchPages.clear();
+        m_CurrentPage = UINT32_MAX;
+        m_PendingCopies.clear();
+        m_StagedBytes = 0;
+        m_Batches++;
+    }
+
+    uint64_t VulkanUploadContext::TakeFrameSignalValue()
+    {
+        return std::exchange(m_FrameSignalValue, 0);
+    }
+
+    VulkanUploadContext::Stats VulkanUploadContext::GetStats() const
+    {
+        std::scoped_lock lock(m_Mutex);
+        Stats stats{};
+        stats.StagedBytes = m_StagedBytes;
+        stats.PendingRegions = static_cast<uint32_t>(m_PendingCopies.size());
+        stats.PagesInFlight = static_cast<uint32_t>(m_InFlightPages.size());
+        stats.Batches = m_Batches;
+        for (const StagingPage& page : m_Pages)
+        {
+            if (!page.Buffer.buffer)
+                continue;
+            stats.StagingPages++;
+            stats.StagingCapacity += page.Buffer.size;
+        }
+        return stats;
+    }
+
+    uint32_t VulkanUploadContext::AcquirePage(vk::DeviceSize size)
+    {
+        if (m_CurrentPage != UINT32_MAX && m_Pages[m_CurrentPage].Head + size <= m_Pages[m_CurrentPage].Buffer.size)
+            return m_CurrentPage;
+
+        // A full page stays part of the batch until it is recorded. Free pages are reused when large enough,
+        // an upload bigger than a page gets a page of its own that is released again once it retires.
+        uint32_t pageIndex = UINT32_MAX;
+        uint32_t emptySlot = UINT32_MAX;
+        for (size_t i = 0; i < m_FreePages.size(); i++)
+        {
+            StagingPage& page = m_Pages[m_FreePages[i]];
+            if (!page.Buffer.buffer)
+            {
+                if (emptySlot == UINT32_MAX)
+                    emptySlot = static_cast<uint32_t>(i);
+                continue;
+            }
+            if (page.Buffer.size >= size)
+            {
+                pageIndex = m_FreePages[i];
+                m_FreePages.erase(m_FreePages.begin() + i);
+                break;
+            }
+        }
+
+        if (pageIndex == UINT32_MAX)
+        {
+            if (emptySlot != UINT32_MAX)
+            {
+                pageIndex = m_FreePages[emptySlot];
+                m_FreePages.erase(m_FreePages.begin() + emptySlot);
+            }
+            else
+            {
+                pageIndex = static_cast<uint32_t>(m_Pages.size());
+                m_Pages.emplace_back();
+            }
+
+            StagingPage& page = m_Pages[pageIndex];
+            page.Buffer = m_Allocator.createBuffer
+            (
+                std::max(StagingPageSize, AlignUp(size, StagingAlignment)),
+                vk::BufferUsageFlagBits2::eTransferSrc,
+                VMA_MEMORY_USAGE_CPU_TO_GPU,
+                VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT
+            );
+            DBG_VK_NAME(page.Buffer.buffer);
+
+            VmaAllocationInfo allocationInfo{};
+            vmaGetAllocationInfo(m_Allocator, page.Buffer.allocation, &allocationInfo);
+            page.Mapped = static_cast<uint8_t*>(allocationInfo.pMappedData);
+        }
+
+        m_Pages[pageIndex].Head = 0;
+        m_BatchPages.push_back(pageIndex);
+        m_CurrentPage = pageIndex;
+        return pageIndex;
+    }
+
+    void VulkanUploadContext::Retire()
+    {
+        uint64_t completed = m_Timeline.getCounterValue();
+
+        std::erase_if(m_InFlightPages, [&](uint32_t pageIndex)
+        {
+            StagingPage& page = m_Pages[pageIndex];
+            if (page.RetireValue > completed)
+                return false;
+
+            if (page.Buffer.size > StagingPageSize)
+            {
+                m_Allocator.destroyBuffer(page.Buffer);
+                page = {};
+            }
+            page.Head = 0;
+            m_FreePages.push_back(pageIndex);
+            return true;
+        });
+    }
+
+    void VulkanUploadContext::RecordCopies(const vk::raii::CommandBuffer& cmd)
+    {
+        // Whatever read or wrote the destinations before has to be done, the copies are visible to everything after.
+        // Upload is for setup data so two global barriers per batch are cheaper than tracking every range.
+        const vk::MemoryBarrier2 beforeCopy
+        {
+            .srcStageMask = vk::PipelineStageFlagBits2::eAllCommands,
+            .srcAccessMask = vk::AccessFlagBits2::eMemoryWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eTransfer,
+            .dstAccessMask = vk::AccessFlagBits2::eTransferWrite
+        };
+        cmd.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &beforeCopy});
+
+        std::vector<PendingCopy> copies = m_PendingCopies;
+        std::stable_sort(copies.begin(), copies.end(), [](const PendingCopy& a, const PendingCopy& b)
+        {
+            if (a.Dst != b.Dst)
+                return a.Dst < b.Dst;
+            return a.Region.dstOffset < b.Region.dstOffset;
+        });
+
+        bool overlapping = false;
+        for (size_t i = 1; i < copies.size() && !overlapping; i++)
+            overlapping = copies[i].Dst == copies[i - 1].Dst && Overlaps(copies[i].Region, copies[i - 1].Region);
+
+        if (overlapping)
+        {
+            // later uploads of the same bytes have to win, so keep the staging order and serialize the writes
+            const vk::MemoryBarrier2 betweenCopies
+            {
+                .srcStageMask = vk::PipelineStageFlagBits2::eTransfer,
+                .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+                .dstStageMask = vk::PipelineStageFlagBits2::eTransfer,
+                .dstAccessMask = vk::AccessFlagBits2::eTransferWrite
+            };
+            for (size_t i = 0; i < m_PendingCopies.size(); i++)
+            {
+                if (i > 0)
+                    cmd.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &betweenCopies});
+                const PendingCopy& copy = m_PendingCopies[i];
+                cmd.copyBuffer(m_Pages[copy.Page].Buffer.buffer, copy.Dst, copy.Region);
+            }
+        }
+        else
+        {
+            // one copy command per staging page and destination, back to back regions merged
+            std::stable_sort(copies.begin(), copies.end(), [](const PendingCopy& a, const PendingCopy& b)
+            {
+                if (a.Page != b.Page)
+                    return a.Page < b.Page;
+                if (a.Dst != b.Dst)
+                    return a.Dst < b.Dst;
+                return a.Region.dstOffset < b.Region.dstOffset;
+            });
+
+            std::vector<vk::BufferCopy> regions;
+            for (size_t first = 0; first < copies.size();)
+            {
+                size_t last = first;
+                regions.clear();
+                regions.push_back(copies[first].Region);
+                while (++last < copies.size() && copies[last].Page == copies[first].Page && copies[last].Dst == copies[first].Dst)
+                {
+                    const vk::BufferCopy& region = copies[last].Region;
+                    vk::BufferCopy& previous = regions.back();
+                    if (previous.srcOffset + previous.size == region.srcOffset && previous.dstOffset + previous.size == region.dstOffset)
+                        previous.size += region.size;
+                    else
+                        regions.push_back(region);
+                }
+
+                cmd.copyBuffer(m_Pages[copies[first].Page].Buffer.buffer, copies[first].Dst, regions);
+                first = last;
+            }
+        }
+
+        const vk::MemoryBarrier2 afterCopy
+        {
+            .srcStageMask = vk::PipelineStageFlagBits2::eTransfer,
+            .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eAllCommands,
+            .dstAccessMask = vk::AccessFlagBits2::eMemoryRead | vk::AccessFlagBits2::eMemoryWrite
+        };
+        cmd.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &afterCopy});
+    }
+
+    void VulkanUploadContext::SubmitCopies()
+    {
+        // The device has one queue, so the batch goes to it ahead of the frame. Submission order on the same queue
+        // makes the barriers in RecordCopies cover the frames before and after, no semaphore wait is needed.
+        uint64_t completed = m_Timeline.getCounterValue();
+        auto it = std::ranges::find_if(m_Submissions, [&](const QueueSubmission& submission) { return submission.RetireValue <= completed; });
+        if (it == m_Submissions.end())
+        {
+            vk::CommandBufferAllocateInfo allocInfo
+            {
+                .commandPool = *m_CommandPool,
+                .level = vk::CommandBufferLevel::ePrimary,
+                .commandBufferCount = 1
+            };
+            m_Submissions.push_back({ std::move(vk::raii::CommandBuffers(m_Device, allocInfo).front()), 0 });
+            DBG_VK_NAME(*m_Submissions.back().CommandBuffer);
+            it = std::prev(m_Submissions.end());
+        }
+
+        QueueSubmission& submission = *it;
+        submission.RetireValue = m_TimelineValue;
+        submission.CommandBuffer.reset();
+        submission.CommandBuffer.begin({.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+        RecordCopies(submission.CommandBuffer);
+        submission.CommandBuffer.end();
+
+        const vk::TimelineSemaphoreSubmitInfo timelineInfo
+        {
+            .signalSemaphoreValueCount = 1,
+            .pSignalSemaphoreValues = &m_TimelineValue
+        };
+        const vk::SubmitInfo submitInfo
+        {
+            .pNext = &timelineInfo,
+            .commandBufferCount = 1,
+            .pCommandBuffers = &*submission.CommandBuffer,
+            .signalSemaphoreCount = 1,
+            .pSignalSemaphores = &*m_Timeline
+        };
+        m_Queue.submit(submitInfo);
+    }
+}
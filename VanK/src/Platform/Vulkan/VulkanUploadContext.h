@@ -0,0 +1,109 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "VulkanRendererAPI.h"
+
+namespace VanK
+{
+    /*--
+     * Staged uploads for StorageBuffer::Upload().
+     * Data is copied into persistently mapped staging pages right away. The copies into the destination buffers are
+     * batched and recorded once per frame, either inline at the top of the frame command buffer or on a command buffer
+     * of their own that is submitted ahead of the frame. Every batch signals a timeline semaphore value and its staging
+     * pages are recycled once the semaphore has passed it, nothing here ever waits for the queue to go idle.
+     * Stage() may be called from any thread, BeginFrame() and TakeFrameSignalValue() only from the render thread.
+    -*/
+    class VulkanUploadContext
+    {
+    public:
+        enum class SubmitMode
+        {
+            Inline, // recorded into the frame command buffer, retires with the frame
+            Queue   // own command buffer and submit, retires on its own timeline value
+        };
+
+        struct Stats
+        {
+            uint64_t StagedBytes;     // waiting for the next batch
+            uint32_t PendingRegions;
+            uint32_t StagingPages;
+            uint64_t StagingCapacity;
+            uint32_t PagesInFlight;
+            uint64_t Batches;
+        };
+
+        static constexpr vk::DeviceSize StagingPageSize = 4ull * 1024 * 1024;
+
+        VulkanUploadContext(vk::raii::Device& device, vk::raii::Queue& queue, uint32_t queueFamilyIndex, utils::ResourceAllocator& allocator);
+        ~VulkanUploadContext();
+
+        // copies data into staging memory, the GPU copy happens with the next batch
+        void Stage(vk::Buffer dstBuffer, vk::DeviceSize dstOffset, const void* data, vk::DeviceSize size);
+
+        // Called once per frame right after the frame command buffer began. Recycles finished pages and flushes
+        // everything staged so far, inline into cmd or as a separate submit depending on the mode.
+        void BeginFrame(const vk::raii::CommandBuffer& cmd);
+
+        // timeline value the frame submit has to signal, 0 when the frame carries no uploads
+        uint64_t TakeFrameSignalValue();
+        vk::Semaphore GetTimelineSemaphore() const { return *m_Timeline; }
+
+        void SetSubmitMode(SubmitMode mode) { m_Mode = mode; }
+        SubmitMode GetSubmitMode() const { return m_Mode; }
+
+        Stats GetStats() const;
+
+    private:
+        struct StagingPage
+        {
+            utils::Buffer Buffer;
+            uint8_t* Mapped = nullptr;
+            vk::DeviceSize Head = 0;
+            uint64_t RetireValue = 0; // timeline value of the last batch reading this page
+        };
+
+        struct PendingCopy
+        {
+            uint32_t Page;
+            vk::Buffer Dst;
+            vk::BufferCopy Region;
+        };
+
+        struct QueueSubmission
+        {
+            vk::raii::CommandBuffer CommandBuffer = nullptr;
+            uint64_t RetireValue = 0;
+        };
+
+        uint32_t AcquirePage(vk::DeviceSize size);
+        void Retire();
+        void RecordCopies(const vk::raii::CommandBuffer& cmd);
+        void SubmitCopies();
+
+        mutable std::mutex m_Mutex; // guards the pages and pending copies between Stage() and BeginFrame()
+
+        vk::raii::Device& m_Device;
+        vk::raii::Queue& m_Queue;
+        utils::ResourceAllocator& m_Allocator;
+        SubmitMode m_Mode = SubmitMode::Inline;
+
+        vk::raii::Semaphore m_Timeline = nullptr;
+        uint64_t m_TimelineValue = 0;     // last value handed to a batch
+        uint64_t m_FrameSignalValue = 0;  // inline batch waiting for the frame submit
+
+        vk::raii::CommandPool m_CommandPool = nullptr;
+        std::vector<QueueSubmission> m_Submissions;
+
+        std::vector<StagingPage> m_Pages;
+        std::vector<uint32_t> m_FreePages;
+        std::vector<uint32_t> m_InFlightPages;
+        std::vector<uint32_t> m_BatchPages; // pages written since the last batch
+        uint32_t m_CurrentPage = UINT32_MAX;
+
+        std::vector<PendingCopy> m_PendingCopies;
+        uint64_t m_StagedBytes = 0;
+        uint64_t m_Batches = 0;
+    };
+}
@@ -10,7 +10,9 @@
 #include <SDL3/SDL_filesystem.h>
 #include <SDL3/SDL_timer.h>
 
+#include "JobSystem.h"
 #include "Log.h"
+#include "Timer.h"
 #include "VanK/ImGui/ImGuiLayer.h"
 #include "VanK/Renderer/Renderer.h"
 
@@ -18,6 +20,23 @@ namespace VanK
 {
     static Application* s_Application = nullptr;
 
+    // the events the renderer's input to present latency is measured from
+    static bool IsInputEvent(Uint32 type)
+    {
+        switch (type)
+        {
+        case SDL_EVENT_KEY_DOWN:
+        case SDL_EVENT_KEY_UP:
+        case SDL_EVENT_MOUSE_MOTION:
+        case SDL_EVENT_MOUSE_BUTTON_DOWN:
+        case SDL_EVENT_MOUSE_BUTTON_UP:
+        case SDL_EVENT_MOUSE_WHEEL:
+            return true;
+        default:
+            return false;
+        }
+    }
+
     Application::Application(const ApplicationSpecification& specification) : m_Specification(specification)
     {
         s_Application = this;
@@ -27,9 +46,13 @@ namespace VanK
 
         m_Window = std::make_shared<Window>(m_Specification.WindowSpec);
         
-        m_Window->initWindow();
+        // headless keeps the window object for its size but never opens it
+        if (!m_Specification.Headless)
+            m_Window->initWindow();
 
-        Renderer::Init(*m_Window);
+        JobSystem::Init();
+        Renderer::Init(*m_Window, m_Specification.RenderThreadQueueDepth, m_Specification.FramesInFlight,
+                       m_Specification.Headless);
 
         /*// ImGui
         PushLayer<ImGuiLayer>();*/
@@ -38,6 +61,7 @@ namespace VanK
     Application::~Application()
     {
         Renderer::Shutdown();
+        JobSystem::Shutdown();
         
         m_Window->Destroy();
 
@@ -54,9 +78,10 @@ namespace VanK
         for (const std::unique_ptr<Layer>& layer : m_LayerStack)
             layer->OnUpdate(timestep);
 
-        // NOTE: rendering can be done elsewhere (eg. render thread)
+        // builds the frame, recording and submission happen on the render thread unless its queue depth is 0
         for (const std::unique_ptr<Layer>& layer : m_LayerStack)
             layer->OnRender();
+        m_FrameCount++;
     }
 
     Application& Application::Get()
@@ -65,24 +90,20 @@ namespace VanK
         return *s_Application;
     }
 
-    void Application::SubmitToMainThread(const std::function<void()>& function)
+    void Application::SubmitToMainThread(UniqueFunction<void()> function)
     {
-        std::scoped_lock<std::mutex> lock(m_MainThreadQueueMutex);
-        
-        m_MainThreadQueue.emplace_back(function);
+        m_MainThreadQueue.Emplace(std::move(function));
     }
 
     void Application::ExecuteMainThreadQueue()
     {
-        std::vector<std::function<void()>> copy;
+        // tasks run in place inside their queue node, one that posts again lands behind the others
+        Timer timer;
+        while (m_MainThreadQueue.ConsumeOne([](UniqueFunction<void()>& function) { function(); }))
         {
-            std::scoped_lock<std::mutex> lock(m_MainThreadQueueMutex);
-            copy = m_MainThreadQueue;
-            m_MainThreadQueue.clear();
+            if (timer.ElapsedMillis() >= m_Specification.MainThreadQueueBudgetMillis)
+                break;
         }
-        
-        for (auto& func : copy)
-            func();
     }
     
     extern "C" {
@@ -115,14 +136,18 @@ namespace VanK
             applicationState->app->ExecuteMainThreadQueue();
             applicationState->app->Run(*applicationState);
             
-            return SDL_APP_CONTINUE;
+            return applicationState->app->ReachedMaxFrames() ? SDL_APP_SUCCESS : SDL_APP_CONTINUE;
         }
 
         SDL_AppResult SDL_AppEvent(void* appstate, SDL_Event* event)
         {
             auto applicationState = static_cast<AppState*>(appstate);
 
-            ImGui_ImplSDL3_ProcessEvent(event);
+            // headless never initializes ImGui's SDL backend
+            if (!RenderCommand::IsHeadless())
+                ImGui_ImplSDL3_ProcessEvent(event);
+            if (IsInputEvent(event->type))
+                Renderer::OnInputEvent(event->common.timestamp);
 
             switch (event->type)
             {
@@ -1,11 +1,11 @@
 #pragma once
-#include <functional>
 #include <memory>
-#include <mutex>
 #include <string>
 #include <vector>
 
 #include "Layer.h"
+#include "MpscQueue.h"
+#include "UniqueFunction.h"
 #include "VanK/Core/Window.h"
 
 namespace VanK
@@ -16,6 +16,16 @@ namespace VanK
     {
         std::string Name = "Application";
         WindowSpecification WindowSpec;
+        // frames the main thread may queue for the render thread, 0 renders inside SDL_AppIterate
+        uint32_t RenderThreadQueueDepth = 1;
+        // frames the GPU may have queued, can be changed at runtime through RenderCommand::SetFramesInFlight
+        uint32_t FramesInFlight = 2;
+        // time ExecuteMainThreadQueue may spend per frame, the rest waits for the next one (at least one task runs)
+        float MainThreadQueueBudgetMillis = 2.0f;
+        // no window or swapchain, frames are rendered offscreen at WindowSpec's size (benchmarks, tests, lavapipe)
+        bool Headless = false;
+        // quits after this many frames, 0 runs until the app is closed
+        uint64_t MaxFrames = 0;
     };
 
     struct AppState
@@ -52,19 +62,21 @@ namespace VanK
         }
         
         static Application& Get();
-        void SubmitToMainThread(const std::function<void()>& function);
+        // any thread, the task runs at the start of a later frame on the main thread
+        void SubmitToMainThread(UniqueFunction<void()> function);
         void ExecuteMainThreadQueue();
+        bool ReachedMaxFrames() const { return m_Specification.MaxFrames != 0 && m_FrameCount >= m_Specification.MaxFrames; }
         static float GetTime();
         static std::string GetExecutableRootPath();
         std::shared_ptr<Window> getWindow() { return m_Window; }
     private:
-        std::vector<std::function<void()>> m_MainThreadQueue;
-        std::mutex m_MainThreadQueueMutex;
+        MpscQueue<UniqueFunction<void()>> m_MainThreadQueue;
         
         ApplicationSpecification m_Specification;
         std::shared_ptr<Window> m_Window;
 
         std::vector<std::unique_ptr<Layer>> m_LayerStack;
+        uint64_t m_FrameCount = 0;
     };
     
     extern Application* CreateApplication();
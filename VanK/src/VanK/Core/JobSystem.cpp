@@ -0,0 +1,373 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "Log.h"
+#include "Timer.h"
+#include "core.h"
+
+namespace VanK
+{
+    namespace
+    {
+        // which system's worker the current thread is, if any
+        struct WorkerContext
+        {
+            const JobSystem* System = nullptr;
+            uint32_t Index = 0;
+        };
+        thread_local WorkerContext t_Worker;
+
+        // picks the first victim to steal from, so idle workers don't all hammer the same deque
+        uint32_t NextRandom()
+        {
+            thread_local uint32_t state = static_cast<uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id())) | 1u;
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return state;
+        }
+    }
+
+    bool JobSystem::WorkerQueue::Push(Job* job)
+    {
+        const int64_t bottom = m_Bottom.load(std::memory_order_relaxed);
+        const int64_t top = m_Top.load(std::memory_order_acquire);
+        if (bottom - top >= Capacity)
+            return false;
+
+        m_Jobs[bottom & (Capacity - 1)].store(job, std::memory_order_relaxed);
+        m_Bottom.store(bottom + 1, std::memory_order_release); // publishes the job to thieves
+        return true;
+    }
+
+    JobSystem::Job* JobSystem::WorkerQueue::Pop()
+    {
+        const int64_t bottom = m_Bottom.load(std::memory_order_relaxed) - 1;
+        m_Bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = m_Top.load(std::memory_order_relaxed);
+
+        if (top > bottom)
+        {
+            m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        Job* job = m_Jobs[bottom & (Capacity - 1)].load(std::memory_order_relaxed);
+        if (top == bottom)
+        {
+            // the last job, a thief may be taking it right now
+            if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                job = nullptr;
+            m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+
+    JobSystem::Job* JobSystem::WorkerQueue::Steal()
+    {
+        int64_t top = m_Top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t bottom = m_Bottom.load(std::memory_order_acquire);
+        if (top >= bottom)
+            return nullptr;
+
+        Job* job = m_Jobs[top & (Capacity - 1)].load(std::memory_order_relaxed);
+        if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr; // lost the race to the owner or another thief
+        return job;
+    }
+
+    JobSystem::JobSystem(uint32_t threadCount)
+    {
+        if (threadCount == 0)
+            threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+        const uint32_t workerCount = threadCount - 1;
+        for (uint32_t i = 0; i < workerCount; i++)
+            m_Queues.push_back(std::make_unique<WorkerQueue>());
+
+        // the queues have to be complete before the first worker goes looking for something to steal
+        m_Workers.reserve(workerCount);
+        for (uint32_t i = 0; i < workerCount; i++)
+            m_Workers.emplace_back([this, i] { workerLoop(i); });
+    }
+
+    JobSystem::~JobSystem()
+    {
+        m_Stop.store(true);
+        m_WorkEpoch.fetch_add(1);
+        m_WorkEpoch.notify_all();
+        m_Workers.clear();
+
+        // workers finish what is queued before they exit, without workers it is done here
+        while (Job* job = findJob())
+            execute(job);
+    }
+
+    void JobSystem::Init()
+    {
+        s_Instance = std::make_unique<JobSystem>();
+        VK_CORE_INFO("Job system: {} threads", s_Instance->GetThreadCount());
+    }
+
+    void JobSystem::Shutdown()
+    {
+        s_Instance.reset();
+    }
+
+    JobSystem& JobSystem::Get()
+    {
+        VK_CORE_ASSERT(s_Instance, "JobSystem::Init has not been called");
+        return *s_Instance;
+    }
+
+    void JobSystem::Run(std::function<void()> job, JobCounter* counter)
+    {
+        if (counter)
+            counter->m_Pending.fetch_add(1, std::memory_order_relaxed);
+        push(new Job{std::move(job), counter});
+    }
+
+    void JobSystem::RunAfter(const JobCounter& dependency, std::function<void()> job, JobCounter* counter)
+    {
+        if (dependency.IsDone())
+        {
+            Run(std::move(job), counter);
+            return;
+        }
+        Run([this, &dependency, job = std::move(job)]
+        {
+            Wait(dependency);
+            job();
+        }, counter);
+    }
+
+    void JobSystem::Wait(const JobCounter& counter)
+    {
+        while (!counter.IsDone())
+        {
+            if (Job* job = findJob())
+            {
+                execute(job);
+                continue;
+            }
+
+            // the epoch changes when a job is pushed or a counter finishes, read it before looking once more
+            const uint32_t epoch = m_WorkEpoch.load();
+            if (counter.IsDone())
+                break;
+            if (Job* job = findJob())
+            {
+                execute(job);
+                continue;
+            }
+            m_Sleeping.fetch_add(1);
+            m_WorkEpoch.wait(epoch);
+            m_Sleeping.fetch_sub(1);
+        }
+    }
+
+    void JobSystem::ParallelFor(uint32_t count, uint32_t minRange, const std::function<void(uint32_t begin, uint32_t end)>& fn)
+    {
+        if (count == 0)
+            return;
+
+        // a few ranges per thread, so stealing can even out ranges that take longer
+        minRange = std::max(minRange, 1u);
+        const uint32_t ranges = std::min((count + minRange - 1) / minRange, GetThreadCount() * 4);
+        auto rangeBegin = [count, ranges](uint32_t range)
+        {
+            return static_cast<uint32_t>(static_cast<uint64_t>(count) * range / ranges);
+        };
+
+        JobCounter counter;
+        for (uint32_t range = 1; range < ranges; range++)
+            Run([&fn, &rangeBegin, range] { fn(rangeBegin(range), rangeBegin(range + 1)); }, &counter);
+        fn(0, rangeBegin(1));
+        Wait(counter);
+    }
+
+    void JobSystem::workerLoop(uint32_t worker)
+    {
+        t_Worker = {this, worker};
+
+        while (true)
+        {
+            if (Job* job = findJob())
+            {
+                execute(job);
+                continue;
+            }
+
+            const uint32_t epoch = m_WorkEpoch.load();
+            if (Job* job = findJob())
+            {
+                execute(job);
+                continue;
+            }
+            if (m_Stop.load())
+                break;
+            m_Sleeping.fetch_add(1);
+            m_WorkEpoch.wait(epoch);
+            m_Sleeping.fetch_sub(1);
+        }
+
+        t_Worker = {};
+    }
+
+    void JobSystem::push(Job* job)
+    {
+        if (t_Worker.System == this)
+        {
+            // a full deque means plenty of queued work already, running this one now is as good
+            if (!m_Queues[t_Worker.Index]->Push(job))
+            {
+                execute(job);
+                return;
+            }
+        }
+        else
+        {
+            std::scoped_lock lock(m_SharedMutex);
+            m_SharedQueue.push_back(job);
+            m_SharedCount.fetch_add(1, std::memory_order_release);
+        }
+
+        m_WorkEpoch.fetch_add(1);
+        if (m_Sleeping.load() > 0)
+            m_WorkEpoch.notify_one();
+    }
+
+    JobSystem::Job* JobSystem::findJob()
+    {
+        const bool isWorker = t_Worker.System == this;
+        if (isWorker)
+        {
+            if (Job* job = m_Queues[t_Worker.Index]->Pop())
+                return job;
+        }
+
+        if (m_SharedCount.load(std::memory_order_acquire) > 0)
+        {
+            std::scoped_lock lock(m_SharedMutex);
+            if (!m_SharedQueue.empty())
+            {
+                Job* job = m_SharedQueue.front();
+                m_SharedQueue.pop_front();
+                m_SharedCount.fetch_sub(1, std::memory_order_relaxed);
+                return job;
+            }
+        }
+
+        const uint32_t queueCount = static_cast<uint32_t>(m_Queues.size());
+        if (queueCount == 0)
+            return nullptr;
+        const uint32_t first = NextRandom() % queueCount;
+        for (uint32_t i = 0; i < queueCount; i++)
+        {
+            const uint32_t victim = (first + i) % queueCount;
+            if (isWorker && victim == t_Worker.Index)
+                continue;
+            if (Job* job = m_Queues[victim]->Steal())
+                return job;
+        }
+        return nullptr;
+    }
+
+    void JobSystem::execute(Job* job)
+    {
+        job->Function();
+
+        JobCounter* counter = job->Counter;
+        delete job;
+        if (counter && counter->m_Pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            // the waiter may return and destroy the counter right away, so only the system's epoch is touched
+            m_WorkEpoch.fetch_add(1);
+            if (m_Sleeping.load() > 0)
+                m_WorkEpoch.notify_all();
+        }
+    }
+
+    void JobSystem::RunBenchmark()
+    {
+        const uint32_t maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+        std::vector<uint32_t> threadCounts;
+        for (uint32_t threads = 1; threads < maxThreads; threads *= 2)
+            threadCounts.push_back(threads);
+        threadCounts.push_back(maxThreads);
+
+        // arithmetic over a large array, and many tiny jobs spawned from a job so they have to be stolen
+        constexpr uint32_t elementCount = 1 << 22;
+        constexpr uint32_t smallJobCount = 1 << 16;
+        constexpr uint32_t iterations = 5;
+        std::vector<float> values(elementCount);
+        std::atomic<uint64_t> checksum = 0;
+
+        auto best = [](auto&& fn)
+        {
+            float bestMillis = std::numeric_limits<float>::max();
+            for (uint32_t it = 0; it < iterations; it++)
+            {
+                Timer timer;
+                fn();
+                bestMillis = std::min(bestMillis, timer.ElapsedMillis());
+            }
+            return bestMillis;
+        };
+
+        float baseParallelFor = 0.0f;
+        float baseSmallJobs = 0.0f;
+        for (uint32_t threads : threadCounts)
+        {
+            JobSystem system(threads);
+
+            float parallelFor = best([&]
+            {
+                system.ParallelFor(elementCount, 4096, [&values](uint32_t begin, uint32_t end)
+                {
+                    for (uint32_t i = begin; i < end; i++)
+                    {
+                        float x = static_cast<float>(i) * 0.001f;
+                        for (int step = 0; step < 16; step++)
+                            x = std::sqrt(x * x + 1.0f) * 0.5f;
+                        values[i] = x;
+                    }
+                });
+            });
+
+            float smallJobs = best([&]
+            {
+                JobCounter counter;
+                system.Run([&]
+                {
+                    for (uint32_t job = 0; job < smallJobCount; job++)
+                    {
+                        system.Run([&checksum, job]
+                        {
+                            uint32_t hash = job;
+                            for (int step = 0; step < 64; step++)
+                                hash = hash * 1664525u + 1013904223u;
+                            checksum.fetch_add(hash, std::memory_order_relaxed);
+                        }, &counter);
+                    }
+                }, &counter);
+                system.Wait(counter);
+            });
+
+            if (threads == 1)
+            {
+                baseParallelFor = parallelFor;
+                baseSmallJobs = smallJobs;
+            }
+            VK_CORE_INFO("[Jobs] {:>2} threads | parallel for {:8.3f} ms ({:5.2f}x) | {} small jobs {:8.3f} ms ({:5.2f}x, {:.0f} ns/job)",
+                         threads, parallelFor, baseParallelFor / parallelFor, smallJobCount, smallJobs, baseSmallJobs / smallJobs,
+                         smallJobs * 1.0e6f / smallJobCount);
+        }
+        VK_CORE_INFO("[Jobs] checksum {}, {}", values[elementCount / 2], checksum.load());
+    }
+}
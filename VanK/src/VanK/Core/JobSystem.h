@@ -0,0 +1,103 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace VanK
+{
+    // Counts the jobs started with it that haven't finished, JobSystem::Wait on it is the fence between dependent work
+    class JobCounter
+    {
+    public:
+        bool IsDone() const { return m_Pending.load(std::memory_order_acquire) == 0; }
+
+    private:
+        friend class JobSystem;
+        std::atomic<uint32_t> m_Pending = 0;
+    };
+
+    /*--
+     * Work stealing job scheduler. Every worker owns a deque, it pushes and pops jobs at the bottom and idle workers
+     * steal from the top, so work spawned by a job stays on its thread while it is busy and spreads when it isn't.
+     * Threads that are not workers (main, render) push into a shared queue. A thread waiting on a counter runs jobs
+     * until the counter is done instead of blocking, jobs may start and wait on other jobs.
+    -*/
+    class JobSystem
+    {
+    public:
+        // threadCount counts the thread that waits, 1 runs every job inside Wait, 0 uses every hardware thread
+        explicit JobSystem(uint32_t threadCount = 0);
+        ~JobSystem();
+
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        // the engine's scheduler, lives from Application construction to its destruction
+        static void Init();
+        static void Shutdown();
+        static JobSystem& Get();
+
+        void Run(std::function<void()> job, JobCounter* counter = nullptr);
+        // runs job once dependency is done, the worker that picks it up helps with the remaining work meanwhile
+        void RunAfter(const JobCounter& dependency, std::function<void()> job, JobCounter* counter = nullptr);
+        void Wait(const JobCounter& counter);
+
+        // Splits [0, count) into ranges of at least minRange elements and calls fn(begin, end) for each of them,
+        // returns when all are done. The calling thread takes a range too.
+        void ParallelFor(uint32_t count, uint32_t minRange, const std::function<void(uint32_t begin, uint32_t end)>& fn);
+
+        // workers plus the thread that waits
+        uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_Workers.size()) + 1; }
+
+        // Runs the same workloads on 1 to N threads and logs the time and speedup of each
+        static void RunBenchmark();
+
+    private:
+        struct Job
+        {
+            std::function<void()> Function;
+            JobCounter* Counter;
+        };
+
+        // Chase-Lev deque (Le et al., "Correct and Efficient Work-Stealing for Weak Memory Models"). Fixed size,
+        // Push fails when it is full and the owner runs the job itself.
+        class WorkerQueue
+        {
+        public:
+            bool Push(Job* job);
+            Job* Pop();   // owner only
+            Job* Steal(); // any thread
+
+        private:
+            static constexpr int64_t Capacity = 4096;
+            alignas(64) std::atomic<int64_t> m_Top = 0;
+            alignas(64) std::atomic<int64_t> m_Bottom = 0;
+            std::unique_ptr<std::atomic<Job*>[]> m_Jobs = std::make_unique<std::atomic<Job*>[]>(Capacity);
+        };
+
+        void workerLoop(uint32_t worker);
+        void push(Job* job);
+        Job* findJob();
+        void execute(Job* job);
+
+        std::vector<std::unique_ptr<WorkerQueue>> m_Queues; // one per worker
+        std::vector<std::jthread> m_Workers;
+
+        // jobs pushed by threads that aren't workers
+        std::mutex m_SharedMutex;
+        std::deque<Job*> m_SharedQueue;
+        std::atomic<uint32_t> m_SharedCount = 0;
+
+        // bumped for every new job, idle workers sleep on it
+        std::atomic<uint32_t> m_WorkEpoch = 0;
+        std::atomic<uint32_t> m_Sleeping = 0;
+        std::atomic<bool> m_Stop = false;
+
+        inline static std::unique_ptr<JobSystem> s_Instance;
+    };
+}
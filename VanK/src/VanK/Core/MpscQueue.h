@@ -0,0 +1,95 @@
+#pragma once
+#include <atomic>
+#include <utility>
+
+namespace VanK
+{
+    /*--
+     * Unbounded multi-producer, single-consumer queue (Vyukov's intrusive node queue). Pushing is one exchange and
+     * one store, no thread ever waits on another. Values are constructed in their node and handed to the consumer in
+     * place, nothing is copied or moved on the way through.
+     * A producer interrupted between its two steps hides what was pushed after it until it resumes, the consumer
+     * then sees an empty queue and picks those up on a later call.
+    -*/
+    template<typename T>
+    class MpscQueue
+    {
+    public:
+        MpscQueue() = default;
+        ~MpscQueue()
+        {
+            while (ConsumeOne([](T&) {}))
+            {
+            }
+        }
+
+        MpscQueue(const MpscQueue&) = delete;
+        MpscQueue& operator=(const MpscQueue&) = delete;
+
+        // any thread
+        template<typename... TArgs>
+        void Emplace(TArgs&&... args)
+        {
+            pushNode(new Node(std::forward<TArgs>(args)...));
+        }
+
+        // Consumer thread only: calls fn with the oldest value and destroys it afterwards, false when there is none
+        template<typename Fn>
+        bool ConsumeOne(Fn&& fn)
+        {
+            NodeBase* tail = m_Tail;
+            NodeBase* next = tail->Next.load(std::memory_order_acquire);
+            if (tail == &m_Stub)
+            {
+                if (!next)
+                    return false;
+                m_Tail = next;
+                tail = next;
+                next = next->Next.load(std::memory_order_acquire);
+            }
+
+            if (!next)
+            {
+                // tail is the last node, unless a producer has swapped the head but not linked its node yet
+                if (tail != m_Head.load(std::memory_order_acquire))
+                    return false;
+                // the stub goes behind it so tail can be taken without leaving the queue without a node
+                pushNode(&m_Stub);
+                next = tail->Next.load(std::memory_order_acquire);
+                if (!next)
+                    return false;
+            }
+
+            m_Tail = next;
+            Node* node = static_cast<Node*>(tail);
+            fn(node->Value);
+            delete node;
+            return true;
+        }
+
+    private:
+        struct NodeBase
+        {
+            std::atomic<NodeBase*> Next = nullptr;
+        };
+
+        struct Node : NodeBase
+        {
+            template<typename... TArgs>
+            explicit Node(TArgs&&... args) : Value(std::forward<TArgs>(args)...) {}
+
+            T Value;
+        };
+
+        void pushNode(NodeBase* node)
+        {
+            node->Next.store(nullptr, std::memory_order_relaxed);
+            NodeBase* previous = m_Head.exchange(node, std::memory_order_acq_rel);
+            previous->Next.store(node, std::memory_order_release);
+        }
+
+        NodeBase m_Stub;
+        alignas(64) std::atomic<NodeBase*> m_Head = &m_Stub; // producers
+        alignas(64) NodeBase* m_Tail = &m_Stub;             // consumer
+    };
+}
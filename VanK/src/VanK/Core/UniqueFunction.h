@@ -0,0 +1,127 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace VanK
+{
+    template<typename Signature, std::size_t InlineSize = 48>
+    class UniqueFunction;
+
+    /*--
+     * Move-only std::function. Callables up to InlineSize bytes that can be moved without throwing live inside the
+     * object, bigger ones on the heap. Being move-only it takes lambdas that capture unique_ptrs and never copies
+     * the captures of the ones it holds.
+    -*/
+    template<typename R, typename... Args, std::size_t InlineSize>
+    class UniqueFunction<R(Args...), InlineSize>
+    {
+        static_assert(InlineSize >= sizeof(void*), "the inline buffer has to fit the heap pointer");
+
+    public:
+        UniqueFunction() = default;
+        UniqueFunction(std::nullptr_t) {}
+
+        template<typename F>
+        requires(!std::is_same_v<std::remove_cvref_t<F>, UniqueFunction> && std::is_invocable_r_v<R, std::decay_t<F>&, Args...>)
+        UniqueFunction(F&& function)
+        {
+            using Stored = std::decay_t<F>;
+            if constexpr (StoredInline<Stored>)
+                ::new (static_cast<void*>(m_Storage)) Stored(std::forward<F>(function));
+            else
+                *reinterpret_cast<Stored**>(m_Storage) = new Stored(std::forward<F>(function));
+            m_Ops = &s_Ops<Stored>;
+        }
+
+        UniqueFunction(UniqueFunction&& other) noexcept { moveFrom(other); }
+
+        UniqueFunction& operator=(UniqueFunction&& other) noexcept
+        {
+            if (this != &other)
+            {
+                Reset();
+                moveFrom(other);
+            }
+            return *this;
+        }
+
+        UniqueFunction(const UniqueFunction&) = delete;
+        UniqueFunction& operator=(const UniqueFunction&) = delete;
+
+        ~UniqueFunction() { Reset(); }
+
+        R operator()(Args... args) { return m_Ops->Invoke(m_Storage, std::forward<Args>(args)...); }
+        explicit operator bool() const { return m_Ops != nullptr; }
+
+        void Reset()
+        {
+            if (m_Ops)
+            {
+                m_Ops->Destroy(m_Storage);
+                m_Ops = nullptr;
+            }
+        }
+
+    private:
+        struct Ops
+        {
+            R (*Invoke)(void* storage, Args&&... args);
+            void (*Move)(void* dst, void* src); // leaves src empty
+            void (*Destroy)(void* storage);
+        };
+
+        template<typename F>
+        static constexpr bool StoredInline = sizeof(F) <= InlineSize && alignof(F) <= alignof(std::max_align_t)
+            && std::is_nothrow_move_constructible_v<F>;
+
+        template<typename F>
+        static F* target(void* storage)
+        {
+            if constexpr (StoredInline<F>)
+                return std::launder(static_cast<F*>(storage));
+            else
+                return *static_cast<F**>(storage);
+        }
+
+        template<typename F>
+        inline static constexpr Ops s_Ops =
+        {
+            .Invoke = [](void* storage, Args&&... args) -> R
+            {
+                return std::invoke(*target<F>(storage), std::forward<Args>(args)...);
+            },
+            .Move = [](void* dst, void* src)
+            {
+                if constexpr (StoredInline<F>)
+                {
+                    ::new (dst) F(std::move(*target<F>(src)));
+                    target<F>(src)->~F();
+                }
+                else
+                    *static_cast<F**>(dst) = *static_cast<F**>(src);
+            },
+            .Destroy = [](void* storage)
+            {
+                if constexpr (StoredInline<F>)
+                    target<F>(storage)->~F();
+                else
+                    delete target<F>(storage);
+            }
+        };
+
+        void moveFrom(UniqueFunction& other)
+        {
+            if (!other.m_Ops)
+                return;
+            other.m_Ops->Move(m_Storage, other.m_Storage);
+            m_Ops = other.m_Ops;
+            other.m_Ops = nullptr;
+        }
+
+        alignas(std::max_align_t) std::byte m_Storage[InlineSize];
+        const Ops* m_Ops = nullptr;
+    };
+}
@@ -24,6 +24,7 @@ namespace VanK
 
     public:
         virtual SDL_Window* getWindowHandle() { return window; }
+        const WindowSpecification& getSpecification() const { return m_Specification; }
     private:
         WindowSpecification m_Specification;
         
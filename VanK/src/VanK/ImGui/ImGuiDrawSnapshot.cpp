@@ -0,0 +1,64 @@
+#include "ImGuiDrawSnapshot.h"
+
+#include <cstring>
+
+namespace VanK
+{
+    namespace
+    {
+        // ImVector's assignment frees and reallocates, resize keeps the capacity of the last capture
+        template<typename T>
+        void CopyVector(ImVector<T>& dst, const ImVector<T>& src)
+        {
+            dst.resize(src.Size);
+            if (src.Size > 0)
+                std::memcpy(dst.Data, src.Data, static_cast<size_t>(src.Size) * sizeof(T));
+        }
+
+        bool HasPendingTextures(const ImVector<ImTextureData*>* textures)
+        {
+            if (!textures)
+                return false;
+            for (const ImTextureData* texture : *textures)
+            {
+                if (texture->Status != ImTextureStatus_OK)
+                    return true;
+            }
+            return false;
+        }
+    }
+
+    void ImGuiDrawSnapshot::Capture(const ImDrawData& drawData)
+    {
+        while (m_DrawLists.size() < static_cast<size_t>(drawData.CmdLists.Size))
+            m_DrawLists.emplace_back(IM_NEW(ImDrawList)(nullptr));
+
+        m_DrawData.CmdLists.resize(0);
+        for (int i = 0; i < drawData.CmdLists.Size; i++)
+        {
+            const ImDrawList& src = *drawData.CmdLists[i];
+            ImDrawList& dst = *m_DrawLists[i];
+            CopyVector(dst.CmdBuffer, src.CmdBuffer);
+            CopyVector(dst.IdxBuffer, src.IdxBuffer);
+            CopyVector(dst.VtxBuffer, src.VtxBuffer);
+            dst.Flags = src.Flags;
+            m_DrawData.CmdLists.push_back(&dst);
+        }
+
+        m_DrawData.Valid = drawData.Valid;
+        m_DrawData.CmdListsCount = m_DrawData.CmdLists.Size;
+        m_DrawData.TotalIdxCount = drawData.TotalIdxCount;
+        m_DrawData.TotalVtxCount = drawData.TotalVtxCount;
+        m_DrawData.DisplayPos = drawData.DisplayPos;
+        m_DrawData.DisplaySize = drawData.DisplaySize;
+        m_DrawData.FramebufferScale = drawData.FramebufferScale;
+        m_DrawData.OwnerViewport = drawData.OwnerViewport;
+        // the renderer skips the texture pass on nullptr, which is every frame once the atlas is uploaded
+        m_DrawData.Textures = HasPendingTextures(drawData.Textures) ? drawData.Textures : nullptr;
+    }
+
+    void ImGuiDrawSnapshot::Clear()
+    {
+        m_DrawData.Clear();
+    }
+}
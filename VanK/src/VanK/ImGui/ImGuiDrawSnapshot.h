@@ -0,0 +1,34 @@
+#pragma once
+#include <memory>
+#include <vector>
+
+#include <imgui.h>
+
+namespace VanK
+{
+    /*--
+     * A copy of ImGui's draw data that stays valid after the next ImGui::NewFrame, so one frame's UI can be rendered
+     * on another thread while the next one is built. The lists are kept between captures and only grow.
+     * Texture requests (font atlas uploads and the like) are not copied, the snapshot points at ImGui's texture list
+     * when there are any and ImGui must not start a new frame before they have been handled.
+    -*/
+    class ImGuiDrawSnapshot
+    {
+    public:
+        void Capture(const ImDrawData& drawData);
+        void Clear();
+
+        // nullptr before the first capture
+        ImDrawData* Get() { return m_DrawData.Valid ? &m_DrawData : nullptr; }
+        bool HasTextureRequests() const { return m_DrawData.Textures != nullptr; }
+
+    private:
+        struct DrawListDeleter
+        {
+            void operator()(ImDrawList* drawList) const { IM_DELETE(drawList); }
+        };
+
+        ImDrawData m_DrawData;
+        std::vector<std::unique_ptr<ImDrawList, DrawListDeleter>> m_DrawLists;
+    };
+}
@@ -34,12 +34,12 @@ namespace VanK
         return nullptr;
     }
 
-    TransferBuffer* TransferBuffer::Create(uint64_t size, VanKTransferBufferUsage usage)
+    TransferBuffer* TransferBuffer::Create(uint64_t regionSize, VanKTransferBufferUsage usage, uint32_t regionCount)
     {
         switch (RendererAPI::GetAPI())
         {
         case RenderAPIType::None: return nullptr;
-        case RenderAPIType::Vulkan: return new VulkanTransferBuffer(size, usage);
+        case RenderAPIType::Vulkan: return new VulkanTransferBuffer(regionSize, usage, regionCount);
         }
         return nullptr;
     }
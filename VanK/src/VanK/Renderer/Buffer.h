@@ -132,9 +132,6 @@ namespace VanK
         virtual uint64_t GetBufferAddress() const override = 0;
         virtual void* GetNativeHandle() const override = 0;
 
-        // Upload for initial setup
-        virtual void Upload(const void* data, size_t size) = 0;
-
         static VertexBuffer* Create(uint64_t size);
     };
 
@@ -150,9 +147,6 @@ namespace VanK
 
         virtual uint32_t GetCount() const = 0;
 
-        // Upload for initial setup
-        virtual void Upload(const void* data, size_t size, size_t offset) = 0;
-        
         static IndexBuffer* Create(uint64_t bufferSize);
     };
 
@@ -185,12 +179,21 @@ namespace VanK
         virtual uint64_t GetBufferAddress() const override = 0;
         virtual void* GetNativeHandle() const override = 0;
 
+        // The buffer is split into regionCount regions of regionSize bytes and a frame only writes its own. BeginFrame
+        // hands the frame being recorded the next region, false while the frame that last wrote it hasn't finished.
+        virtual bool BeginFrame() = 0;
+        virtual uint32_t GetRegionCount() const = 0;
+        virtual uint64_t GetRegionSize() const = 0;
+        // what MapTransferBuffer can still hand out at this alignment in the frame's region
+        virtual uint64_t GetFreeSpace(uint64_t alignment) const = 0;
+
+        // nullptr when the frame's region is full or BeginFrame wasn't called for the frame being recorded
         virtual void* MapTransferBuffer(uint64_t size, uint64_t alignment, uint64_t& outOffset) = 0;
         virtual void UnMapTransferBuffer() = 0;
 
         virtual void UploadToGPUBuffer(VanKCommandBuffer cmd, VanKTransferBufferLocation location, VanKBufferRegion bufferRegion) = 0;
 
-        static TransferBuffer* Create(uint64_t size, VanKTransferBufferUsage usage);
+        static TransferBuffer* Create(uint64_t regionSize, VanKTransferBufferUsage usage, uint32_t regionCount = 1);
     };
 
     class UniformBuffer : public VanKBuffer
@@ -203,8 +206,9 @@ namespace VanK
         virtual uint64_t GetBufferAddress() const override = 0;
         virtual void* GetNativeHandle() const override = 0;
     
-        // Uniform buffers use vkCmdUpdateBuffer (special case)
-        virtual void Update(VanKCommandBuffer cmd, const void* data, size_t size) = 0;
+        // Written straight into host visible memory, every Update() lands in a fresh slot of the current frame,
+        // so bind (or read the address) after the update it should see
+        virtual void Update(const void* data, size_t size) = 0;
 
         static UniformBuffer* Create(uint64_t size);
     };
@@ -219,7 +223,7 @@ namespace VanK
         virtual uint64_t GetBufferAddress() const override = 0;
         virtual void* GetNativeHandle() const override = 0;
 
-        // Upload - for initial setup (creates its own command buffer)
+        // Upload for initial setup, staged and copied at the start of the next frame
         virtual void Upload(const void* data, size_t size, size_t offset) = 0;
 
         static StorageBuffer* Create(uint64_t size);
@@ -235,8 +239,8 @@ namespace VanK
         virtual uint64_t GetBufferAddress() const override = 0;
         virtual void* GetNativeHandle() const override = 0;
 
-        // Upload - for initial setup (creates its own command buffer)
-        virtual void Upload(const void* data, size_t size, size_t offset) = 0;
+        // Readback of GPU written data (counts, stats), only valid once the frame that wrote it has finished
+        virtual void Read(void* data, size_t size, size_t offset) const = 0;
 
         static IndirectBuffer* Create(uint64_t size);
     };
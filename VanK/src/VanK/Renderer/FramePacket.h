@@ -0,0 +1,66 @@
+#pragma once
+#include <array>
+#include <functional>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Geometry.h"
+#include "RenderQueue.h"
+#include "VanK/ImGui/ImGuiDrawSnapshot.h"
+
+namespace VanK
+{
+    /*--
+     * Everything the render thread needs for one frame. The main thread fills it after updating the layers and
+     * doesn't touch it again until the render thread is done with it. Scene settings are copied in as the UI left
+     * them, anything that changes GPU objects (swapchain, viewport images, geometry) goes into Commands instead
+     * of being called from the UI.
+    -*/
+    struct FramePacket
+    {
+        Extent2D ViewportSize = {1, 1};
+        glm::mat4 View = glm::mat4(1.0f);
+        glm::mat4 Proj = glm::mat4(1.0f);
+        glm::vec3 CameraPosition = glm::vec3(0.0f);
+        float CameraDistance = 0.0f;
+        float LodErrorScale = 0.0f; // error of 1 model unit at distance 1, in pixels
+        float LodThreshold = 1.0f;
+        bool LodEnabled = true;
+        bool MeshletCulling = true;
+        bool ParallelRecording = true;
+        bool LowLatency = false;
+        uint64_t InputNs = 0; // SDL timestamp of the oldest input event this frame is the first to see, 0 without input
+
+        // run in order on the render thread before the frame is recorded
+        std::vector<std::function<void()>> Commands;
+        ImGuiDrawSnapshot UI;
+    };
+
+    // from SDL receiving an input event to the frame that first saw it being submitted and presented
+    struct LatencyStats
+    {
+        float InputToSubmitMillis = 0.0f;
+        float InputToPresentMillis = 0.0f;
+        uint32_t Frames = 0;
+    };
+
+    // What the render thread saw while rendering its last frame, the UI shows the latest one
+    struct FrameStats
+    {
+        shaderio::MeshletCullStats Meshlets = {};
+        Geometry::Stats GeometryBuffers = {};
+        bool BackgroundCompaction = false;
+        uint64_t TransferRingCapacity = 0;
+        uint32_t RetiredBuffers = 0;
+        VanKPipelineCacheStats Pipelines = {};
+        VanKCommandStats Commands = {};
+        RenderQueue::Stats Queue = {};
+        uint32_t RecordingThreads = 0;
+        uint32_t FramesInFlight = 0;
+        uint64_t RecordingFrame = 0;
+        uint64_t CompletedFrame = 0;
+        std::array<LatencyStats, 2> Latency = {}; // default, low latency
+        bool PresentWait = false;
+    };
+}
@@ -1,73 +1,362 @@
 #include "Geometry.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include "Renderer.h"
+#include "VanK/Core/Log.h"
 
 namespace VanK
 {
-    void Geometry::AppendGeometry(const std::string& name, const std::vector<shaderio::InstancedVertexData>& vertices,
-              std::vector<uint32_t> indices)
+    namespace
     {
-        // 1. Remember current offsets
-        uint32_t vertexOffset = CurrentVertexOffset;
-        uint32_t indexOffset  = CurrentIndexOffset;
-
-        // 2. Adjust indices so they reference the correct vertex range
-        for (auto& idx : indices)
-            idx += vertexOffset;
-
-        // 3. Upload vertices into the big vertex buffer
-        /*Renderer::m_InstancedVertexBuffer->Upload
-        (
-            vertices.data(),
-            vertices.size() * sizeof(shaderio::InstancedVertexData),
-            vertexOffset * sizeof(shaderio::InstancedVertexData)   // write at the correct offset
-        );*/
-
-        // Save offset + count
-        Renderer::InstancedVertexRanges[name] = { vertexOffset, static_cast<uint32_t>(vertices.size()) };
-
-        // 4. Upload indices into the big index buffer
-        Renderer::m_InstancedIndexBuffer->Upload
-        (
-            indices.data(),
-            indices.size() * sizeof(uint32_t),
-            indexOffset * sizeof(uint32_t)  // write at the correct offset
-        );
-
-        // Save offset + count
-        Renderer::InstancedIndexRanges[name] = { indexOffset, static_cast<uint32_t>(indices.size()) };
-
-        // 5. Advance global offsets for the next geometry
-        CurrentVertexOffset += static_cast<uint32_t>(vertices.size());
-        CurrentIndexOffset  += static_cast<uint32_t>(indices.size());
+        OffsetAllocator::Allocation AllocateOrGrow(OffsetAllocator& allocator, uint32_t size)
+        {
+            OffsetAllocator::Allocation allocation = allocator.Allocate(size);
+            while (!allocation.IsValid())
+            {
+                // grown space merges with a free range at the end; the extra eighth covers the
+                // allocator rounding the request up to the next bin
+                uint32_t capacity = allocator.GetCapacity();
+                allocator.Grow(capacity + std::max(capacity / 2, size + size / 8 + 1));
+                allocation = allocator.Allocate(size);
+            }
+            return allocation;
+        }
+
+        // uploads as much of data[uploaded..] as the budget allows, dstElement is where data[0] lives in the target
+        template<typename T>
+        void UploadElements(VanKCommandBuffer cmd, const std::vector<T>& data, uint32_t& uploaded, uint32_t dstElement,
+                            VanKBuffer* target, uint64_t& budget)
+        {
+            // alignment padding may have eaten into the ring region, what doesn't fit goes next frame
+            uint64_t space = std::min(budget, Renderer::m_TransferRingBuffer->GetFreeSpace(alignof(T)));
+            uint32_t count = static_cast<uint32_t>(std::min<uint64_t>(data.size() - uploaded, space / sizeof(T)));
+            if (count == 0)
+                return;
+
+            uint64_t offset;
+            const uint64_t dataSize = static_cast<uint64_t>(count) * sizeof(T);
+            void* dataPtr = Renderer::m_TransferRingBuffer->MapTransferBuffer(dataSize, alignof(T), offset);
+            if (!dataPtr)
+                return;
+            memcpy(dataPtr, data.data() + uploaded, dataSize);
+            Renderer::m_TransferRingBuffer->UnMapTransferBuffer();
+            Renderer::m_TransferRingBuffer->UploadToGPUBuffer(cmd, VanKTransferBufferLocation{.offset = offset},
+                VanKBufferRegion{.buffer = target, .offset = (static_cast<uint64_t>(dstElement) + uploaded) * sizeof(T), .size = dataSize});
+
+            uploaded += count;
+            budget -= dataSize;
+        }
+
+        uint64_t IndexElementBytes(VanKIndexElementSize indexType)
+        {
+            return indexType == VanKIndexElementSize::Uint16 ? sizeof(uint16_t) : sizeof(uint32_t);
+        }
+
+        const char* IndexElementName(VanKIndexElementSize indexType)
+        {
+            return indexType == VanKIndexElementSize::Uint16 ? "16 bit" : "32 bit";
+        }
+    }
+
+    void Geometry::Init(uint32_t vertexCapacity, uint32_t indexCapacity)
+    {
+        m_VertexAllocator = OffsetAllocator(vertexCapacity);
+        Renderer::m_InstancedVertexBuffer.Init(static_cast<uint64_t>(vertexCapacity) * sizeof(shaderio::InstancedVertexData));
+
+        for (VanKIndexElementSize indexType : { VanKIndexElementSize::Uint16, VanKIndexElementSize::Uint32 })
+        {
+            IndexPool& pool = m_IndexPools[static_cast<size_t>(indexType)];
+            pool.Allocator = OffsetAllocator(indexCapacity);
+            pool.Buffer.Init(indexCapacity * IndexElementBytes(indexType));
+        }
+    }
+
+    void Geometry::Shutdown()
+    {
+        for (const GeometryRange& range : m_Ranges)
+            MeshRegistry::Destroy(range.Mesh);
+        m_Ranges.clear();
+        m_PendingUploads.clear();
+
+        m_VertexAllocator = OffsetAllocator();
+        Renderer::m_InstancedVertexBuffer.Reset();
+        for (IndexPool& pool : m_IndexPools)
+        {
+            pool.Allocator = OffsetAllocator();
+            pool.Buffer.Reset();
+        }
+        m_InstanceAllocator = OffsetAllocator();
+        m_InstanceRanges.clear();
+    }
+
+    MeshHandle Geometry::AppendGeometry(const std::string& name, std::span<const shaderio::InstancedVertexData> vertices,
+                                  std::span<const uint32_t> indices)
+    {
+        if (vertices.empty() || indices.empty())
+        {
+            VK_CORE_WARN("Geometry '{}' has no vertices or indices, not appended", name);
+            return {};
+        }
+        // an index past the vertices would read another mesh's range, and one above 65535 would wrap when narrowed
+        if (auto outOfRange = std::ranges::find_if(indices, [&](uint32_t index) { return index >= vertices.size(); }); outOfRange != indices.end())
+        {
+            VK_CORE_ERROR("Geometry '{}' index {} is out of range of its {} vertices, not appended", name, *outOfRange, vertices.size());
+            return {};
+        }
+
+        if (!name.empty())
+            RemoveGeometry(MeshRegistry::Find(name));
+
+        GeometryRange range;
+        range.Mesh = MeshRegistry::Create(name);
+        range.VertexCount = static_cast<uint32_t>(vertices.size());
+        range.IndexCount = static_cast<uint32_t>(indices.size());
+        range.Vertices = AllocateOrGrow(m_VertexAllocator, range.VertexCount);
+        range.PendingVertices.assign(vertices.begin(), vertices.end());
+
+        // indices are local to the allocation, so its vertex count alone decides whether they fit 16 bits (all of them
+        // were checked against it above). A model is one allocation, see Renderer::registerModel.
+        if (vertices.size() <= 0x10000)
+        {
+            range.IndexType = VanKIndexElementSize::Uint16;
+            range.PendingIndices16.reserve(indices.size());
+            for (uint32_t index : indices)
+                range.PendingIndices16.push_back(static_cast<uint16_t>(index));
+        }
+        else
+        {
+            range.PendingIndices32.assign(indices.begin(), indices.end());
+        }
+        range.Indices = AllocateOrGrow(m_IndexPools[static_cast<size_t>(range.IndexType)].Allocator, range.IndexCount);
+
+        PublishRange(range);
+        MeshHandle mesh = range.Mesh;
+        if (m_Ranges.size() <= mesh.Index)
+            m_Ranges.resize(mesh.Index + 1);
+        m_Ranges[mesh.Index] = std::move(range);
+        m_PendingUploads.push_back(mesh);
+        return mesh;
+    }
+
+    void Geometry::RemoveGeometry(MeshHandle mesh)
+    {
+        if (!MeshRegistry::IsValid(mesh) || mesh.Index >= m_Ranges.size() || m_Ranges[mesh.Index].Mesh != mesh)
+            return;
+        GeometryRange& range = m_Ranges[mesh.Index];
+
+        // freed space may be handed out again right away, uploads into it are ordered after
+        // earlier frames' reads by the barrier in UploadToGPUBuffer
+        m_VertexAllocator.Free(range.Vertices);
+        m_IndexPools[static_cast<size_t>(range.IndexType)].Allocator.Free(range.Indices);
+        std::erase(m_PendingUploads, mesh);
+        FreeInstances(mesh.Index);
+
+        range = {};
+        MeshRegistry::Destroy(mesh);
+    }
+
+    void Geometry::Flush(VanKCommandBuffer cmd, uint64_t uploadBudget)
+    {
+        GrowBuffers(cmd);
+        UploadPending(cmd, uploadBudget);
+
+        if (m_BackgroundCompaction && m_PendingUploads.empty())
+            Compact(cmd);
+    }
+
+    Geometry::Stats Geometry::GetStats()
+    {
+        Stats stats{};
+        stats.Vertices = m_VertexAllocator.GetStats();
+        stats.Indices16 = m_IndexPools[static_cast<size_t>(VanKIndexElementSize::Uint16)].Allocator.GetStats();
+        stats.Indices32 = m_IndexPools[static_cast<size_t>(VanKIndexElementSize::Uint32)].Allocator.GetStats();
+        stats.Instances = m_InstanceAllocator.GetStats();
+        for (MeshHandle mesh : m_PendingUploads)
+        {
+            const GeometryRange& range = m_Ranges[mesh.Index];
+            stats.PendingUploadBytes += (range.PendingVertices.size() - range.UploadedVertices) * sizeof(shaderio::InstancedVertexData);
+            stats.PendingUploadBytes += (range.PendingIndices16.size() + range.PendingIndices32.size() - range.UploadedIndices) *
+                IndexElementBytes(range.IndexType);
+        }
+        stats.Growths = m_Growths;
+        stats.CompactionMoves = m_CompactionMoves;
+        return stats;
+    }
+
+    void Geometry::GrowBuffers(VanKCommandBuffer cmd)
+    {
+        // the allocators already grew geometrically, the buffers follow them exactly
+        constexpr uint64_t vertexBytes = sizeof(shaderio::InstancedVertexData);
+        uint64_t vertexCapacity = Renderer::m_InstancedVertexBuffer.GetCapacity() / vertexBytes;
+        if (Renderer::m_InstancedVertexBuffer.Resize(cmd, m_VertexAllocator.GetCapacity() * vertexBytes))
+        {
+            VK_CORE_INFO("Grew geometry vertex buffer from {} to {} vertices", vertexCapacity, m_VertexAllocator.GetCapacity());
+            m_Growths++;
+        }
+
+        for (VanKIndexElementSize indexType : { VanKIndexElementSize::Uint16, VanKIndexElementSize::Uint32 })
+        {
+            IndexPool& pool = m_IndexPools[static_cast<size_t>(indexType)];
+            uint64_t elementBytes = IndexElementBytes(indexType);
+            uint64_t indexCapacity = pool.Buffer.GetCapacity() / elementBytes;
+            if (pool.Buffer.Resize(cmd, pool.Allocator.GetCapacity() * elementBytes))
+            {
+                VK_CORE_INFO("Grew {} geometry index buffer from {} to {} indices", IndexElementName(indexType), indexCapacity, pool.Allocator.GetCapacity());
+                m_Growths++;
+            }
+        }
+    }
+
+    void Geometry::UploadPending(VanKCommandBuffer cmd, uint64_t uploadBudget)
+    {
+        // oldest first, a range larger than the budget is spread over several frames
+        while (!m_PendingUploads.empty())
+        {
+            GeometryRange& range = m_Ranges[m_PendingUploads.front().Index];
+
+            UploadElements(cmd, range.PendingVertices, range.UploadedVertices, range.Vertices.Offset, Renderer::m_InstancedVertexBuffer.get(), uploadBudget);
+            IndexBuffer* indexBuffer = m_IndexPools[static_cast<size_t>(range.IndexType)].Buffer.get();
+            if (range.IndexType == VanKIndexElementSize::Uint16)
+                UploadElements(cmd, range.PendingIndices16, range.UploadedIndices, range.Indices.Offset, indexBuffer, uploadBudget);
+            else
+                UploadElements(cmd, range.PendingIndices32, range.UploadedIndices, range.Indices.Offset, indexBuffer, uploadBudget);
+
+            size_t pendingIndexCount = range.PendingIndices16.size() + range.PendingIndices32.size();
+            if (range.UploadedVertices < range.PendingVertices.size() || range.UploadedIndices < pendingIndexCount)
+                return;
+
+            range.PendingVertices = {};
+            range.PendingIndices16 = {};
+            range.PendingIndices32 = {};
+            range.UploadedVertices = 0;
+            range.UploadedIndices = 0;
+            m_PendingUploads.pop_front();
+        }
+    }
+
+    void Geometry::Compact(VanKCommandBuffer cmd)
+    {
+        // Moves the range at the highest offset into a hole below it. The allocator prefers the smallest bin that
+        // fits, so holes are found before the big free range at the end and the used space drifts to the front.
+        // inPool filters the ranges that live in the allocator, index ranges are split by width
+        auto moveHighest = [&](OffsetAllocator& allocator, OffsetAllocator::Allocation GeometryRange::* allocation,
+                               uint32_t GeometryRange::* count, VanKBuffer& buffer, uint64_t stride, auto inPool) -> bool
+        {
+            GeometryRange* highest = nullptr;
+            for (GeometryRange& range : m_Ranges)
+            {
+                if (range.Mesh.IsValid() && range.IsUploaded() && inPool(range) &&
+                    (!highest || (range.*allocation).Offset > (highest->*allocation).Offset))
+                    highest = &range;
+            }
+            if (!highest)
+                return false;
+
+            OffsetAllocator::Allocation target = allocator.Allocate(highest->*count);
+            if (!target.IsValid() || target.Offset > (highest->*allocation).Offset)
+            {
+                allocator.Free(target);
+                return false;
+            }
+
+            // both ranges are allocated during the copy, so they can't overlap
+            RenderCommand::CopyBuffer(cmd, buffer, (highest->*allocation).Offset * stride, buffer, target.Offset * stride, (highest->*count) * stride);
+            allocator.Free(highest->*allocation);
+            highest->*allocation = target;
+            PublishRange(*highest);
+            m_CompactionMoves++;
+            return true;
+        };
+
+        for (uint32_t move = 0; move < CompactionMovesPerFrame; move++)
+        {
+            bool moved = moveHighest(m_VertexAllocator, &GeometryRange::Vertices, &GeometryRange::VertexCount,
+                                     *Renderer::m_InstancedVertexBuffer, sizeof(shaderio::InstancedVertexData), [](const GeometryRange&) { return true; });
+
+            for (VanKIndexElementSize indexType : { VanKIndexElementSize::Uint16, VanKIndexElementSize::Uint32 })
+            {
+                IndexPool& pool = m_IndexPools[static_cast<size_t>(indexType)];
+                moved |= moveHighest(pool.Allocator, &GeometryRange::Indices, &GeometryRange::IndexCount, *pool.Buffer,
+                                     IndexElementBytes(indexType), [indexType](const GeometryRange& range) { return range.IndexType == indexType; });
+            }
+
+            if (!moved)
+                break;
+        }
+    }
+
+    void Geometry::PublishRange(const GeometryRange& range)
+    {
+        MeshRecord& record = MeshRegistry::Get(range.Mesh);
+        record.VertexOffset = range.Vertices.Offset;
+        record.VertexCount = range.VertexCount;
+        record.IndexOffset = range.Indices.Offset;
+        record.IndexCount = range.IndexCount;
+        record.IndexType = range.IndexType;
     }
     
-    void Geometry::AppendGeometryData(VanKCommandBuffer cmd, const std::string& name, const std::vector<shaderio::InstancedStorageData>& data)
+    void Geometry::AppendGeometryData(VanKCommandBuffer cmd, MeshHandle mesh, const std::vector<shaderio::InstancedStorageData>& data)
     {
         if (data.empty()) return;
 
-        if (Renderer::InstancedDataRanges.empty())
-            CurrentStorageOffset = 0;
+        MeshRecord* record = MeshRegistry::TryGet(mesh);
+        if (!record)
+        {
+            VK_CORE_WARN("AppendGeometryData: stale mesh handle {}:{}", mesh.Index, mesh.Generation);
+            return;
+        }
 
-        uint32_t offset = CurrentStorageOffset;
+        if (m_InstanceRanges.size() <= mesh.Index)
+            m_InstanceRanges.resize(mesh.Index + 1);
+        // the slot may still hold the range of a mesh that was destroyed without going through RemoveGeometry
+        if (m_InstanceRanges[mesh.Index].Mesh != mesh)
+            FreeInstances(mesh.Index);
+        InstanceRange& range = m_InstanceRanges[mesh.Index];
 
-        // Upload to GPU at the correct offset
-        UploadBufferToGpuWithTransferRing(cmd, Renderer::m_TransferRingBuffer, Renderer::m_InstancedStorageBuffer, data, shaderio::InstancedStorageData, offset);
+        constexpr uint64_t elementBytes = sizeof(shaderio::InstancedStorageData);
+        const uint32_t count = range.Count + static_cast<uint32_t>(data.size());
+        OffsetAllocator::Allocation target = AllocateOrGrow(m_InstanceAllocator, count);
 
-        // Check if this name already exists in the ranges
-        if (Renderer::InstancedDataRanges.find(name) != Renderer::InstancedDataRanges.end())
+        // the buffer follows the allocator like the geometry buffers, every live range is kept when it grows
+        Renderer::m_InstancedStorageBuffer.Resize(cmd, m_InstanceAllocator.GetCapacity() * elementBytes);
+        if (range.Count > 0)
         {
-            // If name exists, append to existing range (extend the count)
-            auto& existingRange = Renderer::InstancedDataRanges[name];
-            existingRange.second += static_cast<uint32_t>(data.size());  // Add to count
+            // both ranges are allocated during the copy, so they can't overlap
+            RenderCommand::CopyBuffer(cmd, *Renderer::m_InstancedStorageBuffer, range.Instances.Offset * elementBytes,
+                                      *Renderer::m_InstancedStorageBuffer, target.Offset * elementBytes, range.Count * elementBytes);
         }
-        else
+        m_InstanceAllocator.Free(range.Instances);
+
+        Renderer::ReserveTransferRing(data.size() * elementBytes);
+        UploadBufferToGpuWithTransferRing(cmd, Renderer::m_TransferRingBuffer, Renderer::m_InstancedStorageBuffer, data, shaderio::InstancedStorageData,
+                                          (static_cast<uint64_t>(target.Offset) + range.Count) * elementBytes);
+
+        range.Mesh = mesh;
+        range.Instances = target;
+        range.Count = count;
+        record->InstanceOffset = target.Offset;
+        record->InstanceCount = count;
+    }
+
+    void Geometry::ClearGeometryData(MeshHandle mesh)
+    {
+        if (mesh.Index < m_InstanceRanges.size() && m_InstanceRanges[mesh.Index].Mesh == mesh)
+            FreeInstances(mesh.Index);
+        if (MeshRecord* record = MeshRegistry::TryGet(mesh))
         {
-            // If name doesn't exist, create new range
-            Renderer::InstancedDataRanges[name] = { offset, static_cast<uint32_t>(data.size()) };
+            record->InstanceOffset = 0;
+            record->InstanceCount = 0;
         }
-        
-        // Advance global offset for next batch
-        CurrentStorageOffset += static_cast<uint32_t>(data.size());
+    }
+
+    void Geometry::FreeInstances(uint32_t slot)
+    {
+        if (slot >= m_InstanceRanges.size())
+            return;
+        // freed space may be reused by the next append, its upload is ordered after earlier reads like the geometry's
+        m_InstanceAllocator.Free(m_InstanceRanges[slot].Instances);
+        m_InstanceRanges[slot] = {};
     }
 }
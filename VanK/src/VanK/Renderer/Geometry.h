@@ -1,10 +1,15 @@
 #pragma once
+#include <deque>
+#include <span>
 #include <string>
 #include <vector>
 #include <glm/glm.hpp>
 
 #include "glm/ext/scalar_constants.hpp"
 #include "glm/gtc/constants.hpp"
+#include "GrowableBuffer.h"
+#include "MeshRegistry.h"
+#include "OffsetAllocator.h"
 #include "RenderCommand.h"
 
 namespace VanK
@@ -15,15 +20,103 @@ namespace VanK
         #include "shaderIO.h"
     }
     
+    // Owns placement inside the shared vertex/index buffers. Ranges come from OffsetAllocators, so geometry can be
+    // removed and its space reused. Indices stay relative to their own vertices, draws pass the vertex range
+    // offset as vertexOffset, which is what lets a range move without rewriting its indices. It also lets
+    // every mesh with at most 65536 vertices keep 16 bit indices, those live in their own index buffer.
     class Geometry
     {
-    private:
-        inline static uint32_t CurrentVertexOffset = 0;
-        inline static uint32_t CurrentIndexOffset  = 0;
-        inline static uint32_t CurrentStorageOffset = 0;
     public:
-        static void AppendGeometry(const std::string& name, const std::vector<shaderio::InstancedVertexData>& vertices, std::vector<uint32_t> indices);
-        static void AppendGeometryData(VanKCommandBuffer cmd, const std::string& name, const std::vector<shaderio::InstancedStorageData>& data);
+        struct Stats
+        {
+            OffsetAllocator::Stats Vertices;
+            OffsetAllocator::Stats Indices16;
+            OffsetAllocator::Stats Indices32;
+            OffsetAllocator::Stats Instances;
+            uint64_t PendingUploadBytes;
+            uint32_t Growths;
+            uint32_t CompactionMoves;
+        };
+
+        // indexCapacity is per index buffer
+        static void Init(uint32_t vertexCapacity, uint32_t indexCapacity);
+        static void Shutdown();
+
+        // Registers a mesh, allocates its ranges and stages the data, Flush uploads it. The record's offsets are
+        // kept current when ranges move. A mesh already registered under the name is removed first.
+        static MeshHandle AppendGeometry(const std::string& name, std::span<const shaderio::InstancedVertexData> vertices, std::span<const uint32_t> indices);
+        static void RemoveGeometry(MeshHandle mesh);
+
+        // Once per frame before anything reads the buffers: grows them if the allocators outgrew them, uploads
+        // at most uploadBudget bytes of staged geometry and, when enabled, moves a few ranges into lower holes.
+        static void Flush(VanKCommandBuffer cmd, uint64_t uploadBudget);
+
+        static void SetBackgroundCompaction(bool enabled) { m_BackgroundCompaction = enabled; }
+        static bool IsBackgroundCompactionEnabled() { return m_BackgroundCompaction; }
+        static Stats GetStats();
+
+        // bind with the record's IndexType, firstIndex and IndexOffset count elements of that width
+        static IndexBuffer& GetIndexBuffer(VanKIndexElementSize indexType) { return *m_IndexPools[static_cast<size_t>(indexType)].Buffer; }
+
+        // Adds instances to the mesh's InstancedStorageData range. The range is sub-allocated like the geometry, a mesh
+        // that already has instances moves to a range that fits all of them. Removing the mesh frees it.
+        static void AppendGeometryData(VanKCommandBuffer cmd, MeshHandle mesh, const std::vector<shaderio::InstancedStorageData>& data);
+        // drops the mesh's instances, the next AppendGeometryData starts a new range
+        static void ClearGeometryData(MeshHandle mesh);
+
+    private:
+        // indexed like the registry slots, Mesh is invalid for slots without geometry
+        struct GeometryRange
+        {
+            MeshHandle Mesh;
+            OffsetAllocator::Allocation Vertices;
+            OffsetAllocator::Allocation Indices;
+            uint32_t VertexCount = 0;
+            uint32_t IndexCount = 0;
+            VanKIndexElementSize IndexType = VanKIndexElementSize::Uint32;
+
+            // staged until Flush has uploaded all of it, the range isn't moved before that.
+            // Only the vector matching IndexType is used.
+            std::vector<shaderio::InstancedVertexData> PendingVertices;
+            std::vector<uint16_t> PendingIndices16;
+            std::vector<uint32_t> PendingIndices32;
+            uint32_t UploadedVertices = 0;
+            uint32_t UploadedIndices = 0;
+
+            bool IsUploaded() const { return PendingVertices.empty() && PendingIndices16.empty() && PendingIndices32.empty(); }
+        };
+
+        // indexed like the registry slots as well, sub meshes without a GeometryRange can have instances too
+        struct InstanceRange
+        {
+            MeshHandle Mesh;
+            OffsetAllocator::Allocation Instances;
+            uint32_t Count = 0;
+        };
+
+        struct IndexPool
+        {
+            OffsetAllocator Allocator;
+            GrowableBuffer<IndexBuffer> Buffer;
+        };
+
+        static void GrowBuffers(VanKCommandBuffer cmd);
+        static void UploadPending(VanKCommandBuffer cmd, uint64_t uploadBudget);
+        static void Compact(VanKCommandBuffer cmd);
+        static void PublishRange(const GeometryRange& range);
+        static void FreeInstances(uint32_t slot);
+
+        static constexpr uint32_t CompactionMovesPerFrame = 4;
+
+        inline static OffsetAllocator m_VertexAllocator;
+        inline static IndexPool m_IndexPools[2]; // indexed by VanKIndexElementSize
+        inline static std::vector<GeometryRange> m_Ranges;
+        inline static OffsetAllocator m_InstanceAllocator; // in InstancedStorageData elements
+        inline static std::vector<InstanceRange> m_InstanceRanges;
+        inline static std::deque<MeshHandle> m_PendingUploads;
+        inline static bool m_BackgroundCompaction = true;
+        inline static uint32_t m_Growths = 0;
+        inline static uint32_t m_CompactionMoves = 0;
     };
 
     namespace GeometryData
@@ -0,0 +1,167 @@
+#include "GlbReader.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <nlohmann/json.hpp>
+
+namespace VanK
+{
+    namespace
+    {
+        constexpr uint32_t GLB_MAGIC = 0x46546C67;      // "glTF"
+        constexpr uint32_t GLB_CHUNK_JSON = 0x4E4F534A; // "JSON"
+        constexpr uint32_t GLB_CHUNK_BIN = 0x004E4942;  // "BIN\0"
+        constexpr uint32_t GLTF_MODE_TRIANGLES = 4;
+
+        struct GlbHeader
+        {
+            uint32_t Magic;
+            uint32_t Version;
+            uint32_t Length;
+        };
+
+        struct GlbChunkHeader
+        {
+            uint32_t Length;
+            uint32_t Type;
+        };
+
+        uint32_t ComponentCount(const std::string& type)
+        {
+            if (type == "SCALAR") return 1;
+            if (type == "VEC2")   return 2;
+            if (type == "VEC3")   return 3;
+            if (type == "VEC4")   return 4;
+            if (type == "MAT2")   return 4;
+            if (type == "MAT3")   return 9;
+            if (type == "MAT4")   return 16;
+            throw std::runtime_error("GLB: unknown accessor type '" + type + "'");
+        }
+    }
+
+    GlbReader::GlbReader(const std::string& path)
+        : m_File(path)
+    {
+        if (!m_File.IsValid())
+            throw std::runtime_error("GLB: failed to map '" + path + "'");
+
+        const uint8_t* data = m_File.Data();
+        const size_t size = m_File.Size();
+
+        GlbHeader header;
+        if (size < sizeof(GlbHeader) + sizeof(GlbChunkHeader))
+            throw std::runtime_error("GLB: file too small");
+        std::memcpy(&header, data, sizeof(header));
+        if (header.Magic != GLB_MAGIC || header.Version != 2 || header.Length > size ||
+            header.Length < sizeof(GlbHeader) + sizeof(GlbChunkHeader))
+            throw std::runtime_error("GLB: invalid header");
+
+        // chunk 0 is always JSON, chunk 1 (optional) is the BIN payload
+        size_t cursor = sizeof(GlbHeader);
+        GlbChunkHeader jsonChunk;
+        std::memcpy(&jsonChunk, data + cursor, sizeof(jsonChunk));
+        cursor += sizeof(GlbChunkHeader);
+        if (jsonChunk.Type != GLB_CHUNK_JSON || jsonChunk.Length > header.Length - cursor)
+            throw std::runtime_error("GLB: first chunk is not JSON");
+        const char* jsonBegin = reinterpret_cast<const char*>(data + cursor);
+        cursor += jsonChunk.Length;
+
+        const uint8_t* bin = nullptr;
+        size_t binSize = 0;
+        if (cursor + sizeof(GlbChunkHeader) <= header.Length)
+        {
+            GlbChunkHeader binChunk;
+            std::memcpy(&binChunk, data + cursor, sizeof(binChunk));
+            cursor += sizeof(GlbChunkHeader);
+            if (binChunk.Type == GLB_CHUNK_BIN && binChunk.Length <= header.Length - cursor)
+            {
+                bin = data + cursor;
+                binSize = binChunk.Length;
+            }
+        }
+
+        // The DOM only holds the JSON chunk and is dropped at the end of the constructor
+        nlohmann::json json = nlohmann::json::parse(jsonBegin, jsonBegin + jsonChunk.Length);
+
+        const nlohmann::json& buffers = json.value("buffers", nlohmann::json::array());
+        for (const auto& buffer : buffers)
+        {
+            if (buffer.contains("uri"))
+                throw std::runtime_error("GLB: external buffers are not supported");
+        }
+
+        struct BufferViewInfo
+        {
+            size_t Offset;
+            size_t Length;
+            size_t Stride;
+        };
+        std::vector<BufferViewInfo> bufferViews;
+        for (const auto& view : json.value("bufferViews", nlohmann::json::array()))
+        {
+            if (view.value("buffer", 0) != 0)
+                throw std::runtime_error("GLB: only the embedded BIN buffer is supported");
+
+            BufferViewInfo info{ view.value("byteOffset", size_t(0)), view.at("byteLength").get<size_t>(), view.value("byteStride", size_t(0)) };
+            if (info.Offset > binSize || info.Length > binSize - info.Offset)
+                throw std::runtime_error("GLB: bufferView out of range of the BIN chunk");
+            bufferViews.push_back(info);
+        }
+
+        for (const auto& accessor : json.value("accessors", nlohmann::json::array()))
+        {
+            if (accessor.contains("sparse") || !accessor.contains("bufferView"))
+                throw std::runtime_error("GLB: sparse accessors are not supported");
+
+            const BufferViewInfo& view = bufferViews.at(accessor.at("bufferView").get<size_t>());
+
+            MeshDecode::AccessorView result;
+            result.Type = static_cast<MeshDecode::ComponentType>(accessor.at("componentType").get<uint32_t>());
+            result.Components = ComponentCount(accessor.at("type").get<std::string>());
+            result.Count = accessor.at("count").get<size_t>();
+            result.Normalized = accessor.value("normalized", false);
+
+            const size_t elementSize = MeshDecode::ComponentSize(result.Type) * result.Components;
+            const size_t accessorOffset = accessor.value("byteOffset", size_t(0));
+            result.ByteStride = view.Stride != 0 ? view.Stride : elementSize;
+
+            // the last element has to end inside the bufferView, checked by division since count and byteOffset
+            // come from the file and the product could wrap
+            if (result.Count > 0)
+            {
+                if (elementSize == 0 || accessorOffset > view.Length || elementSize > view.Length - accessorOffset ||
+                    result.Count - 1 > (view.Length - accessorOffset - elementSize) / result.ByteStride)
+                    throw std::runtime_error("GLB: accessor out of range of its bufferView");
+            }
+
+            result.Data = bin + view.Offset + accessorOffset;
+            m_Accessors.push_back(result);
+        }
+
+        for (const auto& mesh : json.value("meshes", nlohmann::json::array()))
+        {
+            Mesh& outMesh = m_Meshes.emplace_back();
+            outMesh.Name = mesh.value("name", std::string());
+
+            for (const auto& primitive : mesh.at("primitives"))
+            {
+                if (primitive.value("mode", GLTF_MODE_TRIANGLES) != GLTF_MODE_TRIANGLES)
+                    continue;
+
+                const nlohmann::json& attributes = primitive.at("attributes");
+                Primitive& outPrimitive = outMesh.Primitives.emplace_back();
+                outPrimitive.Position = attributes.value("POSITION", -1);
+                outPrimitive.Normal = attributes.value("NORMAL", -1);
+                outPrimitive.TexCoord0 = attributes.value("TEXCOORD_0", -1);
+                outPrimitive.Indices = primitive.value("indices", -1);
+            }
+        }
+    }
+
+    const MeshDecode::AccessorView& GlbReader::GetAccessor(int index) const
+    {
+        if (index < 0 || static_cast<size_t>(index) >= m_Accessors.size())
+            throw std::runtime_error("GLB: accessor index out of range");
+        return m_Accessors[index];
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "MeshDecode.h"
+#include "VanK/Utils.h"
+
+namespace VanK
+{
+    // Minimal GLB reader: the file is memory mapped, only the JSON chunk is parsed and
+    // accessors are returned as views into the mapped BIN chunk (nothing is copied).
+    // Supports what the mesh importer needs: embedded BIN buffer, non-sparse accessors, triangle primitives.
+    class GlbReader
+    {
+    public:
+        struct Primitive
+        {
+            int Position = -1;
+            int Normal = -1;
+            int TexCoord0 = -1;
+            int Indices = -1;
+        };
+
+        struct Mesh
+        {
+            std::string Name;
+            std::vector<Primitive> Primitives;
+        };
+
+        // throws std::runtime_error on malformed or unsupported files
+        explicit GlbReader(const std::string& path);
+
+        const std::vector<Mesh>& GetMeshes() const { return m_Meshes; }
+        const MeshDecode::AccessorView& GetAccessor(int index) const;
+        size_t GetFileSize() const { return m_File.Size(); }
+
+    private:
+        MappedFile m_File;
+        std::vector<MeshDecode::AccessorView> m_Accessors;
+        std::vector<Mesh> m_Meshes;
+    };
+}
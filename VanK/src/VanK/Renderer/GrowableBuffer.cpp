@@ -0,0 +1,21 @@
+#include "GrowableBuffer.h"
+
+namespace VanK
+{
+    void DeferredRelease::Retire(Ref<VanKBuffer> buffer)
+    {
+        if (buffer)
+            m_Retired.push_back({ std::move(buffer), RenderCommand::GetRecordingFrame() });
+    }
+
+    void DeferredRelease::NextFrame()
+    {
+        const uint64_t completedFrame = RenderCommand::GetCompletedFrame();
+        std::erase_if(m_Retired, [completedFrame](const RetiredBuffer& retired) { return retired.LastFrame <= completedFrame; });
+    }
+
+    void DeferredRelease::ReleaseAll()
+    {
+        m_Retired.clear();
+    }
+}
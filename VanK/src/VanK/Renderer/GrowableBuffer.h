@@ -0,0 +1,100 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "Buffer.h"
+#include "RenderCommand.h"
+#include "VanK/Core/core.h"
+
+namespace VanK
+{
+    // Replaced buffers stay alive here until every frame that may still read them has finished on the GPU
+    class DeferredRelease
+    {
+    public:
+        static void Retire(Ref<VanKBuffer> buffer);
+
+        // once per frame, releases what no unfinished frame can read anymore
+        static void NextFrame();
+        // only after the GPU went idle
+        static void ReleaseAll();
+
+        static uint32_t GetPendingCount() { return static_cast<uint32_t>(m_Retired.size()); }
+
+    private:
+        struct RetiredBuffer
+        {
+            Ref<VanKBuffer> Buffer;
+            uint64_t LastFrame; // the frame being recorded when it was retired, the last one that may use it
+        };
+
+        inline static std::vector<RetiredBuffer> m_Retired;
+    };
+
+    // A GPU buffer that reallocates when it runs out of space. The old contents are copied on the GPU and the old
+    // buffer goes to DeferredRelease, so everything that caches the device address has to fetch it again after a
+    // growth (the renderer rewrites the UBO address fields every frame). Pointer-like, so it drops into the upload macros.
+    template<typename BufferType>
+    class GrowableBuffer
+    {
+    public:
+        static constexpr uint64_t MinCapacity = 256;
+
+        void Init(uint64_t capacity)
+        {
+            m_Capacity = std::max(capacity, MinCapacity);
+            m_Buffer.reset(BufferType::Create(m_Capacity));
+        }
+
+        void Reset()
+        {
+            m_Buffer.reset();
+            m_Capacity = 0;
+        }
+
+        // Makes room for requiredBytes, growing by at least half the current capacity so a buffer filled by repeated
+        // appends is copied O(1) times per byte. preserveBytes of the old contents survive, pass 0 when the caller
+        // rewrites everything anyway. Returns true when the buffer and its device address changed.
+        bool Reserve(VanKCommandBuffer cmd, uint64_t requiredBytes, uint64_t preserveBytes = UINT64_MAX)
+        {
+            if (requiredBytes <= m_Capacity && m_Buffer)
+                return false;
+            return Resize(cmd, std::max({ requiredBytes, m_Capacity + m_Capacity / 2, MinCapacity }), preserveBytes);
+        }
+
+        // exact capacity, for owners that already grow geometrically (the geometry allocators)
+        bool Resize(VanKCommandBuffer cmd, uint64_t capacity, uint64_t preserveBytes = UINT64_MAX)
+        {
+            if (capacity <= m_Capacity && m_Buffer)
+                return false;
+
+            Ref<BufferType> grown(BufferType::Create(capacity));
+            uint64_t copyBytes = std::min(preserveBytes, m_Capacity);
+            if (m_Buffer && copyBytes > 0)
+                RenderCommand::CopyBuffer(cmd, *m_Buffer, 0, *grown, 0, copyBytes);
+            if (m_Buffer)
+            {
+                DeferredRelease::Retire(m_Buffer);
+                m_Growths++;
+            }
+
+            m_Buffer = std::move(grown);
+            m_Capacity = capacity;
+            return true;
+        }
+
+        BufferType* get() const { return m_Buffer.get(); }
+        BufferType* operator->() const { return m_Buffer.get(); }
+        BufferType& operator*() const { return *m_Buffer; }
+        explicit operator bool() const { return m_Buffer != nullptr; }
+
+        uint64_t GetCapacity() const { return m_Capacity; }
+        uint32_t GetGrowths() const { return m_Growths; }
+
+    private:
+        Ref<BufferType> m_Buffer;
+        uint64_t m_Capacity = 0;
+        uint32_t m_Growths = 0;
+    };
+}
@@ -0,0 +1,255 @@
+#include "MeshCache.h"
+
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+
+#include "VanK/Core/Log.h"
+
+namespace VanK
+{
+    namespace
+    {
+        constexpr uint32_t COOKED_MESH_MAGIC = 0x434D4B56; // "VKMC"
+        constexpr uint32_t COOKED_MESH_FORMAT_VERSION = 3;
+        constexpr uint64_t COOKED_MESH_SECTION_ALIGNMENT = 64;
+
+        enum CookedMeshSectionId : uint32_t
+        {
+            SectionVertices,
+            SectionIndices,
+            SectionRanges,
+            SectionMeshlets,
+            SectionLodGroups,
+            SectionLods,
+            SectionCount
+        };
+
+        struct CookedMeshSection
+        {
+            uint64_t Offset;
+            uint64_t Count;
+        };
+
+        struct CookedMeshHeader
+        {
+            uint32_t Magic;
+            uint32_t FormatVersion;
+            uint32_t ImporterVersion;
+            uint32_t VertexStride;
+            XXH128_hash_t SourceHash;
+            CookedMeshSection Sections[SectionCount];
+        };
+
+        uint64_t AlignUp(uint64_t value, uint64_t alignment)
+        {
+            return (value + alignment - 1) & ~(alignment - 1);
+        }
+
+        bool SectionFits(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t fileSize)
+        {
+            if (offset % COOKED_MESH_SECTION_ALIGNMENT != 0 || offset > fileSize)
+                return false;
+            return count <= (fileSize - offset) / elementSize;
+        }
+
+        template<typename T>
+        bool SectionFits(const CookedMeshSection& section, uint64_t fileSize)
+        {
+            return SectionFits(section.Offset, section.Count, sizeof(T), fileSize);
+        }
+
+        template<typename T>
+        std::span<const T> ViewSection(const uint8_t* base, const CookedMeshSection& section)
+        {
+            return { reinterpret_cast<const T*>(base + section.Offset), static_cast<size_t>(section.Count) };
+        }
+
+        // [first, first + count) inside an array of size elements, without overflowing
+        bool RangeFits(uint64_t first, uint64_t count, uint64_t size)
+        {
+            return first <= size && count <= size - first;
+        }
+
+        // Everything the tables reference has to exist, the renderer indexes with these values unchecked
+        bool TablesAreConsistent(const CookedMeshData& data)
+        {
+            const uint64_t vertexCount = data.Vertices.size();
+            const uint64_t indexCount = data.Indices.size();
+
+            for (const CookedMeshRange& range : data.Ranges)
+            {
+                if (!RangeFits(range.VertexOffset, range.VertexCount, vertexCount) || !RangeFits(range.IndexOffset, range.IndexCount, indexCount))
+                    return false;
+            }
+            // indices are rebased onto the whole vertex array
+            for (uint32_t index : data.Indices)
+            {
+                if (index >= vertexCount)
+                    return false;
+            }
+            for (const shaderio::Meshlet& meshlet : data.Meshlets)
+            {
+                if (!RangeFits(meshlet.firstIndex, uint64_t(meshlet.triangleCount) * 3, indexCount) || meshlet.lodGroup >= data.LodGroups.size())
+                    return false;
+            }
+            // one LOD group per range, every group has at least LOD 0
+            if (data.LodGroups.size() != data.Ranges.size())
+                return false;
+            for (const shaderio::MeshLodGroup& group : data.LodGroups)
+            {
+                if (group.lodCount == 0 || !RangeFits(group.firstLod, group.lodCount, data.Lods.size()))
+                    return false;
+            }
+            for (const shaderio::MeshLod& lod : data.Lods)
+            {
+                if (!RangeFits(lod.firstIndex, lod.indexCount, indexCount) || !RangeFits(lod.firstMeshlet, lod.meshletCount, data.Meshlets.size()))
+                    return false;
+            }
+            return true;
+        }
+    }
+
+    std::string MeshCache::GetCookedPath(const std::string& sourcePath)
+    {
+        // the file name keeps the extension and a hash of the whole path, model.glb and model.obj (or two model.glb
+        // in different folders) would otherwise evict each other's cooked file
+        std::string meshFolder = Utility::GetCachePath("meshes");
+        const std::filesystem::path source = std::filesystem::path(sourcePath).lexically_normal();
+        const std::string normalized = source.generic_string();
+        const std::string name = std::format("{}.{:016x}.vkmesh", source.filename().string(), XXH3_64bits(normalized.data(), normalized.size()));
+        return (std::filesystem::path(meshFolder) / name).string();
+    }
+
+    Scope<CookedMesh> MeshCache::Load(const std::string& sourcePath, const XXH128_hash_t& sourceHash)
+    {
+        std::string cookedPath = GetCookedPath(sourcePath);
+        MappedFile file(cookedPath);
+        if (!file.IsValid() || file.Size() < sizeof(CookedMeshHeader))
+            return nullptr;
+
+        CookedMeshHeader header;
+        std::memcpy(&header, file.Data(), sizeof(header));
+
+        if (header.Magic != COOKED_MESH_MAGIC || header.FormatVersion != COOKED_MESH_FORMAT_VERSION)
+        {
+            VK_CORE_WARN("[MeshCache] '{}' is not a cooked mesh of this version, recooking", cookedPath);
+            return nullptr;
+        }
+
+        if (header.ImporterVersion != MESH_IMPORTER_VERSION || header.VertexStride != sizeof(shaderio::InstancedVertexData) ||
+            header.SourceHash.low64 != sourceHash.low64 || header.SourceHash.high64 != sourceHash.high64)
+        {
+            VK_CORE_INFO("[MeshCache] '{}' is stale, recooking", cookedPath);
+            return nullptr;
+        }
+
+        const CookedMeshSection* sections = header.Sections;
+        if (!SectionFits<shaderio::InstancedVertexData>(sections[SectionVertices], file.Size()) ||
+            !SectionFits<uint32_t>(sections[SectionIndices], file.Size()) ||
+            !SectionFits<CookedMeshRange>(sections[SectionRanges], file.Size()) ||
+            !SectionFits<shaderio::Meshlet>(sections[SectionMeshlets], file.Size()) ||
+            !SectionFits<shaderio::MeshLodGroup>(sections[SectionLodGroups], file.Size()) ||
+            !SectionFits<shaderio::MeshLod>(sections[SectionLods], file.Size()))
+        {
+            VK_CORE_WARN("[MeshCache] '{}' is truncated, recooking", cookedPath);
+            return nullptr;
+        }
+
+        // the mapping is page aligned and every section is 64 byte aligned, so the arrays can be viewed in place
+        Scope<CookedMesh> cooked = CreateScope<CookedMesh>();
+        const uint8_t* base = file.Data();
+        cooked->Vertices = ViewSection<shaderio::InstancedVertexData>(base, sections[SectionVertices]);
+        cooked->Indices = ViewSection<uint32_t>(base, sections[SectionIndices]);
+        cooked->Ranges = ViewSection<CookedMeshRange>(base, sections[SectionRanges]);
+        cooked->Meshlets = ViewSection<shaderio::Meshlet>(base, sections[SectionMeshlets]);
+        cooked->LodGroups = ViewSection<shaderio::MeshLodGroup>(base, sections[SectionLodGroups]);
+        cooked->Lods = ViewSection<shaderio::MeshLod>(base, sections[SectionLods]);
+        if (!TablesAreConsistent(*cooked))
+        {
+            VK_CORE_WARN("[MeshCache] '{}' has ranges outside its arrays, recooking", cookedPath);
+            return nullptr;
+        }
+        cooked->m_File = std::move(file);
+        return cooked;
+    }
+
+    bool MeshCache::Save(const std::string& sourcePath, const XXH128_hash_t& sourceHash, const CookedMeshData& data)
+    {
+        const std::span<const std::byte> payload[SectionCount] =
+        {
+            std::as_bytes(data.Vertices),
+            std::as_bytes(data.Indices),
+            std::as_bytes(data.Ranges),
+            std::as_bytes(data.Meshlets),
+            std::as_bytes(data.LodGroups),
+            std::as_bytes(data.Lods)
+        };
+        const uint64_t elementSize[SectionCount] =
+        {
+            sizeof(shaderio::InstancedVertexData), sizeof(uint32_t), sizeof(CookedMeshRange),
+            sizeof(shaderio::Meshlet), sizeof(shaderio::MeshLodGroup), sizeof(shaderio::MeshLod)
+        };
+
+        CookedMeshHeader header{};
+        header.Magic = COOKED_MESH_MAGIC;
+        header.FormatVersion = COOKED_MESH_FORMAT_VERSION;
+        header.ImporterVersion = MESH_IMPORTER_VERSION;
+        header.VertexStride = sizeof(shaderio::InstancedVertexData);
+        header.SourceHash = sourceHash;
+
+        uint64_t cursor = sizeof(CookedMeshHeader);
+        for (uint32_t section = 0; section < SectionCount; section++)
+        {
+            header.Sections[section].Offset = AlignUp(cursor, COOKED_MESH_SECTION_ALIGNMENT);
+            header.Sections[section].Count = payload[section].size() / elementSize[section];
+            cursor = header.Sections[section].Offset + payload[section].size();
+        }
+
+        // write next to the target and rename, so a crash never leaves a half written cache behind
+        std::string cookedPath = GetCookedPath(sourcePath);
+        std::string tempPath = cookedPath + ".tmp";
+        {
+            std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+            if (!out)
+            {
+                VK_CORE_ERROR("[MeshCache] Failed to open '{}' for writing", tempPath);
+                return false;
+            }
+
+            auto writeAt = [&out](uint64_t offset, const void* data, size_t size)
+            {
+                static constexpr char padding[COOKED_MESH_SECTION_ALIGNMENT] = {};
+                uint64_t position = static_cast<uint64_t>(out.tellp());
+                out.write(padding, static_cast<std::streamsize>(offset - position));
+                out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+            };
+
+            writeAt(0, &header, sizeof(header));
+            for (uint32_t section = 0; section < SectionCount; section++)
+            {
+                writeAt(header.Sections[section].Offset, payload[section].data(), payload[section].size());
+            }
+
+            if (!out.good())
+            {
+                VK_CORE_ERROR("[MeshCache] Failed to write '{}'", tempPath);
+                return false;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tempPath, cookedPath, ec);
+        if (ec)
+        {
+            VK_CORE_ERROR("[MeshCache] Failed to move '{}' into place: {}", tempPath, ec.message());
+            std::filesystem::remove(tempPath, ec);
+            return false;
+        }
+
+        VK_CORE_INFO("[MeshCache] Cooked '{}' ({} vertices, {} indices, {} meshes, {} meshlets, {} LODs)", cookedPath,
+                     data.Vertices.size(), data.Indices.size(), data.Ranges.size(), data.Meshlets.size(), data.Lods.size());
+        return true;
+    }
+}
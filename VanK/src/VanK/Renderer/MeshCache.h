@@ -0,0 +1,51 @@
+#pragma once
+#include <span>
+#include <string>
+
+#include "Geometry.h"
+#include "VanK/Utils.h"
+
+namespace VanK
+{
+    // Bump whenever the importer changes what it produces, stale cooked files are then rebuilt
+    constexpr uint32_t MESH_IMPORTER_VERSION = 3;
+
+    struct CookedMeshRange
+    {
+        char Name[64];
+        uint32_t VertexOffset;
+        uint32_t VertexCount;
+        uint32_t IndexOffset;
+        uint32_t IndexCount;
+    };
+
+    // Everything the importer produces for a model
+    struct CookedMeshData
+    {
+        std::span<const shaderio::InstancedVertexData> Vertices;
+        std::span<const uint32_t> Indices;
+        std::span<const CookedMeshRange> Ranges;
+        std::span<const shaderio::Meshlet> Meshlets;
+        std::span<const shaderio::MeshLodGroup> LodGroups; // one per range
+        std::span<const shaderio::MeshLod> Lods;
+    };
+
+    // Final arrays of a model, viewed directly inside the mapped cache file
+    class CookedMesh : public CookedMeshData
+    {
+    private:
+        MappedFile m_File;
+        friend class MeshCache;
+    };
+
+    // cache/meshes/<model file>.<path hash>.vkmesh, keyed by the xxhash of the source file plus MESH_IMPORTER_VERSION
+    class MeshCache
+    {
+    public:
+        static std::string GetCookedPath(const std::string& sourcePath);
+
+        // returns nullptr if there is no cooked file or it is stale/corrupt
+        static Scope<CookedMesh> Load(const std::string& sourcePath, const XXH128_hash_t& sourceHash);
+        static bool Save(const std::string& sourcePath, const XXH128_hash_t& sourceHash, const CookedMeshData& data);
+    };
+}
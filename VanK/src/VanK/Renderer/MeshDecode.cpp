@@ -0,0 +1,422 @@
+#include "MeshDecode.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "VanK/Core/Log.h"
+#include "VanK/Core/Timer.h"
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define VANK_MESHDECODE_AVX2 1
+    #define VANK_MESHDECODE_SSE2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define VANK_MESHDECODE_SSE2 1
+#endif
+
+namespace VanK
+{
+    namespace
+    {
+        template <typename T>
+        T LoadUnaligned(const uint8_t* ptr)
+        {
+            T value;
+            std::memcpy(&value, ptr, sizeof(T));
+            return value;
+        }
+
+        // Reference implementation, used as the fallback on non x86 targets and as the baseline for RunBenchmark
+        namespace Scalar
+        {
+            void GatherFloat3(const uint8_t* src, size_t srcStride, size_t count, uint8_t* dst, size_t dstStride)
+            {
+                for (size_t i = 0; i < count; i++)
+                    std::memcpy(dst + i * dstStride, src + i * srcStride, sizeof(float) * 3);
+            }
+
+            void GatherFloat2(const uint8_t* src, size_t srcStride, size_t count, uint8_t* dst, size_t dstStride)
+            {
+                for (size_t i = 0; i < count; i++)
+                    std::memcpy(dst + i * dstStride, src + i * srcStride, sizeof(float) * 2);
+            }
+
+            template <typename T>
+            void DecodeNormalized(const uint8_t* src, size_t srcStride, uint32_t components, size_t count, uint8_t* dst, size_t dstStride)
+            {
+                constexpr float scale = 1.0f / static_cast<float>(std::numeric_limits<T>::max());
+                for (size_t i = 0; i < count; i++)
+                {
+                    float out[4];
+                    for (uint32_t c = 0; c < components; c++)
+                    {
+                        float value = static_cast<float>(LoadUnaligned<T>(src + i * srcStride + c * sizeof(T))) * scale;
+                        out[c] = std::is_signed_v<T> ? std::max(value, -1.0f) : value;
+                    }
+                    std::memcpy(dst + i * dstStride, out, components * sizeof(float));
+                }
+            }
+
+            template <typename T>
+            void WidenIndices(const uint8_t* src, size_t srcStride, size_t count, uint32_t baseVertex, uint32_t* dst)
+            {
+                for (size_t i = 0; i < count; i++)
+                    dst[i] = baseVertex + static_cast<uint32_t>(LoadUnaligned<T>(src + i * srcStride));
+            }
+
+            void DecodeNormalized(const uint8_t* src, size_t srcStride, MeshDecode::ComponentType type, uint32_t components,
+                                  size_t count, uint8_t* dst, size_t dstStride)
+            {
+                switch (type)
+                {
+                case MeshDecode::ComponentType::Int8:   DecodeNormalized<int8_t>(src, srcStride, components, count, dst, dstStride); break;
+                case MeshDecode::ComponentType::Uint8:  DecodeNormalized<uint8_t>(src, srcStride, components, count, dst, dstStride); break;
+                case MeshDecode::ComponentType::Int16:  DecodeNormalized<int16_t>(src, srcStride, components, count, dst, dstStride); break;
+                case MeshDecode::ComponentType::Uint16: DecodeNormalized<uint16_t>(src, srcStride, components, count, dst, dstStride); break;
+                default: throw std::runtime_error("Unsupported normalized component type");
+                }
+            }
+
+            void WidenIndices(const uint8_t* src, size_t srcStride, MeshDecode::ComponentType type, size_t count, uint32_t baseVertex, uint32_t* dst)
+            {
+                switch (type)
+                {
+                case MeshDecode::ComponentType::Uint8:  WidenIndices<uint8_t>(src, srcStride, count, baseVertex, dst); break;
+                case MeshDecode::ComponentType::Uint16: WidenIndices<uint16_t>(src, srcStride, count, baseVertex, dst); break;
+                case MeshDecode::ComponentType::Uint32: WidenIndices<uint32_t>(src, srcStride, count, baseVertex, dst); break;
+                default: throw std::runtime_error("Unsupported index component type");
+                }
+            }
+        }
+
+#if defined(VANK_MESHDECODE_SSE2)
+        namespace Simd
+        {
+            void GatherFloat3(const uint8_t* src, size_t srcStride, size_t count, uint8_t* dst, size_t dstStride)
+            {
+                // a 16 byte load over-reads 4 bytes, which is fine as long as another element follows (srcStride >= 12)
+                size_t i = 0;
+                for (; i + 1 < count; i++)
+                {
+                    __m128 v = _mm_loadu_ps(reinterpret_cast<const float*>(src + i * srcStride));
+                    float* out = reinterpret_cast<float*>(dst + i * dstStride);
+                    _mm_storel_pi(reinterpret_cast<__m64*>(out), v);
+                    _mm_store_ss(out + 2, _mm_movehl_ps(v, v));
+                }
+                Scalar::GatherFloat3(src + i * srcStride, srcStride, count - i, dst + i * dstStride, dstStride);
+            }
+
+            void GatherFloat2(const uint8_t* src, size_t srcStride, size_t count, uint8_t* dst, size_t dstStride)
+            {
+                size_t i = 0;
+                for (; i + 2 <= count; i += 2)
+                {
+                    __m128i a = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i * srcStride));
+                    __m128i b = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + (i + 1) * srcStride));
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i * dstStride), a);
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + (i + 1) * dstStride), b);
+                }
+                Scalar::GatherFloat2(src + i * srcStride, srcStride, count - i, dst + i * dstStride, dstStride);
+            }
+
+            // widens the low components of v to int32 lanes
+            inline __m128i WidenToInt32(__m128i v, MeshDecode::ComponentType type)
+            {
+                const __m128i zero = _mm_setzero_si128();
+                switch (type)
+                {
+                case MeshDecode::ComponentType::Uint8:  return _mm_unpacklo_epi16(_mm_unpacklo_epi8(v, zero), zero);
+                case MeshDecode::ComponentType::Int8:   return _mm_srai_epi32(_mm_unpacklo_epi16(_mm_unpacklo_epi8(v, v), _mm_unpacklo_epi8(v, v)), 24);
+                case MeshDecode::ComponentType::Uint16: return _mm_unpacklo_epi16(v, zero);
+                case MeshDecode::ComponentType::Int16:  return _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+                default: return zero;
+                }
+            }
+
+            void DecodeNormalized(const uint8_t* src, size_t srcStride, MeshDecode::ComponentType type, uint32_t components,
+                                  size_t count, uint8_t* dst, size_t dstStride)
+            {
+                const bool isSigned = type == MeshDecode::ComponentType::Int8 || type == MeshDecode::ComponentType::Int16;
+                const size_t componentSize = MeshDecode::ComponentSize(type);
+                const float maxValue = componentSize == 1 ? (isSigned ? 127.0f : 255.0f) : (isSigned ? 32767.0f : 65535.0f);
+                const __m128 scale = _mm_set1_ps(1.0f / maxValue);
+                const __m128 minusOne = _mm_set1_ps(-1.0f);
+                const size_t elementSize = componentSize * components;
+
+                size_t i = 0;
+#if defined(VANK_MESHDECODE_AVX2)
+                // 16 bit UVs are the common case, 4 elements per iteration via a 32 bit gather (one element == 4 bytes, no over-read)
+                if (components == 2 && componentSize == 2 && srcStride <= 0x1FFFFFFF)
+                {
+                    const int s = static_cast<int>(srcStride);
+                    const __m128i offsets = _mm_setr_epi32(0, s, 2 * s, 3 * s);
+                    const __m256 scale8 = _mm256_set1_ps(1.0f / maxValue);
+                    const __m256 minusOne8 = _mm256_set1_ps(-1.0f);
+                    for (; i + 4 <= count; i += 4)
+                    {
+                        __m128i packed = _mm_i32gather_epi32(reinterpret_cast<const int*>(src + i * srcStride), offsets, 1);
+                        __m256i wide = isSigned ? _mm256_cvtepi16_epi32(packed) : _mm256_cvtepu16_epi32(packed);
+                        __m256 f = _mm256_mul_ps(_mm256_cvtepi32_ps(wide), scale8);
+                        if (isSigned)
+                            f = _mm256_max_ps(f, minusOne8);
+
+                        __m128 lo = _mm256_castps256_ps128(f);
+                        __m128 hi = _mm256_extractf128_ps(f, 1);
+                        _mm_storel_pi(reinterpret_cast<__m64*>(dst + (i + 0) * dstStride), lo);
+                        _mm_storeh_pi(reinterpret_cast<__m64*>(dst + (i + 1) * dstStride), lo);
+                        _mm_storel_pi(reinterpret_cast<__m64*>(dst + (i + 2) * dstStride), hi);
+                        _mm_storeh_pi(reinterpret_cast<__m64*>(dst + (i + 3) * dstStride), hi);
+                    }
+                }
+#endif
+                for (; i < count; i++)
+                {
+                    uint64_t raw = 0;
+                    std::memcpy(&raw, src + i * srcStride, elementSize);
+                    __m128i wide = WidenToInt32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(&raw)), type);
+                    __m128 f = _mm_mul_ps(_mm_cvtepi32_ps(wide), scale);
+                    if (isSigned)
+                        f = _mm_max_ps(f, minusOne);
+
+                    alignas(16) float out[4];
+                    _mm_store_ps(out, f);
+                    std::memcpy(dst + i * dstStride, out, components * sizeof(float));
+                }
+            }
+
+            void WidenIndices(const uint8_t* src, MeshDecode::ComponentType type, size_t count, uint32_t baseVertex, uint32_t* dst)
+            {
+                size_t i = 0;
+#if defined(VANK_MESHDECODE_AVX2)
+                const __m256i base8 = _mm256_set1_epi32(static_cast<int>(baseVertex));
+                switch (type)
+                {
+                case MeshDecode::ComponentType::Uint8:
+                    for (; i + 8 <= count; i += 8)
+                    {
+                        __m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i)));
+                        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_add_epi32(v, base8));
+                    }
+                    break;
+                case MeshDecode::ComponentType::Uint16:
+                    for (; i + 8 <= count; i += 8)
+                    {
+                        __m256i v = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2)));
+                        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_add_epi32(v, base8));
+                    }
+                    break;
+                case MeshDecode::ComponentType::Uint32:
+                    for (; i + 8 <= count; i += 8)
+                    {
+                        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 4));
+                        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_add_epi32(v, base8));
+                    }
+                    break;
+                default:
+                    break;
+                }
+#else
+                const __m128i base = _mm_set1_epi32(static_cast<int>(baseVertex));
+                const __m128i zero = _mm_setzero_si128();
+                switch (type)
+                {
+                case MeshDecode::ComponentType::Uint8:
+                    for (; i + 16 <= count; i += 16)
+                    {
+                        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+                        __m128i lo = _mm_unpacklo_epi8(v, zero);
+                        __m128i hi = _mm_unpackhi_epi8(v, zero);
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 0), _mm_add_epi32(_mm_unpacklo_epi16(lo, zero), base));
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 4), _mm_add_epi32(_mm_unpackhi_epi16(lo, zero), base));
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8), _mm_add_epi32(_mm_unpacklo_epi16(hi, zero), base));
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 12), _mm_add_epi32(_mm_unpackhi_epi16(hi, zero), base));
+                    }
+                    break;
+                case MeshDecode::ComponentType::Uint16:
+                    for (; i + 8 <= count; i += 8)
+                    {
+                        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 0), _mm_add_epi32(_mm_unpacklo_epi16(v, zero), base));
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 4), _mm_add_epi32(_mm_unpackhi_epi16(v, zero), base));
+                    }
+                    break;
+                case MeshDecode::ComponentType::Uint32:
+                    for (; i + 4 <= count; i += 4)
+                    {
+                        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_add_epi32(v, base));
+                    }
+                    break;
+                default:
+                    break;
+                }
+#endif
+                const size_t componentSize = MeshDecode::ComponentSize(type);
+                Scalar::WidenIndices(src + i * componentSize, componentSize, type, count - i, baseVertex, dst + i);
+            }
+        }
+#endif
+    }
+
+    size_t MeshDecode::ComponentSize(ComponentType type)
+    {
+        switch (type)
+        {
+        case ComponentType::Int8:
+        case ComponentType::Uint8:  return 1;
+        case ComponentType::Int16:
+        case ComponentType::Uint16: return 2;
+        case ComponentType::Uint32:
+        case ComponentType::Float:  return 4;
+        }
+        return 0;
+    }
+
+    void MeshDecode::GatherFloat3(const void* src, size_t srcStride, size_t count, void* dst, size_t dstStride)
+    {
+        auto* in = static_cast<const uint8_t*>(src);
+        auto* out = static_cast<uint8_t*>(dst);
+#if defined(VANK_MESHDECODE_SSE2)
+        if (srcStride >= sizeof(float) * 3)
+            return Simd::GatherFloat3(in, srcStride, count, out, dstStride);
+#endif
+        Scalar::GatherFloat3(in, srcStride, count, out, dstStride);
+    }
+
+    void MeshDecode::GatherFloat2(const void* src, size_t srcStride, size_t count, void* dst, size_t dstStride)
+    {
+        auto* in = static_cast<const uint8_t*>(src);
+        auto* out = static_cast<uint8_t*>(dst);
+#if defined(VANK_MESHDECODE_SSE2)
+        return Simd::GatherFloat2(in, srcStride, count, out, dstStride);
+#else
+        Scalar::GatherFloat2(in, srcStride, count, out, dstStride);
+#endif
+    }
+
+    void MeshDecode::DecodeNormalized(const void* src, size_t srcStride, ComponentType type, uint32_t components,
+                                      size_t count, void* dst, size_t dstStride)
+    {
+        if (components == 0 || components > 4)
+            throw std::runtime_error("Normalized accessor must have 1 to 4 components");
+
+        auto* in = static_cast<const uint8_t*>(src);
+        auto* out = static_cast<uint8_t*>(dst);
+#if defined(VANK_MESHDECODE_SSE2)
+        if (type != ComponentType::Uint32 && type != ComponentType::Float)
+            return Simd::DecodeNormalized(in, srcStride, type, components, count, out, dstStride);
+#endif
+        Scalar::DecodeNormalized(in, srcStride, type, components, count, out, dstStride);
+    }
+
+    void MeshDecode::WidenIndices(const void* src, size_t srcStride, ComponentType type, size_t count,
+                                  uint32_t baseVertex, uint32_t* dst)
+    {
+        if (type != ComponentType::Uint8 && type != ComponentType::Uint16 && type != ComponentType::Uint32)
+            throw std::runtime_error("Unsupported index component type");
+
+        auto* in = static_cast<const uint8_t*>(src);
+#if defined(VANK_MESHDECODE_SSE2)
+        // index buffer views are tightly packed per spec, a strided one takes the scalar path
+        if (srcStride == ComponentSize(type))
+            return Simd::WidenIndices(in, type, count, baseVertex, dst);
+#endif
+        Scalar::WidenIndices(in, srcStride, type, count, baseVertex, dst);
+    }
+
+    const char* MeshDecode::GetSimdPathName()
+    {
+#if defined(VANK_MESHDECODE_AVX2)
+        return "AVX2";
+#elif defined(VANK_MESHDECODE_SSE2)
+        return "SSE2";
+#else
+        return "Scalar";
+#endif
+    }
+
+    void MeshDecode::RunBenchmark(size_t elementCount, uint32_t iterations)
+    {
+        // same layout as shaderio::InstancedVertexData (56 bytes)
+        struct BenchVertex
+        {
+            float position[3];
+            float normals[3];
+            float texcoords[2];
+            float tangent[3];
+            float bitangent[3];
+        };
+
+        // interleaved source: float3 position, float2 uv, u16x2 normalized uv -> 24 byte stride
+        constexpr size_t srcStride = 24;
+        std::vector<uint8_t> source(elementCount * srcStride);
+        std::vector<uint16_t> indices16(elementCount * 3);
+        std::vector<uint8_t> indices8(elementCount * 3);
+        for (size_t i = 0; i < elementCount; i++)
+        {
+            float values[5] = { float(i), float(i) * 0.5f, float(i) * 0.25f, float(i % 97) / 97.0f, float(i % 89) / 89.0f };
+            uint16_t uv16[2] = { static_cast<uint16_t>(i * 7), static_cast<uint16_t>(i * 13) };
+            std::memcpy(&source[i * srcStride], values, sizeof(values));
+            std::memcpy(&source[i * srcStride + 20], uv16, sizeof(uv16));
+        }
+        for (size_t i = 0; i < indices16.size(); i++)
+        {
+            indices16[i] = static_cast<uint16_t>(i * 31);
+            indices8[i] = static_cast<uint8_t>(i * 31);
+        }
+
+        std::vector<BenchVertex> scalarOut(elementCount);
+        std::vector<BenchVertex> simdOut(elementCount);
+        std::vector<uint32_t> scalarIndices(indices16.size());
+        std::vector<uint32_t> simdIndices(indices16.size());
+
+        auto measure = [iterations](auto&& fn)
+        {
+            float best = std::numeric_limits<float>::max();
+            for (uint32_t it = 0; it < iterations; it++)
+            {
+                Timer timer;
+                fn();
+                best = std::min(best, timer.ElapsedMillis());
+            }
+            return best;
+        };
+
+        auto report = [&](const char* name, float scalarMs, float simdMs, bool match, size_t bytes)
+        {
+            const float gbPerSecond = static_cast<float>(bytes) / (simdMs * 1.0e-3f) / 1.0e9f;
+            VK_CORE_INFO("[MeshDecode] {:<16} scalar {:7.3f} ms | {} {:7.3f} ms | {:5.2f}x | {:6.2f} GB/s{}",
+                         name, scalarMs, GetSimdPathName(), simdMs, scalarMs / simdMs, gbPerSecond, match ? "" : " | MISMATCH");
+        };
+
+        auto* scalarDst = reinterpret_cast<uint8_t*>(scalarOut.data());
+        auto* simdDst = reinterpret_cast<uint8_t*>(simdOut.data());
+        constexpr size_t dstStride = sizeof(BenchVertex);
+
+        float scalarMs = measure([&] { Scalar::GatherFloat3(source.data(), srcStride, elementCount, scalarDst, dstStride); });
+        float simdMs = measure([&] { GatherFloat3(source.data(), srcStride, elementCount, simdDst, dstStride); });
+        report("GatherFloat3", scalarMs, simdMs, std::memcmp(scalarOut.data(), simdOut.data(), scalarOut.size() * dstStride) == 0, elementCount * 12);
+
+        scalarMs = measure([&] { Scalar::GatherFloat2(source.data() + 12, srcStride, elementCount, scalarDst + 24, dstStride); });
+        simdMs = measure([&] { GatherFloat2(source.data() + 12, srcStride, elementCount, simdDst + 24, dstStride); });
+        report("GatherFloat2", scalarMs, simdMs, std::memcmp(scalarOut.data(), simdOut.data(), scalarOut.size() * dstStride) == 0, elementCount * 8);
+
+        scalarMs = measure([&] { Scalar::DecodeNormalized(source.data() + 20, srcStride, ComponentType::Uint16, 2, elementCount, scalarDst + 24, dstStride); });
+        simdMs = measure([&] { DecodeNormalized(source.data() + 20, srcStride, ComponentType::Uint16, 2, elementCount, simdDst + 24, dstStride); });
+        report("UNorm16x2", scalarMs, simdMs, std::memcmp(scalarOut.data(), simdOut.data(), scalarOut.size() * dstStride) == 0, elementCount * 4);
+
+        auto* src16 = reinterpret_cast<const uint8_t*>(indices16.data());
+        scalarMs = measure([&] { Scalar::WidenIndices(src16, 2, ComponentType::Uint16, indices16.size(), 1234, scalarIndices.data()); });
+        simdMs = measure([&] { WidenIndices(src16, 2, ComponentType::Uint16, indices16.size(), 1234, simdIndices.data()); });
+        report("WidenU16", scalarMs, simdMs, scalarIndices == simdIndices, indices16.size() * 2);
+
+        scalarMs = measure([&] { Scalar::WidenIndices(indices8.data(), 1, ComponentType::Uint8, indices8.size(), 1234, scalarIndices.data()); });
+        simdMs = measure([&] { WidenIndices(indices8.data(), 1, ComponentType::Uint8, indices8.size(), 1234, simdIndices.data()); });
+        report("WidenU8", scalarMs, simdMs, scalarIndices == simdIndices, indices8.size());
+    }
+}
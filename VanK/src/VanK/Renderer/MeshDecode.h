@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace VanK
+{
+    // Readers for glTF style accessors (strided source, strided destination).
+    // Every reader honors the source byteStride and writes into an interleaved destination
+    // so the result can land directly inside shaderio::InstancedVertexData.
+    // x86 builds use SSE2 (or AVX2 when compiled with /arch:AVX2 / -mavx2), everything else falls back to scalar.
+    class MeshDecode
+    {
+    public:
+        // values match the glTF componentType codes so tinygltf accessors can be cast directly
+        enum class ComponentType : uint32_t
+        {
+            Int8    = 5120,
+            Uint8   = 5121,
+            Int16   = 5122,
+            Uint16  = 5123,
+            Uint32  = 5125,
+            Float   = 5126
+        };
+
+        static size_t ComponentSize(ComponentType type);
+
+        // float3 / float2 copy from a strided accessor into a strided destination
+        static void GatherFloat3(const void* src, size_t srcStride, size_t count, void* dst, size_t dstStride);
+        static void GatherFloat2(const void* src, size_t srcStride, size_t count, void* dst, size_t dstStride);
+
+        // normalized integer -> float (unsigned: c / max, signed: max(c / max, -1)), components is 1..4
+        static void DecodeNormalized(const void* src, size_t srcStride, ComponentType type, uint32_t components,
+                                     size_t count, void* dst, size_t dstStride);
+
+        // u8/u16/u32 -> u32 with baseVertex added, dst is tightly packed
+        static void WidenIndices(const void* src, size_t srcStride, ComponentType type, size_t count,
+                                 uint32_t baseVertex, uint32_t* dst);
+
+        // Loader independent description of one accessor, Data points at the first element
+        struct AccessorView
+        {
+            const uint8_t* Data = nullptr;
+            size_t ByteStride = 0;
+            size_t Count = 0;
+            ComponentType Type = ComponentType::Float;
+            uint32_t Components = 0;
+            bool Normalized = false;
+        };
+
+        static const char* GetSimdPathName();
+
+        // Times the SIMD readers against the scalar fallback on synthetic data and logs the result
+        static void RunBenchmark(size_t elementCount = 1 << 20, uint32_t iterations = 16);
+    };
+}
@@ -0,0 +1,91 @@
+#include "MeshRegistry.h"
+
+#include "VanK/Core/core.h"
+#include "VanK/Core/Log.h"
+
+namespace VanK
+{
+    MeshHandle MeshRegistry::Create(const std::string& name)
+    {
+        uint32_t index;
+        if (!m_FreeSlots.empty())
+        {
+            index = m_FreeSlots.back();
+            m_FreeSlots.pop_back();
+        }
+        else
+        {
+            index = static_cast<uint32_t>(m_Records.size());
+            m_Records.emplace_back();
+            m_Generations.push_back(0);
+            m_Alive.push_back(0);
+            m_Names.emplace_back();
+        }
+
+        m_Records[index] = {};
+        m_Alive[index] = 1;
+        m_Names[index] = name;
+        m_AliveCount++;
+
+        MeshHandle handle{ index, m_Generations[index] };
+        if (!name.empty())
+        {
+            auto it = m_NameLookup.find(name);
+            if (it != m_NameLookup.end() && IsValid(it->second))
+                m_Names[it->second.Index].clear(); // the old mesh stays alive, it's just no longer found by name
+            m_NameLookup[name] = handle;
+        }
+        return handle;
+    }
+
+    void MeshRegistry::Destroy(MeshHandle handle)
+    {
+        if (!IsValid(handle))
+        {
+            if (handle.IsValid())
+                VK_CORE_WARN("MeshRegistry::Destroy: stale mesh handle {}:{}", handle.Index, handle.Generation);
+            return;
+        }
+
+        const std::string& name = m_Names[handle.Index];
+        if (!name.empty())
+            m_NameLookup.erase(name);
+
+        m_Records[handle.Index] = {};
+        m_Names[handle.Index].clear();
+        m_Alive[handle.Index] = 0;
+        m_Generations[handle.Index]++;
+        m_FreeSlots.push_back(handle.Index);
+        m_AliveCount--;
+    }
+
+    void MeshRegistry::Clear()
+    {
+        // slots and generations are kept, handles from before stay stale
+        for (uint32_t index = 0; index < m_Records.size(); index++)
+        {
+            if (m_Alive[index])
+                Destroy(MeshHandle{ index, m_Generations[index] });
+        }
+    }
+
+    MeshRecord& MeshRegistry::Get(MeshHandle handle)
+    {
+        VK_CORE_ASSERT(IsValid(handle), "Stale or invalid mesh handle");
+        return m_Records[handle.Index];
+    }
+
+    MeshHandle MeshRegistry::Find(const std::string& name)
+    {
+        auto it = m_NameLookup.find(name);
+        if (it == m_NameLookup.end())
+            return {};
+        return it->second;
+    }
+
+    const std::string& MeshRegistry::GetName(MeshHandle handle)
+    {
+        static const std::string empty;
+        return IsValid(handle) ? m_Names[handle.Index] : empty;
+    }
+}
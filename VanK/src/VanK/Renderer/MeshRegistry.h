@@ -0,0 +1,87 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "RendererAPI.h"
+
+namespace VanK
+{
+    // Index into the registry plus the generation of the slot when the handle was made.
+    // Destroying a mesh bumps the generation, so old handles to a reused slot are detected.
+    struct MeshHandle
+    {
+        static constexpr uint32_t InvalidIndex = 0xFFFFFFFF;
+
+        uint32_t Index = InvalidIndex;
+        uint32_t Generation = 0;
+
+        bool IsValid() const { return Index != InvalidIndex; }
+        bool operator==(const MeshHandle&) const = default;
+    };
+
+    struct MeshRecord
+    {
+        // Ranges in the shared geometry buffers, relative to Parent's ranges when it is set
+        // (sub meshes of an imported model live inside the model's allocation)
+        uint32_t VertexOffset = 0;
+        uint32_t VertexCount = 0;
+        uint32_t IndexOffset = 0;
+        uint32_t IndexCount = 0;
+        VanKIndexElementSize IndexType = VanKIndexElementSize::Uint32; // picks the index buffer, see Geometry::GetIndexBuffer
+        MeshHandle Parent;
+
+        // InstancedStorageData range, see Geometry::AppendGeometryData
+        uint32_t InstanceOffset = 0;
+        uint32_t InstanceCount = 0;
+
+        // LOD 1..n as (firstIndex, indexCount), LOD 0 is the index range above
+        std::vector<std::pair<uint32_t, uint32_t>> LodRanges;
+    };
+
+    // Dense slot array of mesh records addressed by generational handles. Lookups are plain indexing,
+    // names are only kept in a side table for tools and debugging.
+    class MeshRegistry
+    {
+    public:
+        // an empty name registers no lookup entry, a taken name is moved to the new mesh
+        static MeshHandle Create(const std::string& name = {});
+        static void Destroy(MeshHandle handle);
+        static void Clear();
+
+        static bool IsValid(MeshHandle handle)
+        {
+            return handle.Index < m_Generations.size() && m_Generations[handle.Index] == handle.Generation && m_Alive[handle.Index];
+        }
+
+        // asserts on stale handles, TryGet returns nullptr instead
+        static MeshRecord& Get(MeshHandle handle);
+        static MeshRecord* TryGet(MeshHandle handle) { return IsValid(handle) ? &m_Records[handle.Index] : nullptr; }
+
+        static MeshHandle Find(const std::string& name);
+        static const std::string& GetName(MeshHandle handle);
+        static uint32_t GetCount() { return m_AliveCount; }
+
+        // walks live slots in index order, the callback gets (MeshHandle, MeshRecord&)
+        template<typename Func>
+        static void ForEach(Func&& func)
+        {
+            for (uint32_t index = 0; index < m_Records.size(); index++)
+            {
+                if (m_Alive[index])
+                    func(MeshHandle{ index, m_Generations[index] }, m_Records[index]);
+            }
+        }
+
+    private:
+        inline static std::vector<MeshRecord> m_Records;
+        inline static std::vector<uint32_t> m_Generations;
+        inline static std::vector<uint8_t> m_Alive;
+        inline static std::vector<std::string> m_Names;
+        inline static std::vector<uint32_t> m_FreeSlots;
+        inline static uint32_t m_AliveCount = 0;
+        inline static std::unordered_map<std::string, MeshHandle> m_NameLookup;
+    };
+}
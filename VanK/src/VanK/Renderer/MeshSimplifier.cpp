@@ -0,0 +1,354 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+namespace VanK
+{
+    namespace
+    {
+        // symmetric 4x4 plane quadric, weighted by triangle area
+        struct Quadric
+        {
+            double a2 = 0, ab = 0, ac = 0, ad = 0;
+            double b2 = 0, bc = 0, bd = 0;
+            double c2 = 0, cd = 0;
+            double d2 = 0;
+            double Weight = 0;
+
+            void AddPlane(const glm::vec3& normal, double distance, double weight)
+            {
+                a2 += weight * normal.x * normal.x; ab += weight * normal.x * normal.y; ac += weight * normal.x * normal.z; ad += weight * normal.x * distance;
+                b2 += weight * normal.y * normal.y; bc += weight * normal.y * normal.z; bd += weight * normal.y * distance;
+                c2 += weight * normal.z * normal.z; cd += weight * normal.z * distance;
+                d2 += weight * distance * distance;
+                Weight += weight;
+            }
+
+            void Add(const Quadric& other)
+            {
+                a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+                b2 += other.b2; bc += other.bc; bd += other.bd;
+                c2 += other.c2; cd += other.cd;
+                d2 += other.d2;
+                Weight += other.Weight;
+            }
+
+            double Evaluate(const glm::vec3& p) const
+            {
+                double x = p.x, y = p.y, z = p.z;
+                double error = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+                             + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+                             + c2 * z * z + 2 * cd * z
+                             + d2;
+                return std::max(error, 0.0);
+            }
+        };
+
+        struct Collapse
+        {
+            uint32_t From;
+            uint32_t To;
+            double Cost;
+        };
+
+        struct PositionKey
+        {
+            uint32_t x, y, z;
+            bool operator==(const PositionKey&) const = default;
+        };
+
+        struct PositionKeyHash
+        {
+            size_t operator()(const PositionKey& key) const
+            {
+                return (key.x * 73856093u) ^ (key.y * 19349663u) ^ (key.z * 83492791u);
+            }
+        };
+
+        PositionKey MakePositionKey(const glm::vec3& position)
+        {
+            PositionKey key;
+            std::memcpy(&key.x, &position.x, sizeof(float));
+            std::memcpy(&key.y, &position.y, sizeof(float));
+            std::memcpy(&key.z, &position.z, sizeof(float));
+            return key;
+        }
+
+        glm::vec3 TriangleNormal(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2)
+        {
+            return glm::cross(p1 - p0, p2 - p0);
+        }
+    }
+
+    float MeshSimplifier::Simplify(std::span<const shaderio::InstancedVertexData> vertices, std::span<const uint32_t> indices,
+                                   size_t targetIndexCount, float attributeWeight, std::vector<uint32_t>& outIndices)
+    {
+        // work on a compact local vertex set, meshes are small slices of the shared vertex array
+        std::vector<uint32_t> globalVertex(indices.begin(), indices.end());
+        std::sort(globalVertex.begin(), globalVertex.end());
+        globalVertex.erase(std::unique(globalVertex.begin(), globalVertex.end()), globalVertex.end());
+
+        const uint32_t vertexCount = static_cast<uint32_t>(globalVertex.size());
+        std::unordered_map<uint32_t, uint32_t> localVertex;
+        localVertex.reserve(vertexCount);
+        for (uint32_t i = 0; i < vertexCount; i++)
+            localVertex[globalVertex[i]] = i;
+
+        std::vector<uint32_t> triangles(indices.size() - indices.size() % 3);
+        for (size_t i = 0; i < triangles.size(); i++)
+            triangles[i] = localVertex[indices[i]];
+
+        auto position = [&](uint32_t local) -> const glm::vec3& { return vertices[globalVertex[local]].position; };
+
+        // Vertices on a uv/normal seam share a position. Topology and quadrics use the welded position ('point'),
+        // the triangles keep their own vertex ('wedge') so every side of a seam keeps its attributes.
+        std::vector<uint32_t> pointOf(vertexCount);
+        std::vector<uint32_t> nextWedge(vertexCount); // circular list of the wedges of one point
+        {
+            std::unordered_map<PositionKey, uint32_t, PositionKeyHash> firstAtPosition;
+            firstAtPosition.reserve(vertexCount);
+            for (uint32_t v = 0; v < vertexCount; v++)
+            {
+                auto [it, inserted] = firstAtPosition.try_emplace(MakePositionKey(position(v)), v);
+                pointOf[v] = it->second;
+                nextWedge[v] = v;
+                if (!inserted)
+                {
+                    nextWedge[v] = nextWedge[it->second];
+                    nextWedge[it->second] = v;
+                }
+            }
+        }
+
+        // open borders and non manifold edges stay where they are
+        std::vector<bool> locked(vertexCount, false);
+        {
+            std::unordered_map<uint64_t, uint32_t> edgeUse;
+            edgeUse.reserve(triangles.size());
+            for (size_t t = 0; t < triangles.size(); t += 3)
+            {
+                for (int e = 0; e < 3; e++)
+                {
+                    uint32_t a = pointOf[triangles[t + e]];
+                    uint32_t b = pointOf[triangles[t + (e + 1) % 3]];
+                    edgeUse[(uint64_t(std::min(a, b)) << 32) | std::max(a, b)]++;
+                }
+            }
+            for (const auto& [edge, count] : edgeUse)
+            {
+                if (count != 2)
+                {
+                    locked[static_cast<uint32_t>(edge >> 32)] = true;
+                    locked[static_cast<uint32_t>(edge)] = true;
+                }
+            }
+        }
+
+        std::vector<Quadric> quadrics(vertexCount);
+        glm::vec3 minBounds(std::numeric_limits<float>::max());
+        glm::vec3 maxBounds(std::numeric_limits<float>::lowest());
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            minBounds = glm::min(minBounds, position(v));
+            maxBounds = glm::max(maxBounds, position(v));
+        }
+        for (size_t t = 0; t < triangles.size(); t += 3)
+        {
+            glm::vec3 normal = TriangleNormal(position(triangles[t]), position(triangles[t + 1]), position(triangles[t + 2]));
+            float length = glm::length(normal);
+            if (length <= 0.0f)
+                continue;
+            normal /= length;
+            double distance = -glm::dot(normal, position(triangles[t]));
+            for (int c = 0; c < 3; c++)
+                quadrics[pointOf[triangles[t + c]]].AddPlane(normal, distance, length * 0.5);
+        }
+
+        // attribute error is expressed in model units so it can be mixed with the geometric error
+        const double attributeScale = double(attributeWeight) * glm::length(maxBounds - minBounds) * 0.5;
+        auto attributeError = [&](uint32_t from, uint32_t to)
+        {
+            const shaderio::InstancedVertexData& a = vertices[globalVertex[from]];
+            const shaderio::InstancedVertexData& b = vertices[globalVertex[to]];
+            double uvX = a.texcoords.x - b.texcoords.x;
+            double uvY = a.texcoords.y - b.texcoords.y;
+            double normalError = 1.0 - glm::dot(a.normals, b.normals);
+            return attributeScale * attributeScale * (uvX * uvX + uvY * uvY + normalError * 0.5);
+        };
+
+        std::vector<uint32_t> remap(vertexCount);
+        std::vector<bool> touched(vertexCount);
+        std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+        std::vector<uint32_t> adjacency;
+        std::vector<Collapse> collapses;
+        double maxCost = 0.0;
+
+        // Every wedge of 'from' moves to the wedge of 'to' it shares a triangle with, a wedge without one
+        // would have to jump across the seam, so the collapse is refused. Returns false or fills 'targets'.
+        auto findWedgeTargets = [&](uint32_t from, uint32_t to, std::vector<std::pair<uint32_t, uint32_t>>& targets)
+        {
+            targets.clear();
+            uint32_t wedge = from;
+            do
+            {
+                uint32_t target = UINT32_MAX;
+                bool referenced = false; // wedges that are no longer used don't need a target
+                for (uint32_t a = adjacencyOffsets[from]; a < adjacencyOffsets[from + 1] && target == UINT32_MAX; a++)
+                {
+                    const uint32_t* triangle = &triangles[adjacency[a] * 3];
+                    if (triangle[0] != wedge && triangle[1] != wedge && triangle[2] != wedge)
+                        continue;
+                    referenced = true;
+                    for (int c = 0; c < 3; c++)
+                    {
+                        if (pointOf[triangle[c]] == to)
+                            target = triangle[c];
+                    }
+                }
+                if (referenced)
+                {
+                    if (target == UINT32_MAX)
+                        return false;
+                    targets.emplace_back(wedge, target);
+                }
+                wedge = nextWedge[wedge];
+            } while (wedge != from);
+            return true;
+        };
+
+        // cost of moving point 'from' onto point 'to', as squared distance
+        std::vector<std::pair<uint32_t, uint32_t>> wedgeTargets;
+        auto collapseCost = [&](uint32_t from, uint32_t to)
+        {
+            if (locked[from] || !findWedgeTargets(from, to, wedgeTargets))
+                return std::numeric_limits<double>::max();
+
+            const Quadric& qFrom = quadrics[from];
+            const Quadric& qTo = quadrics[to];
+            double weight = qFrom.Weight + qTo.Weight;
+            double cost = weight > 0 ? (qFrom.Evaluate(position(to)) + qTo.Evaluate(position(to))) / weight : 0.0;
+            for (const auto& [wedge, target] : wedgeTargets)
+                cost += attributeError(wedge, target);
+            return cost;
+        };
+
+        // pass based: pick the cheapest independent collapses, apply them all, rebuild, repeat
+        while (triangles.size() > targetIndexCount)
+        {
+            // triangles around each point
+            std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+            for (uint32_t index : triangles)
+                adjacencyOffsets[pointOf[index] + 1]++;
+            for (uint32_t v = 0; v < vertexCount; v++)
+                adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+            adjacency.resize(triangles.size());
+            std::vector<uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t i = 0; i < triangles.size(); i++)
+                adjacency[cursor[pointOf[triangles[i]]]++] = static_cast<uint32_t>(i / 3);
+
+            collapses.clear();
+            for (size_t t = 0; t < triangles.size(); t += 3)
+            {
+                for (int e = 0; e < 3; e++)
+                {
+                    uint32_t a = pointOf[triangles[t + e]];
+                    uint32_t b = pointOf[triangles[t + (e + 1) % 3]];
+                    if (a > b)
+                        continue; // interior edges are seen twice, once in each winding
+
+                    double costA = collapseCost(a, b);
+                    double costB = collapseCost(b, a);
+                    if (costA == std::numeric_limits<double>::max() && costB == std::numeric_limits<double>::max())
+                        continue;
+                    collapses.push_back(costA <= costB ? Collapse{ a, b, costA } : Collapse{ b, a, costB });
+                }
+            }
+
+            if (collapses.empty())
+                break;
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse& l, const Collapse& r) { return l.Cost < r.Cost; });
+
+            for (uint32_t v = 0; v < vertexCount; v++)
+                remap[v] = v;
+            std::fill(touched.begin(), touched.end(), false);
+
+            // each collapse removes about two triangles
+            size_t trianglesToRemove = (triangles.size() - targetIndexCount) / 3;
+            size_t collapseBudget = std::max<size_t>(trianglesToRemove / 2, 1);
+            size_t applied = 0;
+
+            for (const Collapse& collapse : collapses)
+            {
+                if (applied >= collapseBudget)
+                    break;
+                if (touched[collapse.From] || touched[collapse.To])
+                    continue;
+
+                // moving 'From' must not flip any triangle that survives the collapse
+                bool flips = false;
+                const glm::vec3& target = position(collapse.To);
+                for (uint32_t a = adjacencyOffsets[collapse.From]; a < adjacencyOffsets[collapse.From + 1] && !flips; a++)
+                {
+                    const uint32_t* triangle = &triangles[adjacency[a] * 3];
+                    uint32_t points[3] = { pointOf[triangle[0]], pointOf[triangle[1]], pointOf[triangle[2]] };
+                    if (points[0] == collapse.To || points[1] == collapse.To || points[2] == collapse.To)
+                        continue;
+
+                    glm::vec3 corners[3] = { position(triangle[0]), position(triangle[1]), position(triangle[2]) };
+                    glm::vec3 before = TriangleNormal(corners[0], corners[1], corners[2]);
+                    for (int c = 0; c < 3; c++)
+                    {
+                        if (points[c] == collapse.From)
+                            corners[c] = target;
+                    }
+                    glm::vec3 after = TriangleNormal(corners[0], corners[1], corners[2]);
+                    // a strong rotation is rejected too, those add up to flips over several passes
+                    flips = glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after);
+                }
+                if (flips || !findWedgeTargets(collapse.From, collapse.To, wedgeTargets))
+                    continue;
+
+                for (const auto& [wedge, wedgeTarget] : wedgeTargets)
+                    remap[wedge] = wedgeTarget;
+                quadrics[collapse.To].Add(quadrics[collapse.From]);
+                maxCost = std::max(maxCost, collapse.Cost);
+                applied++;
+
+                // the one ring of 'From' changes, keep it stable for the rest of this pass
+                for (uint32_t a = adjacencyOffsets[collapse.From]; a < adjacencyOffsets[collapse.From + 1]; a++)
+                {
+                    const uint32_t* triangle = &triangles[adjacency[a] * 3];
+                    for (int c = 0; c < 3; c++)
+                        touched[pointOf[triangle[c]]] = true;
+                }
+            }
+
+            if (applied == 0)
+                break;
+
+            size_t write = 0;
+            for (size_t t = 0; t < triangles.size(); t += 3)
+            {
+                uint32_t a = remap[triangles[t]];
+                uint32_t b = remap[triangles[t + 1]];
+                uint32_t c = remap[triangles[t + 2]];
+                if (pointOf[a] == pointOf[b] || pointOf[b] == pointOf[c] || pointOf[a] == pointOf[c])
+                    continue;
+                triangles[write++] = a;
+                triangles[write++] = b;
+                triangles[write++] = c;
+            }
+            triangles.resize(write);
+        }
+
+        outIndices.resize(triangles.size());
+        for (size_t i = 0; i < triangles.size(); i++)
+            outIndices[i] = globalVertex[triangles[i]];
+
+        return static_cast<float>(std::sqrt(maxCost));
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <span>
+#include <vector>
+
+#include "Geometry.h"
+
+namespace VanK
+{
+    // Import time LOD chain, part of the cooked mesh cache key
+    struct MeshLodSettings
+    {
+        uint32_t MaxLods = 5;          // including LOD 0
+        float Reduction = 0.5f;        // target index count of a level relative to the previous one
+        float MinReduction = 0.85f;    // stop the chain once a level keeps more than this of its parent
+        float AttributeWeight = 0.05f; // uv/normal change, relative to the mesh radius
+    };
+
+    // Quadric error edge collapse simplifier. Collapses are half edge (a vertex moves onto a neighbour),
+    // so every level indexes the original vertices and only the index buffer grows. Seam vertices move
+    // together with their wedge on the same side, open borders are locked and collapses that would
+    // flip a triangle are rejected.
+    class MeshSimplifier
+    {
+    public:
+        // returns the geometric error of the result in model units
+        static float Simplify(std::span<const shaderio::InstancedVertexData> vertices, std::span<const uint32_t> indices,
+                              size_t targetIndexCount, float attributeWeight, std::vector<uint32_t>& outIndices);
+    };
+}
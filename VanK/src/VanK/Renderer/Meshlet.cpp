@@ -0,0 +1,139 @@
+#include "Meshlet.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace VanK
+{
+    namespace
+    {
+        void ComputeBounds(std::span<const shaderio::InstancedVertexData> vertices, std::span<const uint32_t> indices,
+                           shaderio::Meshlet& meshlet)
+        {
+            const uint32_t* triangles = indices.data() + meshlet.firstIndex;
+            const uint32_t cornerCount = meshlet.triangleCount * 3;
+
+            // bounding sphere: AABB center, radius to the farthest corner
+            glm::vec3 minBounds(std::numeric_limits<float>::max());
+            glm::vec3 maxBounds(std::numeric_limits<float>::lowest());
+            for (uint32_t i = 0; i < cornerCount; i++)
+            {
+                minBounds = glm::min(minBounds, vertices[triangles[i]].position);
+                maxBounds = glm::max(maxBounds, vertices[triangles[i]].position);
+            }
+            glm::vec3 center = (minBounds + maxBounds) * 0.5f;
+            float radiusSquared = 0.0f;
+            for (uint32_t i = 0; i < cornerCount; i++)
+            {
+                glm::vec3 offset = vertices[triangles[i]].position - center;
+                radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+            }
+            meshlet.center = center;
+            meshlet.radius = std::sqrt(radiusSquared);
+
+            // normal cone: average face normal, spread is the widest face normal from it
+            std::vector<glm::vec3> normals;
+            normals.reserve(meshlet.triangleCount);
+            glm::vec3 axis(0.0f);
+            for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+            {
+                const glm::vec3& p0 = vertices[triangles[t * 3 + 0]].position;
+                const glm::vec3& p1 = vertices[triangles[t * 3 + 1]].position;
+                const glm::vec3& p2 = vertices[triangles[t * 3 + 2]].position;
+                glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+                float length = glm::length(normal);
+                if (length <= 0.0f)
+                    continue; // degenerate triangles can't be back facing
+                normals.push_back(normal / length);
+                axis += normals.back();
+            }
+
+            meshlet.coneAxis = glm::vec3(0.0f);
+            meshlet.coneCutoff = 1.0f;
+
+            float axisLength = glm::length(axis);
+            if (axisLength <= 0.0f || normals.empty())
+                return;
+            axis /= axisLength;
+
+            float minDot = 1.0f;
+            for (const glm::vec3& normal : normals)
+                minDot = std::min(minDot, glm::dot(normal, axis));
+
+            // cone wider than a hemisphere, some triangle is always visible
+            if (minDot <= 0.0f)
+                return;
+
+            // tested as dot(center - camera, axis) >= cutoff * |center - camera| + radius
+            meshlet.coneAxis = axis;
+            meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+        }
+    }
+
+    void MeshletBuilder::Build(std::span<const shaderio::InstancedVertexData> vertices, std::span<const uint32_t> indices,
+                               uint32_t firstIndex, uint32_t indexCount, std::vector<shaderio::Meshlet>& outMeshlets)
+    {
+        if (indexCount < 3)
+            return;
+
+        // stamp per vertex: index of the meshlet that last referenced it, avoids clearing a set per meshlet.
+        // Only spans the vertices this index range uses, meshes are small slices of the shared vertex array.
+        auto [minIndex, maxIndex] = std::minmax_element(indices.begin() + firstIndex, indices.begin() + firstIndex + indexCount);
+        const uint32_t baseVertex = *minIndex;
+        std::vector<uint32_t> lastMeshlet(*maxIndex - baseVertex + 1, UINT32_MAX);
+
+        shaderio::Meshlet current{};
+        current.firstIndex = firstIndex;
+        uint32_t meshletId = static_cast<uint32_t>(outMeshlets.size());
+
+        auto flush = [&]()
+        {
+            if (current.triangleCount == 0)
+                return;
+            ComputeBounds(vertices, indices, current);
+            outMeshlets.push_back(current);
+            meshletId++;
+
+            uint32_t next = current.firstIndex + current.triangleCount * 3;
+            current = {};
+            current.firstIndex = next;
+        };
+
+        const uint32_t lastIndex = firstIndex + indexCount - indexCount % 3;
+        for (uint32_t i = firstIndex; i < lastIndex; i += 3)
+        {
+            const uint32_t a = indices[i + 0] - baseVertex;
+            const uint32_t b = indices[i + 1] - baseVertex;
+            const uint32_t c = indices[i + 2] - baseVertex;
+
+            auto countNewVertices = [&]()
+            {
+                uint32_t count = lastMeshlet[a] != meshletId;
+                count += b != a && lastMeshlet[b] != meshletId;
+                count += c != a && c != b && lastMeshlet[c] != meshletId;
+                return count;
+            };
+
+            uint32_t newVertices = countNewVertices();
+            if (current.vertexCount + newVertices > shaderio::MeshletMaxVertices || current.triangleCount == shaderio::MeshletMaxTriangles)
+            {
+                flush();
+                newVertices = countNewVertices();
+            }
+
+            lastMeshlet[a] = lastMeshlet[b] = lastMeshlet[c] = meshletId;
+            current.vertexCount += newVertices;
+            current.triangleCount++;
+        }
+        flush();
+    }
+
+    uint64_t MeshletBuilder::CountTriangles(std::span<const shaderio::Meshlet> meshlets)
+    {
+        uint64_t triangles = 0;
+        for (const shaderio::Meshlet& meshlet : meshlets)
+            triangles += meshlet.triangleCount;
+        return triangles;
+    }
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <span>
+#include <vector>
+
+#include "Geometry.h"
+
+namespace VanK
+{
+    // Splits indexed triangle lists into meshlets (shaderio::MeshletMaxVertices / MeshletMaxTriangles).
+    // Triangles are taken in index order, so every meshlet is a contiguous index range and the
+    // index buffer can be drawn per meshlet through DrawIndexedIndirectCount without reordering.
+    class MeshletBuilder
+    {
+    public:
+        static void Build(std::span<const shaderio::InstancedVertexData> vertices, std::span<const uint32_t> indices,
+                          uint32_t firstIndex, uint32_t indexCount, std::vector<shaderio::Meshlet>& outMeshlets);
+
+        static uint64_t CountTriangles(std::span<const shaderio::Meshlet> meshlets);
+    };
+}
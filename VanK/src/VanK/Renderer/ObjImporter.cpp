@@ -0,0 +1,457 @@
+#include "ObjImporter.h"
+
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string_view>
+
+#include "VanK/Core/JobSystem.h"
+#include "VanK/Core/Log.h"
+#include "VanK/Core/Timer.h"
+
+namespace VanK
+{
+    namespace
+    {
+        constexpr int32_t OBJ_MISSING_INDEX = -1;
+
+        // index into the global attribute arrays, Relative bits mark negative OBJ indices that still need the chunk base added
+        struct ObjCorner
+        {
+            int32_t Position;
+            int32_t TexCoord;
+            int32_t Normal;
+            uint32_t RelativeMask;
+        };
+
+        struct ObjObjectMarker
+        {
+            std::string Name;
+            size_t FirstCorner;
+        };
+
+        struct ObjChunk
+        {
+            std::vector<glm::vec3> Positions;
+            std::vector<glm::vec2> TexCoords;
+            std::vector<glm::vec3> Normals;
+            std::vector<ObjCorner> Corners; // already triangulated, 3 per triangle
+            std::vector<uint32_t> TriangleLines; // chunk local line of the face every triangle came from
+            std::vector<ObjObjectMarker> Objects;
+            std::vector<std::string> MaterialLibraries;
+            size_t LineCount = 0;
+            std::string Error;
+            size_t ErrorLine = 0; // chunk local
+        };
+
+        bool IsSpace(char c)
+        {
+            return c == ' ' || c == '\t' || c == '\r';
+        }
+
+        const char* SkipSpaces(const char* ptr, const char* end)
+        {
+            while (ptr < end && IsSpace(*ptr))
+                ptr++;
+            return ptr;
+        }
+
+        const char* ParseFloats(const char* ptr, const char* end, float* out, int count)
+        {
+            for (int i = 0; i < count; i++)
+            {
+                ptr = SkipSpaces(ptr, end);
+                auto result = std::from_chars(ptr, end, out[i]);
+                if (result.ec != std::errc())
+                    return nullptr;
+                ptr = result.ptr;
+            }
+            return ptr;
+        }
+
+        std::string_view RestOfLine(const char* ptr, const char* end)
+        {
+            ptr = SkipSpaces(ptr, end);
+            const char* last = end;
+            while (last > ptr && IsSpace(last[-1]))
+                last--;
+            return { ptr, static_cast<size_t>(last - ptr) };
+        }
+
+        // OBJ indices are 1 based, negative ones are relative to the attributes seen so far. 0 is invalid, a relative
+        // index reaching before the chunk is resolved once the chunk bases are known.
+        bool ResolveIndex(int32_t raw, size_t localCount, int32_t& out, uint32_t& relativeMask, uint32_t bit)
+        {
+            if (raw > 0)
+            {
+                out = raw - 1;
+                return true;
+            }
+            if (raw < 0)
+            {
+                out = static_cast<int32_t>(localCount) + raw;
+                relativeMask |= bit;
+                return true;
+            }
+            return false;
+        }
+
+        bool ParseCorner(const char*& ptr, const char* end, const ObjChunk& chunk, ObjCorner& corner)
+        {
+            corner = { OBJ_MISSING_INDEX, OBJ_MISSING_INDEX, OBJ_MISSING_INDEX, 0 };
+
+            int32_t raw = 0;
+            auto result = std::from_chars(ptr, end, raw);
+            if (result.ec != std::errc() || !ResolveIndex(raw, chunk.Positions.size(), corner.Position, corner.RelativeMask, 1))
+                return false;
+            ptr = result.ptr;
+
+            if (ptr < end && *ptr == '/')
+            {
+                ptr++;
+                if (ptr < end && *ptr != '/')
+                {
+                    result = std::from_chars(ptr, end, raw);
+                    if (result.ec != std::errc() || !ResolveIndex(raw, chunk.TexCoords.size(), corner.TexCoord, corner.RelativeMask, 2))
+                        return false;
+                    ptr = result.ptr;
+                }
+                if (ptr < end && *ptr == '/')
+                {
+                    ptr++;
+                    result = std::from_chars(ptr, end, raw);
+                    if (result.ec != std::errc() || !ResolveIndex(raw, chunk.Normals.size(), corner.Normal, corner.RelativeMask, 4))
+                        return false;
+                    ptr = result.ptr;
+                }
+            }
+            return true;
+        }
+
+        void ParseChunk(const char* begin, const char* end, ObjChunk& chunk)
+        {
+            std::vector<ObjCorner> face;
+            size_t lineNumber = 0;
+
+            for (const char* line = begin; line < end;)
+            {
+                const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', end - line));
+                if (!lineEnd)
+                    lineEnd = end;
+                lineNumber++;
+
+                const char* ptr = SkipSpaces(line, lineEnd);
+                const size_t length = lineEnd - ptr;
+                bool ok = true;
+
+                if (length >= 2 && ptr[0] == 'v' && IsSpace(ptr[1]))
+                {
+                    glm::vec3& position = chunk.Positions.emplace_back();
+                    ok = ParseFloats(ptr + 2, lineEnd, &position.x, 3) != nullptr;
+                }
+                else if (length >= 3 && ptr[0] == 'v' && ptr[1] == 't' && IsSpace(ptr[2]))
+                {
+                    // v (and w, which is ignored) are optional and default to 0
+                    glm::vec2& texCoord = chunk.TexCoords.emplace_back(0.0f);
+                    const char* cursor = ParseFloats(ptr + 3, lineEnd, &texCoord.x, 1);
+                    ok = cursor != nullptr;
+                    if (ok && SkipSpaces(cursor, lineEnd) < lineEnd)
+                        ok = ParseFloats(cursor, lineEnd, &texCoord.y, 1) != nullptr;
+                    texCoord.y = 1.0f - texCoord.y; // OBJ is bottom-left origin, match the glTF convention
+                }
+                else if (length >= 3 && ptr[0] == 'v' && ptr[1] == 'n' && IsSpace(ptr[2]))
+                {
+                    glm::vec3& normal = chunk.Normals.emplace_back();
+                    ok = ParseFloats(ptr + 3, lineEnd, &normal.x, 3) != nullptr;
+                }
+                else if (length >= 2 && ptr[0] == 'f' && IsSpace(ptr[1]))
+                {
+                    face.clear();
+                    const char* cursor = SkipSpaces(ptr + 2, lineEnd);
+                    while (ok && cursor < lineEnd)
+                    {
+                        ObjCorner corner;
+                        ok = ParseCorner(cursor, lineEnd, chunk, corner);
+                        face.push_back(corner);
+                        cursor = SkipSpaces(cursor, lineEnd);
+                    }
+
+                    // fan triangulation for quads/ngons
+                    ok = ok && face.size() >= 3;
+                    for (size_t i = 2; ok && i < face.size(); i++)
+                    {
+                        chunk.Corners.push_back(face[0]);
+                        chunk.Corners.push_back(face[i - 1]);
+                        chunk.Corners.push_back(face[i]);
+                        chunk.TriangleLines.push_back(static_cast<uint32_t>(lineNumber));
+                    }
+                }
+                else if (length >= 2 && (ptr[0] == 'o' || ptr[0] == 'g') && IsSpace(ptr[1]))
+                {
+                    chunk.Objects.push_back({ std::string(RestOfLine(ptr + 2, lineEnd)), chunk.Corners.size() });
+                }
+                else if (length >= 7 && std::strncmp(ptr, "mtllib", 6) == 0 && IsSpace(ptr[6]))
+                {
+                    chunk.MaterialLibraries.emplace_back(RestOfLine(ptr + 7, lineEnd));
+                }
+                // comments, 's', 'usemtl' and unknown statements are ignored
+
+                if (!ok)
+                {
+                    chunk.Error = "malformed statement '" + std::string(RestOfLine(line, lineEnd)) + "'";
+                    chunk.ErrorLine = lineNumber;
+                    return;
+                }
+
+                line = lineEnd + 1;
+            }
+            chunk.LineCount = lineNumber;
+        }
+
+        // open addressing map (v, vt, vn) -> vertex id, reset per object
+        class CornerTable
+        {
+        public:
+            void Reset(size_t expectedCount)
+            {
+                size_t capacity = 16;
+                while (capacity < expectedCount * 2)
+                    capacity <<= 1;
+                m_Keys.assign(capacity, ObjCorner{ OBJ_MISSING_INDEX, OBJ_MISSING_INDEX, OBJ_MISSING_INDEX, UINT32_MAX });
+                m_Values.resize(capacity);
+                m_Mask = capacity - 1;
+            }
+
+            // returns true if the corner was inserted (new vertex)
+            bool FindOrInsert(const ObjCorner& key, uint32_t newValue, uint32_t& outValue)
+            {
+                uint64_t hash = static_cast<uint32_t>(key.Position) * 0x9E3779B97F4A7C15ull;
+                hash ^= (static_cast<uint32_t>(key.TexCoord) + 0x7F4A7C15ull) * 0xC2B2AE3D27D4EB4Full;
+                hash ^= (static_cast<uint32_t>(key.Normal) + 0x165667B1ull) * 0x165667B19E3779F9ull;
+                hash ^= hash >> 29;
+
+                for (size_t slot = hash & m_Mask;; slot = (slot + 1) & m_Mask)
+                {
+                    ObjCorner& stored = m_Keys[slot];
+                    if (stored.RelativeMask == UINT32_MAX)
+                    {
+                        stored = { key.Position, key.TexCoord, key.Normal, 0 };
+                        m_Values[slot] = newValue;
+                        outValue = newValue;
+                        return true;
+                    }
+                    if (stored.Position == key.Position && stored.TexCoord == key.TexCoord && stored.Normal == key.Normal)
+                    {
+                        outValue = m_Values[slot];
+                        return false;
+                    }
+                }
+            }
+        private:
+            std::vector<ObjCorner> m_Keys;
+            std::vector<uint32_t> m_Values;
+            size_t m_Mask = 0;
+        };
+    }
+
+    void ObjImporter::Import(const std::string& path, std::vector<shaderio::InstancedVertexData>& vertices,
+                             std::vector<uint32_t>& indices, std::vector<CookedMeshRange>& ranges,
+                             std::vector<ObjMaterial>* materials, uint32_t threadCount)
+    {
+        Timer timer;
+        MappedFile file(path);
+        if (!file.IsValid())
+            throw std::runtime_error("OBJ: failed to map '" + path + "'");
+
+        const char* data = reinterpret_cast<const char*>(file.Data());
+        const size_t size = file.Size();
+
+        // 1. split into line aligned chunks (small files are not worth the threads)
+        if (threadCount == 0)
+            threadCount = JobSystem::Get().GetThreadCount();
+        constexpr size_t minChunkSize = 256 * 1024;
+        const size_t chunkCount = std::clamp<size_t>(size / minChunkSize, 1, threadCount);
+
+        std::vector<const char*> bounds(chunkCount + 1);
+        bounds[0] = data;
+        bounds[chunkCount] = data + size;
+        for (size_t i = 1; i < chunkCount; i++)
+        {
+            const char* split = std::max(bounds[i - 1], data + size * i / chunkCount);
+            const char* newline = static_cast<const char*>(std::memchr(split, '\n', data + size - split));
+            bounds[i] = newline ? newline + 1 : data + size;
+        }
+
+        // 2. parse every chunk in parallel
+        std::vector<ObjChunk> chunks(chunkCount);
+        JobSystem::Get().ParallelFor(static_cast<uint32_t>(chunkCount), 1, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t i = begin; i < end; i++)
+                ParseChunk(bounds[i], bounds[i + 1], chunks[i]);
+        });
+
+        // chunk local line numbers become file lines by adding the lines of the chunks before
+        std::vector<size_t> lineBases(chunkCount);
+        for (size_t i = 0; i < chunkCount; i++)
+        {
+            lineBases[i] = i == 0 ? 0 : lineBases[i - 1] + chunks[i - 1].LineCount;
+            if (!chunks[i].Error.empty())
+                throw std::runtime_error("OBJ: " + chunks[i].Error + " at line " + std::to_string(lineBases[i] + chunks[i].ErrorLine) +
+                                         " in '" + path + "'");
+        }
+        auto faceError = [&path](size_t line)
+        {
+            return std::runtime_error("OBJ: face index out of range at line " + std::to_string(line) + " in '" + path + "'");
+        };
+
+        // 3. stitch the attribute streams together, chunk bases resolve the relative indices
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec2> texCoords;
+        std::vector<glm::vec3> normals;
+        std::vector<ObjCorner> corners;
+        std::vector<uint32_t> triangleLines;
+        std::vector<ObjObjectMarker> objects;
+        std::vector<std::string> materialLibraries;
+
+        for (size_t chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++)
+        {
+            ObjChunk& chunk = chunks[chunkIndex];
+            const int32_t positionBase = static_cast<int32_t>(positions.size());
+            const int32_t texCoordBase = static_cast<int32_t>(texCoords.size());
+            const int32_t normalBase = static_cast<int32_t>(normals.size());
+            const size_t cornerBase = corners.size();
+
+            for (size_t c = 0; c < chunk.Corners.size(); c++)
+            {
+                ObjCorner corner = chunk.Corners[c];
+                if (corner.RelativeMask & 1) corner.Position += positionBase;
+                if (corner.RelativeMask & 2) corner.TexCoord += texCoordBase;
+                if (corner.RelativeMask & 4) corner.Normal += normalBase;
+                // a relative index that still points before the first attribute reached past the start of the file
+                if (((corner.RelativeMask & 1) && corner.Position < 0) || ((corner.RelativeMask & 2) && corner.TexCoord < 0) ||
+                    ((corner.RelativeMask & 4) && corner.Normal < 0))
+                {
+                    throw faceError(lineBases[chunkIndex] + chunk.TriangleLines[c / 3]);
+                }
+                corner.RelativeMask = 0;
+                corners.push_back(corner);
+            }
+            for (uint32_t line : chunk.TriangleLines)
+                triangleLines.push_back(static_cast<uint32_t>(lineBases[chunkIndex] + line));
+            for (ObjObjectMarker& object : chunk.Objects)
+                objects.push_back({ std::move(object.Name), object.FirstCorner + cornerBase });
+
+            positions.insert(positions.end(), chunk.Positions.begin(), chunk.Positions.end());
+            texCoords.insert(texCoords.end(), chunk.TexCoords.begin(), chunk.TexCoords.end());
+            normals.insert(normals.end(), chunk.Normals.begin(), chunk.Normals.end());
+            materialLibraries.insert(materialLibraries.end(), chunk.MaterialLibraries.begin(), chunk.MaterialLibraries.end());
+            chunk = {};
+        }
+
+        if (objects.empty() || objects.front().FirstCorner != 0)
+            objects.insert(objects.begin(), { std::string(), 0 });
+
+        // 4. dedup corners per object so every range owns a contiguous vertex block like the glTF path
+        CornerTable table;
+        size_t meshIndex = 0;
+        for (size_t objectIndex = 0; objectIndex < objects.size(); objectIndex++)
+        {
+            const size_t firstCorner = objects[objectIndex].FirstCorner;
+            const size_t lastCorner = objectIndex + 1 < objects.size() ? objects[objectIndex + 1].FirstCorner : corners.size();
+            if (firstCorner == lastCorner)
+                continue;
+
+            CookedMeshRange range{};
+            std::string name = objects[objectIndex].Name.empty() ? "mesh_" + std::to_string(meshIndex) : objects[objectIndex].Name;
+            std::strncpy(range.Name, name.c_str(), sizeof(range.Name) - 1);
+            range.VertexOffset = static_cast<uint32_t>(vertices.size());
+            range.IndexOffset = static_cast<uint32_t>(indices.size());
+            meshIndex++;
+
+            table.Reset(lastCorner - firstCorner);
+            indices.reserve(indices.size() + (lastCorner - firstCorner));
+            for (size_t c = firstCorner; c < lastCorner; c++)
+            {
+                const ObjCorner& corner = corners[c];
+                // negative texcoord and normal indices are the missing ones now, everything else has to exist
+                if (corner.Position < 0 || static_cast<size_t>(corner.Position) >= positions.size() ||
+                    corner.TexCoord >= static_cast<int32_t>(texCoords.size()) || corner.Normal >= static_cast<int32_t>(normals.size()))
+                {
+                    throw faceError(triangleLines[c / 3]);
+                }
+
+                uint32_t vertexIndex;
+                if (table.FindOrInsert(corner, static_cast<uint32_t>(vertices.size()), vertexIndex))
+                {
+                    shaderio::InstancedVertexData& vertex = vertices.emplace_back();
+                    vertex.position = positions[corner.Position];
+                    if (corner.TexCoord >= 0)
+                        vertex.texcoords = texCoords[corner.TexCoord];
+                    if (corner.Normal >= 0)
+                        vertex.normals = normals[corner.Normal];
+                }
+                indices.push_back(vertexIndex);
+            }
+
+            range.VertexCount = static_cast<uint32_t>(vertices.size()) - range.VertexOffset;
+            range.IndexCount = static_cast<uint32_t>(indices.size()) - range.IndexOffset;
+            ranges.push_back(range);
+        }
+
+        if (materials)
+        {
+            std::filesystem::path folder = std::filesystem::path(path).parent_path();
+            for (const std::string& library : materialLibraries)
+            {
+                std::vector<ObjMaterial> loaded = LoadMaterials((folder / library).string());
+                materials->insert(materials->end(), loaded.begin(), loaded.end());
+            }
+        }
+
+        const float seconds = timer.Elapsed();
+        VK_CORE_INFO("[ObjImporter] '{}': {:.2f} MB in {:.2f} ms ({:.1f} MB/s, {} threads) -> {} vertices, {} indices, {} meshes",
+                     path, size / (1024.0 * 1024.0), seconds * 1000.0f, size / (1024.0 * 1024.0) / seconds, chunkCount,
+                     vertices.size(), indices.size(), ranges.size());
+    }
+
+    std::vector<ObjMaterial> ObjImporter::LoadMaterials(const std::string& path)
+    {
+        std::vector<ObjMaterial> materials;
+        MappedFile file(path);
+        if (!file.IsValid())
+        {
+            VK_CORE_WARN("[ObjImporter] material library '{}' not found", path);
+            return materials;
+        }
+
+        const char* data = reinterpret_cast<const char*>(file.Data());
+        const char* end = data + file.Size();
+        for (const char* line = data; line < end;)
+        {
+            const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', end - line));
+            if (!lineEnd)
+                lineEnd = end;
+
+            const char* ptr = SkipSpaces(line, lineEnd);
+            const size_t length = lineEnd - ptr;
+            if (length >= 7 && std::strncmp(ptr, "newmtl", 6) == 0 && IsSpace(ptr[6]))
+            {
+                materials.push_back({ .Name = std::string(RestOfLine(ptr + 7, lineEnd)) });
+            }
+            else if (!materials.empty() && length >= 3 && ptr[0] == 'K' && ptr[1] == 'd' && IsSpace(ptr[2]))
+            {
+                glm::vec3 diffuse;
+                if (ParseFloats(ptr + 3, lineEnd, &diffuse.x, 3))
+                    materials.back().Diffuse = diffuse;
+            }
+            else if (!materials.empty() && length >= 7 && std::strncmp(ptr, "map_Kd", 6) == 0 && IsSpace(ptr[6]))
+            {
+                materials.back().DiffuseTexture = RestOfLine(ptr + 7, lineEnd);
+            }
+
+            line = lineEnd + 1;
+        }
+        return materials;
+    }
+}
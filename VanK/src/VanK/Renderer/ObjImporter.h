@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "MeshCache.h"
+
+namespace VanK
+{
+    struct ObjMaterial
+    {
+        std::string Name;
+        glm::vec3 Diffuse = glm::vec3(0.8f);
+        std::string DiffuseTexture;
+    };
+
+    // Multithreaded OBJ/MTL importer. The mapped file is split into line aligned chunks that are parsed
+    // in parallel with std::from_chars, then the chunks are stitched together and (v, vt, vn) corners are
+    // deduplicated per object. Output matches the glTF path: interleaved vertices, rebased u32 indices,
+    // one range per 'o'/'g' block.
+    class ObjImporter
+    {
+    public:
+        // throws std::runtime_error on malformed files (with the line), threadCount caps the parse jobs, 0 = every JobSystem thread
+        static void Import(const std::string& path, std::vector<shaderio::InstancedVertexData>& vertices,
+                           std::vector<uint32_t>& indices, std::vector<CookedMeshRange>& ranges,
+                           std::vector<ObjMaterial>* materials = nullptr, uint32_t threadCount = 0);
+
+        static std::vector<ObjMaterial> LoadMaterials(const std::string& path);
+    };
+}
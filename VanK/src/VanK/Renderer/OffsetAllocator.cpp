@@ -0,0 +1,302 @@
+#include "OffsetAllocator.h"
+
+#include <bit>
+#include <cassert>
+
+namespace VanK
+{
+    namespace
+    {
+        // Sizes as a tiny float: 3 bit mantissa, 5 bit exponent, so bins are at most 12.5% apart.
+        // Below 8 the mantissa is the size itself.
+        constexpr uint32_t MANTISSA_BITS = 3;
+        constexpr uint32_t MANTISSA_VALUE = 1 << MANTISSA_BITS;
+        constexpr uint32_t MANTISSA_MASK = MANTISSA_VALUE - 1;
+
+        uint32_t SizeToBin(uint32_t size, bool roundUp)
+        {
+            if (size < MANTISSA_VALUE)
+                return size;
+
+            uint32_t highestSetBit = 31 - std::countl_zero(size);
+            uint32_t mantissaStartBit = highestSetBit - MANTISSA_BITS;
+            uint32_t exponent = mantissaStartBit + 1;
+            uint32_t mantissa = (size >> mantissaStartBit) & MANTISSA_MASK;
+
+            // rounding up can carry into the exponent, the add below handles that
+            uint32_t lowBitsMask = (1u << mantissaStartBit) - 1;
+            if (roundUp && (size & lowBitsMask) != 0)
+                mantissa++;
+
+            return (exponent << MANTISSA_BITS) + mantissa;
+        }
+
+        uint32_t FindLowestSetBitAfter(uint32_t bitMask, uint32_t startBitIndex)
+        {
+            uint32_t maskBeforeStartIndex = startBitIndex >= 32 ? 0xFFFFFFFF : (1u << startBitIndex) - 1;
+            uint32_t bitsAfter = bitMask & ~maskBeforeStartIndex;
+            if (bitsAfter == 0)
+                return OffsetAllocator::NO_SPACE;
+            return std::countr_zero(bitsAfter);
+        }
+    }
+
+    OffsetAllocator::OffsetAllocator()
+    {
+        for (uint32_t& binIndex : m_BinIndices)
+            binIndex = UNUSED;
+    }
+
+    OffsetAllocator::OffsetAllocator(uint32_t capacity)
+        : OffsetAllocator()
+    {
+        Grow(capacity);
+    }
+
+    OffsetAllocator::Allocation OffsetAllocator::Allocate(uint32_t size)
+    {
+        if (size == 0 || size > m_FreeStorage)
+            return {};
+
+        // smallest bin whose every node fits, then the first used bin at or above it
+        uint32_t minBinIndex = SizeToBin(size, true);
+        uint32_t minTopBinIndex = minBinIndex >> MANTISSA_BITS;
+        uint32_t minLeafBinIndex = minBinIndex & MANTISSA_MASK;
+
+        uint32_t topBinIndex = minTopBinIndex;
+        uint32_t leafBinIndex = NO_SPACE;
+        if (m_UsedBinsTop & (1u << topBinIndex))
+            leafBinIndex = FindLowestSetBitAfter(m_UsedBins[topBinIndex], minLeafBinIndex);
+
+        if (leafBinIndex == NO_SPACE)
+        {
+            topBinIndex = FindLowestSetBitAfter(m_UsedBinsTop, minTopBinIndex + 1);
+            if (topBinIndex == NO_SPACE)
+                return {};
+            leafBinIndex = std::countr_zero(static_cast<uint32_t>(m_UsedBins[topBinIndex]));
+        }
+
+        uint32_t binIndex = (topBinIndex << MANTISSA_BITS) | leafBinIndex;
+        uint32_t nodeIndex = m_BinIndices[binIndex];
+        RemoveNodeFromBin(nodeIndex);
+
+        Node& node = m_Nodes[nodeIndex];
+        uint32_t nodeTotalSize = node.DataSize;
+        node.DataSize = size;
+        node.Used = true;
+
+        // the rest goes back as a free neighbour right after the allocation
+        uint32_t remainder = nodeTotalSize - size;
+        if (remainder > 0)
+        {
+            uint32_t dataOffset = m_Nodes[nodeIndex].DataOffset;
+            uint32_t newNodeIndex = InsertNodeIntoBin(remainder, dataOffset + size);
+
+            Node& allocated = m_Nodes[nodeIndex];
+            Node& rest = m_Nodes[newNodeIndex];
+            if (allocated.NeighborNext != UNUSED)
+                m_Nodes[allocated.NeighborNext].NeighborPrev = newNodeIndex;
+            rest.NeighborPrev = nodeIndex;
+            rest.NeighborNext = allocated.NeighborNext;
+            allocated.NeighborNext = newNodeIndex;
+
+            if (m_LastNode == nodeIndex)
+                m_LastNode = newNodeIndex;
+        }
+
+        return { m_Nodes[nodeIndex].DataOffset, nodeIndex };
+    }
+
+    void OffsetAllocator::Free(Allocation allocation)
+    {
+        if (!allocation.IsValid())
+            return;
+
+        uint32_t nodeIndex = allocation.Metadata;
+        assert(nodeIndex < m_Nodes.size() && m_Nodes[nodeIndex].Used && "Double free or foreign allocation");
+
+        uint32_t offset = m_Nodes[nodeIndex].DataOffset;
+        uint32_t size = m_Nodes[nodeIndex].DataSize;
+
+        // swallow free neighbours on both sides
+        uint32_t prevIndex = m_Nodes[nodeIndex].NeighborPrev;
+        if (prevIndex != UNUSED && !m_Nodes[prevIndex].Used)
+        {
+            Node& prev = m_Nodes[prevIndex];
+            offset = prev.DataOffset;
+            size += prev.DataSize;
+
+            RemoveNodeFromBin(prevIndex);
+            m_Nodes[nodeIndex].NeighborPrev = m_Nodes[prevIndex].NeighborPrev;
+            ReleaseNode(prevIndex);
+        }
+
+        uint32_t nextIndex = m_Nodes[nodeIndex].NeighborNext;
+        if (nextIndex != UNUSED && !m_Nodes[nextIndex].Used)
+        {
+            size += m_Nodes[nextIndex].DataSize;
+
+            RemoveNodeFromBin(nextIndex);
+            m_Nodes[nodeIndex].NeighborNext = m_Nodes[nextIndex].NeighborNext;
+            if (m_LastNode == nextIndex)
+                m_LastNode = nodeIndex;
+            ReleaseNode(nextIndex);
+        }
+
+        uint32_t neighborPrev = m_Nodes[nodeIndex].NeighborPrev;
+        uint32_t neighborNext = m_Nodes[nodeIndex].NeighborNext;
+        bool wasLast = m_LastNode == nodeIndex;
+        ReleaseNode(nodeIndex);
+
+        uint32_t combinedIndex = InsertNodeIntoBin(size, offset);
+
+        m_Nodes[combinedIndex].NeighborPrev = neighborPrev;
+        m_Nodes[combinedIndex].NeighborNext = neighborNext;
+        if (neighborPrev != UNUSED)
+            m_Nodes[neighborPrev].NeighborNext = combinedIndex;
+        if (neighborNext != UNUSED)
+            m_Nodes[neighborNext].NeighborPrev = combinedIndex;
+        if (wasLast)
+            m_LastNode = combinedIndex;
+    }
+
+    void OffsetAllocator::Grow(uint32_t newCapacity)
+    {
+        if (newCapacity <= m_Capacity)
+            return;
+
+        uint32_t extra = newCapacity - m_Capacity;
+        uint32_t offset = m_Capacity;
+        uint32_t neighborPrev = m_LastNode;
+
+        // a free range at the end is extended instead of leaving two adjacent free nodes
+        if (m_LastNode != UNUSED && !m_Nodes[m_LastNode].Used)
+        {
+            offset = m_Nodes[m_LastNode].DataOffset;
+            extra += m_Nodes[m_LastNode].DataSize;
+            neighborPrev = m_Nodes[m_LastNode].NeighborPrev;
+
+            RemoveNodeFromBin(m_LastNode);
+            ReleaseNode(m_LastNode);
+        }
+
+        uint32_t nodeIndex = InsertNodeIntoBin(extra, offset);
+        m_Nodes[nodeIndex].NeighborPrev = neighborPrev;
+        m_Nodes[nodeIndex].NeighborNext = UNUSED;
+        if (neighborPrev != UNUSED)
+            m_Nodes[neighborPrev].NeighborNext = nodeIndex;
+
+        m_LastNode = nodeIndex;
+        m_Capacity = newCapacity;
+    }
+
+    uint32_t OffsetAllocator::GetAllocationSize(Allocation allocation) const
+    {
+        if (!allocation.IsValid())
+            return 0;
+        return m_Nodes[allocation.Metadata].DataSize;
+    }
+
+    OffsetAllocator::Stats OffsetAllocator::GetStats() const
+    {
+        Stats stats{};
+        stats.Capacity = m_Capacity;
+        stats.FreeSpace = m_FreeStorage;
+        stats.Nodes = static_cast<uint32_t>(m_Nodes.size() - m_FreeNodes.size());
+
+        // walk the address ordered list, it is short compared to the data it describes
+        for (uint32_t nodeIndex = m_LastNode; nodeIndex != UNUSED; nodeIndex = m_Nodes[nodeIndex].NeighborPrev)
+        {
+            const Node& node = m_Nodes[nodeIndex];
+            if (node.Used)
+            {
+                stats.Allocations++;
+                continue;
+            }
+            stats.FreeRegions++;
+            if (node.DataSize > stats.LargestFreeRegion)
+                stats.LargestFreeRegion = node.DataSize;
+        }
+        return stats;
+    }
+
+    uint32_t OffsetAllocator::InsertNodeIntoBin(uint32_t size, uint32_t dataOffset)
+    {
+        // round down, every node in a bin is at least as large as the bin's lower bound
+        uint32_t binIndex = SizeToBin(size, false);
+        uint32_t topBinIndex = binIndex >> MANTISSA_BITS;
+        uint32_t leafBinIndex = binIndex & MANTISSA_MASK;
+
+        if (m_BinIndices[binIndex] == UNUSED)
+        {
+            m_UsedBins[topBinIndex] |= 1u << leafBinIndex;
+            m_UsedBinsTop |= 1u << topBinIndex;
+        }
+
+        uint32_t topNodeIndex = m_BinIndices[binIndex];
+        uint32_t nodeIndex = AcquireNode();
+        Node& node = m_Nodes[nodeIndex];
+        node = {};
+        node.DataOffset = dataOffset;
+        node.DataSize = size;
+        node.BinListNext = topNodeIndex;
+        if (topNodeIndex != UNUSED)
+            m_Nodes[topNodeIndex].BinListPrev = nodeIndex;
+        m_BinIndices[binIndex] = nodeIndex;
+
+        m_FreeStorage += size;
+        return nodeIndex;
+    }
+
+    void OffsetAllocator::RemoveNodeFromBin(uint32_t nodeIndex)
+    {
+        Node& node = m_Nodes[nodeIndex];
+
+        if (node.BinListPrev != UNUSED)
+        {
+            m_Nodes[node.BinListPrev].BinListNext = node.BinListNext;
+            if (node.BinListNext != UNUSED)
+                m_Nodes[node.BinListNext].BinListPrev = node.BinListPrev;
+        }
+        else
+        {
+            // head of the bin list
+            uint32_t binIndex = SizeToBin(node.DataSize, false);
+            uint32_t topBinIndex = binIndex >> MANTISSA_BITS;
+            uint32_t leafBinIndex = binIndex & MANTISSA_MASK;
+
+            m_BinIndices[binIndex] = node.BinListNext;
+            if (node.BinListNext != UNUSED)
+                m_Nodes[node.BinListNext].BinListPrev = UNUSED;
+
+            if (m_BinIndices[binIndex] == UNUSED)
+            {
+                m_UsedBins[topBinIndex] &= ~(1u << leafBinIndex);
+                if (m_UsedBins[topBinIndex] == 0)
+                    m_UsedBinsTop &= ~(1u << topBinIndex);
+            }
+        }
+
+        node.BinListPrev = UNUSED;
+        node.BinListNext = UNUSED;
+        m_FreeStorage -= node.DataSize;
+    }
+
+    uint32_t OffsetAllocator::AcquireNode()
+    {
+        if (!m_FreeNodes.empty())
+        {
+            uint32_t nodeIndex = m_FreeNodes.back();
+            m_FreeNodes.pop_back();
+            return nodeIndex;
+        }
+        m_Nodes.emplace_back();
+        return static_cast<uint32_t>(m_Nodes.size() - 1);
+    }
+
+    void OffsetAllocator::ReleaseNode(uint32_t nodeIndex)
+    {
+        m_Nodes[nodeIndex] = {};
+        m_FreeNodes.push_back(nodeIndex);
+    }
+}
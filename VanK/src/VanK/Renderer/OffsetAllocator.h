@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace VanK
+{
+    // Two level segregated fit (TLSF) allocator for ranges inside one big GPU buffer. It only hands out
+    // offsets, the caller owns the memory. Sizes are binned on a 3 bit mantissa float scale, so the
+    // bin lookup is two bit scans and free ranges are coalesced with their neighbours on Free.
+    class OffsetAllocator
+    {
+    public:
+        static constexpr uint32_t NO_SPACE = 0xFFFFFFFF;
+
+        struct Allocation
+        {
+            uint32_t Offset = NO_SPACE;
+            uint32_t Metadata = NO_SPACE; // node index, needed by Free
+
+            bool IsValid() const { return Offset != NO_SPACE; }
+        };
+
+        struct Stats
+        {
+            uint32_t Capacity;
+            uint32_t FreeSpace;
+            uint32_t LargestFreeRegion;
+            uint32_t FreeRegions;
+            uint32_t Allocations;
+            uint32_t Nodes; // not on the free node list, Allocations + FreeRegions unless nodes leak
+        };
+
+        OffsetAllocator();
+        explicit OffsetAllocator(uint32_t capacity);
+
+        // returns an invalid allocation when no free range is large enough
+        Allocation Allocate(uint32_t size);
+        void Free(Allocation allocation);
+
+        // adds [capacity, newCapacity) as free space, merged with a free range at the end
+        void Grow(uint32_t newCapacity);
+
+        uint32_t GetCapacity() const { return m_Capacity; }
+        uint32_t GetAllocationSize(Allocation allocation) const;
+        Stats GetStats() const;
+
+    private:
+        static constexpr uint32_t NUM_TOP_BINS = 32;
+        static constexpr uint32_t BINS_PER_LEAF = 8;
+        static constexpr uint32_t NUM_LEAF_BINS = NUM_TOP_BINS * BINS_PER_LEAF;
+        static constexpr uint32_t UNUSED = 0xFFFFFFFF;
+
+        struct Node
+        {
+            uint32_t DataOffset = 0;
+            uint32_t DataSize = 0;
+            uint32_t BinListPrev = UNUSED;
+            uint32_t BinListNext = UNUSED;
+            uint32_t NeighborPrev = UNUSED;
+            uint32_t NeighborNext = UNUSED;
+            bool Used = false;
+        };
+
+        uint32_t InsertNodeIntoBin(uint32_t size, uint32_t dataOffset);
+        void RemoveNodeFromBin(uint32_t nodeIndex);
+        uint32_t AcquireNode();
+        void ReleaseNode(uint32_t nodeIndex);
+
+        uint32_t m_Capacity = 0;
+        uint32_t m_FreeStorage = 0;
+        uint32_t m_LastNode = UNUSED; // highest offset, Grow extends it
+
+        uint32_t m_UsedBinsTop = 0;
+        uint8_t m_UsedBins[NUM_TOP_BINS] = {};
+        uint32_t m_BinIndices[NUM_LEAF_BINS];
+
+        std::vector<Node> m_Nodes;
+        std::vector<uint32_t> m_FreeNodes;
+    };
+}
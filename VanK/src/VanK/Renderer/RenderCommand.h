@@ -29,14 +29,30 @@ namespace VanK
             if (s_RendererAPI) s_RendererAPI->setViewportSize(viewportSize);
         }
 
-        static VanKPipeLine createGraphicsPipeline(VanKGraphicsPipelineSpecification pipelineSpecification)
+        static void SetImGuiDrawData(ImDrawData* drawData)
         {
-            return s_RendererAPI ? s_RendererAPI->createGraphicsPipeline(pipelineSpecification) : nullptr;
+            if (s_RendererAPI) s_RendererAPI->SetImGuiDrawData(drawData);
         }
 
-        static VanKPipeLine createComputeShaderPipeline(VanKComputePipelineSpecification computePipelineSpecification)
+        // an identical specification hands back the existing pipeline, every create needs its own DestroyPipeline
+        static VanKPipeLine createGraphicsPipeline(const VanKGraphicsPipelineSpecification& pipelineSpecification)
         {
-            return s_RendererAPI ? s_RendererAPI->createComputeShaderPipeline(computePipelineSpecification) : nullptr;
+            return s_RendererAPI ? s_RendererAPI->createGraphicsPipeline(pipelineSpecification) : VanKPipeLine{};
+        }
+
+        static VanKPipeLine createComputeShaderPipeline(const VanKComputePipelineSpecification& computePipelineSpecification)
+        {
+            return s_RendererAPI ? s_RendererAPI->createComputeShaderPipeline(computePipelineSpecification) : VanKPipeLine{};
+        }
+
+        static VanKPipelineCacheStats GetPipelineCacheStats()
+        {
+            return s_RendererAPI ? s_RendererAPI->GetPipelineCacheStats() : VanKPipelineCacheStats{};
+        }
+
+        static VanKCommandStats GetCommandStats()
+        {
+            return s_RendererAPI ? s_RendererAPI->GetCommandStats() : VanKCommandStats{};
         }
 
         static void DestroyAllPipelines()
@@ -48,6 +64,16 @@ namespace VanK
         {
             if (s_RendererAPI) s_RendererAPI->DestroyPipeline(pipeline);
         }
+
+        static bool ReloadPipeline(VanKPipeLine pipeline, const VanKGraphicsPipelineSpecification& pipelineSpecification)
+        {
+            return s_RendererAPI && s_RendererAPI->ReloadPipeline(pipeline, pipelineSpecification);
+        }
+
+        static bool ReloadPipeline(VanKPipeLine pipeline, const VanKComputePipelineSpecification& computePipelineSpecification)
+        {
+            return s_RendererAPI && s_RendererAPI->ReloadPipeline(pipeline, computePipelineSpecification);
+        }
         
         static VanKCommandBuffer BeginCommandBuffer()
         {
@@ -68,6 +94,51 @@ namespace VanK
         {
             if (s_RendererAPI) s_RendererAPI->EndFrame();
         }
+
+        static void SetFramesInFlight(uint32_t framesInFlight)
+        {
+            if (s_RendererAPI) s_RendererAPI->SetFramesInFlight(framesInFlight);
+        }
+
+        static uint32_t GetFramesInFlight()
+        {
+            return s_RendererAPI ? s_RendererAPI->GetFramesInFlight() : 0;
+        }
+
+        static uint64_t GetRecordingFrame()
+        {
+            return s_RendererAPI ? s_RendererAPI->GetRecordingFrame() : 0;
+        }
+
+        static uint64_t GetCompletedFrame()
+        {
+            return s_RendererAPI ? s_RendererAPI->GetCompletedFrame() : 0;
+        }
+
+        static void SetLowLatency(bool enabled)
+        {
+            if (s_RendererAPI) s_RendererAPI->SetLowLatency(enabled);
+        }
+
+        static bool IsPresentWaitSupported()
+        {
+            return s_RendererAPI ? s_RendererAPI->IsPresentWaitSupported() : false;
+        }
+
+        static bool IsParallelRecordingSupported()
+        {
+            return s_RendererAPI ? s_RendererAPI->IsParallelRecordingSupported() : false;
+        }
+
+        static bool GetFrameTiming(uint64_t frame, VanKFrameTiming& timing)
+        {
+            return s_RendererAPI ? s_RendererAPI->GetFrameTiming(frame, timing) : false;
+        }
+
+        static bool IsHeadless()
+        {
+            return s_RendererAPI ? s_RendererAPI->IsHeadless() : false;
+        }
         
         static void BindPipeline(VanKCommandBuffer cmd, VanKPipelineBindPoint pipelineBindPoint, VanKPipeLine pipeline)
         {
@@ -79,9 +150,36 @@ namespace VanK
             if (s_RendererAPI) s_RendererAPI->BindUniformBuffer(cmd, bindPoint, buffer, set, binding, arrayElement);
         }
 
-        static void BeginRendering(VanKCommandBuffer cmd, const VanKColorTargetInfo* color_target_info, uint32_t num_color_targets, VanKDepthStencilTargetInfo depth_stencil_target_info, VanKRenderOption render_option)
+        // into the layout of the pipeline last bound for the stage, must lie in one of its PushConstantRanges
+        static void PushConstants(VanKCommandBuffer cmd, VanKShaderStageMask stageFlags, const void* data, uint32_t size, uint32_t offset = 0)
+        {
+            if (s_RendererAPI) s_RendererAPI->PushConstants(cmd, stageFlags, data, size, offset);
+        }
+
+        static void BeginRendering(VanKCommandBuffer cmd, const VanKColorTargetInfo* color_target_info, uint32_t num_color_targets, VanKDepthStencilTargetInfo depth_stencil_target_info, VanKRenderOption render_option,
+                                   VanKRenderingContents contents = VanK_RenderingContents_Inline)
+        {
+            if (s_RendererAPI) s_RendererAPI->BeginRendering(cmd, color_target_info, num_color_targets, depth_stencil_target_info, render_option, contents);
+        }
+
+        static uint32_t GetRecordingThreadCount()
         {
-            if (s_RendererAPI) s_RendererAPI->BeginRendering(cmd, color_target_info, num_color_targets, depth_stencil_target_info, render_option);
+            return s_RendererAPI ? s_RendererAPI->GetRecordingThreadCount() : 0;
+        }
+
+        static VanKCommandBuffer BeginSecondaryCommandBuffer(VanKCommandBuffer primary, uint32_t thread)
+        {
+            return s_RendererAPI ? s_RendererAPI->BeginSecondaryCommandBuffer(primary, thread) : nullptr;
+        }
+
+        static void EndSecondaryCommandBuffer(VanKCommandBuffer cmd)
+        {
+            if (s_RendererAPI) s_RendererAPI->EndSecondaryCommandBuffer(cmd);
+        }
+
+        static void ExecuteSecondaryCommandBuffers(VanKCommandBuffer primary, const VanKCommandBuffer* secondaries, uint32_t count)
+        {
+            if (s_RendererAPI) s_RendererAPI->ExecuteSecondaryCommandBuffers(primary, secondaries, count);
         }
 
         static void BindFragmentSamplers(VanKCommandBuffer cmd, uint32_t firstSlot, const TextureSamplerBinding* samplers, uint32_t num_bindings)
@@ -119,6 +217,11 @@ namespace VanK
             if (s_RendererAPI) s_RendererAPI->DrawIndexed(cmd, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
         }
         
+        static void DrawIndexedIndirect(VanKCommandBuffer cmd, IndirectBuffer& indirectBuffer, uint32_t indirectBufferOffset, uint32_t drawCount, uint32_t stride)
+        {
+            if (s_RendererAPI) s_RendererAPI->DrawIndexedIndirect(cmd, indirectBuffer, indirectBufferOffset, drawCount, stride);
+        }
+
         static void DrawIndexedIndirectCount(VanKCommandBuffer cmd, IndirectBuffer& indirectBuffer, uint32_t indirectBufferOffset, IndirectBuffer& countBuffer, uint32_t countBufferOffset, uint32_t maxDrawCount, uint32_t stride)
         {
             if (s_RendererAPI) s_RendererAPI->DrawIndexedIndirectCount(cmd, indirectBuffer, indirectBufferOffset, countBuffer, countBufferOffset, maxDrawCount, stride);       
@@ -157,6 +260,11 @@ namespace VanK
             if (s_RendererAPI) s_RendererAPI->EndComputePass(computePass);
         }
 
+        static void CopyBuffer(VanKCommandBuffer cmd, const VanKBuffer& srcBuffer, uint64_t srcOffset, const VanKBuffer& dstBuffer, uint64_t dstOffset, uint64_t size)
+        {
+            if (s_RendererAPI) s_RendererAPI->CopyBuffer(cmd, srcBuffer, srcOffset, dstBuffer, dstOffset, size);
+        }
+
         static void waitForGraphicsQueueIdle()
         {
             if (s_RendererAPI) s_RendererAPI->waitForGraphicsQueueIdle();
@@ -0,0 +1,295 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <random>
+
+#include "VanK/Core/JobSystem.h"
+#include "VanK/Core/Log.h"
+#include "VanK/Core/Timer.h"
+
+namespace VanK
+{
+    namespace
+    {
+        constexpr uint32_t PipelineBits = 12;
+        constexpr uint32_t MaterialBits = 15;
+        constexpr uint32_t StateBits = PipelineBits + 1 + MaterialBits;
+        constexpr uint32_t PassShift = 60;
+
+        constexpr uint32_t CommandStride = sizeof(shaderio::DrawIndexedIndirectCommand);
+
+        // LSD radix sort on 8 bit digits, stable, so equal keys keep their submission order. All eight histograms are
+        // built in one read, digits every key shares (most of the pass and pipeline bits) are skipped.
+        template<typename Entry>
+        void RadixSortByKey(std::vector<Entry>& entries, std::vector<Entry>& scratch)
+        {
+            constexpr uint32_t DigitBits = 8;
+            constexpr uint32_t Buckets = 1 << DigitBits;
+            constexpr uint32_t Digits = 64 / DigitBits;
+
+            const size_t count = entries.size();
+            if (count < 2)
+                return;
+
+            std::array<std::array<uint32_t, Buckets>, Digits> histograms = {};
+            for (const Entry& entry : entries)
+            {
+                for (uint32_t digit = 0; digit < Digits; digit++)
+                    histograms[digit][(entry.Key >> (digit * DigitBits)) & (Buckets - 1)]++;
+            }
+
+            scratch.resize(count);
+            for (uint32_t digit = 0; digit < Digits; digit++)
+            {
+                const uint32_t shift = digit * DigitBits;
+                std::array<uint32_t, Buckets>& offsets = histograms[digit];
+                if (offsets[(entries[0].Key >> shift) & (Buckets - 1)] == count)
+                    continue;
+
+                uint32_t sum = 0;
+                for (uint32_t& bucket : offsets)
+                {
+                    const uint32_t bucketCount = bucket;
+                    bucket = sum;
+                    sum += bucketCount;
+                }
+                for (const Entry& entry : entries)
+                    scratch[offsets[(entry.Key >> shift) & (Buckets - 1)]++] = entry;
+                entries.swap(scratch);
+            }
+        }
+    }
+
+    uint64_t RenderQueue::MakeSortKey(DrawPass pass, VanKPipeLine pipeline, VanKIndexElementSize indexType, uint32_t material, float depth)
+    {
+        VK_CORE_ASSERT(pipeline.Index < (1u << PipelineBits), "pipeline index does not fit the sort key");
+        VK_CORE_ASSERT(material < (1u << MaterialBits), "material does not fit the sort key");
+
+        const uint64_t state = (static_cast<uint64_t>(pipeline.Index) << (MaterialBits + 1))
+            | (static_cast<uint64_t>(indexType == VanKIndexElementSize::Uint32) << MaterialBits) | material;
+        // negative and NaN depths clamp to the camera
+        const uint64_t depthBits = std::bit_cast<uint32_t>(depth > 0.0f ? depth : 0.0f);
+        const uint64_t passBits = static_cast<uint64_t>(pass) << PassShift;
+
+        if (pass == DrawPass::Transparent)
+            return passBits | ((~depthBits & 0xFFFFFFFFull) << StateBits) | state;
+        return passBits | (state << 32) | depthBits;
+    }
+
+    void RenderQueue::Init(uint32_t packetCapacity)
+    {
+        m_Packets.reserve(packetCapacity);
+        m_IndirectBuffer.Init(static_cast<uint64_t>(packetCapacity) * CommandStride);
+    }
+
+    void RenderQueue::Reset()
+    {
+        Clear();
+        m_IndirectBuffer.Reset();
+        m_Stats = {};
+    }
+
+    void RenderQueue::sort()
+    {
+        m_SortEntries.resize(m_Packets.size());
+        for (uint32_t i = 0; i < m_Packets.size(); i++)
+            m_SortEntries[i] = { m_Packets[i].SortKey, i };
+        RadixSortByKey(m_SortEntries, m_SortScratch);
+    }
+
+    void RenderQueue::buildBatches()
+    {
+        m_Commands.clear();
+        m_Batches.clear();
+        m_Stats.PipelineSwitches = 0;
+
+        VanKPipeLine lastPipeline;
+        for (const SortEntry& entry : m_SortEntries)
+        {
+            const DrawPacket& packet = m_Packets[entry.Packet];
+            const DrawPass pass = static_cast<DrawPass>(entry.Key >> PassShift);
+            if (packet.Pipeline != lastPipeline)
+            {
+                m_Stats.PipelineSwitches++;
+                lastPipeline = packet.Pipeline;
+            }
+
+            if (packet.Indirect)
+            {
+                m_Batches.push_back({ pass, packet.Pipeline, packet.IndexType, 0, 0, &packet });
+                continue;
+            }
+
+            Batch* batch = m_Batches.empty() ? nullptr : &m_Batches.back();
+            if (!batch || batch->Gpu || batch->Pass != pass || batch->Pipeline != packet.Pipeline || batch->IndexType != packet.IndexType)
+                batch = &m_Batches.emplace_back(Batch{ pass, packet.Pipeline, packet.IndexType, static_cast<uint32_t>(m_Commands.size()), 0, nullptr });
+
+            m_Commands.push_back(packet.Command);
+            batch->CommandCount++;
+        }
+
+        m_Stats.Packets = static_cast<uint32_t>(m_Packets.size());
+        m_Stats.Batches = static_cast<uint32_t>(m_Batches.size());
+    }
+
+    void RenderQueue::Prepare(VanKCommandBuffer cmd, TransferBuffer& ring)
+    {
+        Timer timer;
+        sort();
+        m_Stats.SortMillis = timer.ElapsedMillis();
+        m_Stats.RecordMillis = 0.0f;
+        m_Stats.RecordThreads = 0;
+        buildBatches();
+
+        if (m_Commands.empty())
+            return;
+
+        // every command is written again, nothing to preserve when growing
+        const uint64_t bytes = m_Commands.size() * CommandStride;
+        m_IndirectBuffer.Reserve(cmd, bytes, 0);
+
+        uint64_t offset;
+        void* mapped = ring.MapTransferBuffer(bytes, alignof(shaderio::DrawIndexedIndirectCommand), offset);
+        if (!mapped)
+            return;
+        std::memcpy(mapped, m_Commands.data(), bytes);
+        ring.UnMapTransferBuffer();
+        ring.UploadToGPUBuffer(cmd, VanKTransferBufferLocation{ .offset = offset },
+                               VanKBufferRegion{ .buffer = m_IndirectBuffer.get(), .offset = 0, .size = bytes });
+    }
+
+    std::span<const RenderQueue::Batch> RenderQueue::passBatches(DrawPass pass) const
+    {
+        // keys sort by pass first, so a pass is one contiguous run
+        auto first = std::ranges::find(m_Batches, pass, &Batch::Pass);
+        auto last = std::find_if(first, m_Batches.end(), [pass](const Batch& batch) { return batch.Pass != pass; });
+        return { first, last };
+    }
+
+    void RenderQueue::recordBatches(VanKCommandBuffer cmd, std::span<const Batch> batches, IndirectBuffer* commands)
+    {
+        for (const Batch& batch : batches)
+        {
+            // binds repeated from the previous batch are dropped by the backend's state cache
+            RenderCommand::BindPipeline(cmd, VanKPipelineBindPoint::Graphics, batch.Pipeline);
+            RenderCommand::BindFragmentSamplers(cmd, 0, nullptr, 0);
+            RenderCommand::BindIndexBuffer(cmd, Geometry::GetIndexBuffer(batch.IndexType), batch.IndexType);
+
+            if (batch.Gpu)
+            {
+                RenderCommand::DrawIndexedIndirectCount(cmd, *batch.Gpu->Indirect, batch.Gpu->IndirectOffset, *batch.Gpu->Count,
+                                                        batch.Gpu->CountOffset, batch.Gpu->MaxDrawCount, CommandStride);
+            }
+            else
+            {
+                RenderCommand::DrawIndexedIndirect(cmd, *commands, batch.FirstCommand * CommandStride, batch.CommandCount, CommandStride);
+            }
+        }
+    }
+
+    void RenderQueue::Execute(VanKCommandBuffer cmd, DrawPass pass)
+    {
+        Timer timer;
+        recordBatches(cmd, passBatches(pass), m_IndirectBuffer.get());
+        m_Stats.RecordMillis += timer.ElapsedMillis();
+        m_Stats.RecordThreads = std::max(m_Stats.RecordThreads, 1u);
+    }
+
+    void RenderQueue::ExecuteParallel(VanKCommandBuffer cmd, DrawPass pass, const std::function<void(VanKCommandBuffer)>& bindState)
+    {
+        const std::span<const Batch> batches = passBatches(pass);
+        const uint32_t maxThreads = RenderCommand::GetRecordingThreadCount();
+        if (batches.empty() || maxThreads == 0)
+            return;
+
+        Timer timer;
+        const uint32_t batchCount = static_cast<uint32_t>(batches.size());
+        const uint32_t threads = std::clamp(batchCount / MinBatchesPerThread, 1u, maxThreads);
+
+        std::vector<VanKCommandBuffer> secondaries(threads);
+        auto record = [&](uint32_t thread)
+        {
+            const uint32_t begin = batchCount * thread / threads;
+            const uint32_t end = batchCount * (thread + 1) / threads;
+            VanKCommandBuffer secondary = RenderCommand::BeginSecondaryCommandBuffer(cmd, thread);
+            bindState(secondary);
+            recordBatches(secondary, batches.subspan(begin, end - begin), m_IndirectBuffer.get());
+            RenderCommand::EndSecondaryCommandBuffer(secondary);
+            secondaries[thread] = secondary;
+        };
+
+        // one range per job, a range's index picks its command pool so no two jobs share one
+        JobSystem::Get().ParallelFor(threads, 1, [&record](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t thread = begin; thread < end; thread++)
+                record(thread);
+        });
+        RenderCommand::ExecuteSecondaryCommandBuffers(cmd, secondaries.data(), threads);
+
+        m_Stats.RecordMillis += timer.ElapsedMillis();
+        m_Stats.RecordThreads = std::max(m_Stats.RecordThreads, threads);
+    }
+
+    void RenderQueue::Clear()
+    {
+        m_Packets.clear();
+        m_SortEntries.clear();
+        m_Commands.clear();
+        m_Batches.clear();
+    }
+
+    void RenderQueue::RunBenchmark(uint32_t packetCount, uint32_t iterations)
+    {
+        // a scene like spread of keys: a few pipelines, a few hundred materials, an eighth of the draws transparent
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> depthDistribution(0.1f, 500.0f);
+
+        RenderQueue queue;
+        queue.m_Packets.reserve(packetCount);
+        for (uint32_t i = 0; i < packetCount; i++)
+        {
+            DrawPacket packet;
+            packet.Pipeline = { .Index = static_cast<uint32_t>(rng() % 16) };
+            packet.IndexType = rng() % 2 ? VanKIndexElementSize::Uint16 : VanKIndexElementSize::Uint32;
+            const DrawPass pass = i % 8 == 0 ? DrawPass::Transparent : DrawPass::Opaque;
+            packet.SortKey = MakeSortKey(pass, packet.Pipeline, packet.IndexType, static_cast<uint32_t>(rng() % 512), depthDistribution(rng));
+            packet.Command = { .indexCount = 3 * (1 + i % 64), .instanceCount = 1, .firstIndex = i * 3, .vertexOffset = 0, .firstInstance = i };
+            queue.Submit(packet);
+        }
+
+        auto measure = [iterations](auto&& fn)
+        {
+            float best = std::numeric_limits<float>::max();
+            for (uint32_t it = 0; it < iterations; it++)
+            {
+                Timer timer;
+                fn();
+                best = std::min(best, timer.ElapsedMillis());
+            }
+            return best;
+        };
+
+        const float radixMs = measure([&] { queue.sort(); });
+
+        std::vector<SortEntry> reference;
+        const float stableSortMs = measure([&]
+        {
+            reference.resize(queue.m_Packets.size());
+            for (uint32_t i = 0; i < queue.m_Packets.size(); i++)
+                reference[i] = { queue.m_Packets[i].SortKey, i };
+            std::ranges::stable_sort(reference, {}, &SortEntry::Key);
+        });
+        const bool match = std::ranges::equal(queue.m_SortEntries, reference,
+                                              [](const SortEntry& a, const SortEntry& b) { return a.Key == b.Key && a.Packet == b.Packet; });
+
+        const float batchMs = measure([&] { queue.buildBatches(); });
+
+        VK_CORE_INFO("[RenderQueue] {} packets | radix {:7.3f} ms | std::stable_sort {:7.3f} ms | {:5.2f}x | batching {:7.3f} ms -> {} batches, {} pipeline switches{}",
+                     packetCount, radixMs, stableSortMs, stableSortMs / radixMs, batchMs, queue.m_Stats.Batches, queue.m_Stats.PipelineSwitches,
+                     match ? "" : " | MISMATCH");
+    }
+}
@@ -0,0 +1,120 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+#include "Geometry.h"
+#include "GrowableBuffer.h"
+#include "RenderCommand.h"
+
+namespace VanK
+{
+    // The most significant bits of a sort key, RenderQueue::Execute draws one pass at a time
+    enum class DrawPass : uint8_t
+    {
+        Opaque,
+        Transparent // back to front
+    };
+
+    /*--
+     * One draw as the scene submits it. Geometry lives in Geometry's shared buffers, so a draw is a pipeline, an index
+     * width (which index buffer) and the indexed draw arguments. Per draw data such as the material has to reach the
+     * shader through firstInstance, which is what lets draws with different materials share one indirect batch.
+     * A packet with Indirect set draws what the GPU wrote there instead, Count holds the number of draws.
+    -*/
+    struct DrawPacket
+    {
+        uint64_t SortKey = 0;
+        VanKPipeLine Pipeline;
+        VanKIndexElementSize IndexType = VanKIndexElementSize::Uint32;
+        shaderio::DrawIndexedIndirectCommand Command = {};
+
+        IndirectBuffer* Indirect = nullptr;
+        uint32_t IndirectOffset = 0;
+        IndirectBuffer* Count = nullptr;
+        uint32_t CountOffset = 0;
+        uint32_t MaxDrawCount = 0;
+    };
+
+    // Collects a frame's draws, radix sorts them by key and records them as one multi draw indirect per run of
+    // packets sharing pass, pipeline and index buffer
+    class RenderQueue
+    {
+    public:
+        struct Stats
+        {
+            uint32_t Packets;
+            uint32_t Batches;
+            uint32_t PipelineSwitches;
+            float SortMillis;
+            float RecordMillis;     // Execute and ExecuteParallel, all passes
+            uint32_t RecordThreads; // most threads one pass was recorded on
+        };
+
+        /*--
+         * Key layout, most significant bits first:
+         *   opaque:      pass 4 | pipeline 12 | index width 1 | material 15 | depth 32 (front to back)
+         *   transparent: pass 4 | depth 32 (back to front) | pipeline 12 | index width 1 | material 15
+         * The material only orders draws of one batch, it does not split them. depth is the view distance,
+         * the bits of a non negative float compare like the float.
+        -*/
+        static uint64_t MakeSortKey(DrawPass pass, VanKPipeLine pipeline, VanKIndexElementSize indexType, uint32_t material, float depth);
+
+        void Init(uint32_t packetCapacity);
+        void Reset();
+
+        void Submit(const DrawPacket& packet) { m_Packets.push_back(packet); }
+
+        // sorts, builds the batches and uploads their draw commands, copies can't be recorded while rendering
+        void Prepare(VanKCommandBuffer cmd, TransferBuffer& ring);
+        // the caller has begun rendering and set the viewport, scissor and uniform buffer
+        void Execute(VanKCommandBuffer cmd, DrawPass pass);
+        // Splits the pass's batches into contiguous ranges recorded into secondary command buffers by up to
+        // GetRecordingThreadCount() jobs, executed in order. bindState sets up every secondary the way Execute
+        // expects cmd to be. Rendering has to have begun with VanK_RenderingContents_SecondaryCommandBuffers.
+        void ExecuteParallel(VanKCommandBuffer cmd, DrawPass pass, const std::function<void(VanKCommandBuffer)>& bindState);
+        // packets only live for one frame
+        void Clear();
+
+        // ring space Prepare needs for the packets submitted so far
+        uint64_t GetUploadBytes() const { return m_Packets.size() * sizeof(shaderio::DrawIndexedIndirectCommand); }
+        const Stats& GetStats() const { return m_Stats; }
+
+        // Times the radix sort against std::stable_sort on random keys and logs the result
+        static void RunBenchmark(uint32_t packetCount = 100000, uint32_t iterations = 16);
+
+    private:
+        struct SortEntry
+        {
+            uint64_t Key;
+            uint32_t Packet;
+        };
+
+        struct Batch
+        {
+            DrawPass Pass;
+            VanKPipeLine Pipeline;
+            VanKIndexElementSize IndexType;
+            uint32_t FirstCommand;
+            uint32_t CommandCount;
+            const DrawPacket* Gpu; // GPU written draws, recorded on their own
+        };
+
+        // below this many batches per thread a pass is recorded on fewer threads
+        static constexpr uint32_t MinBatchesPerThread = 64;
+
+        void sort();
+        void buildBatches();
+        std::span<const Batch> passBatches(DrawPass pass) const;
+        static void recordBatches(VanKCommandBuffer cmd, std::span<const Batch> batches, IndirectBuffer* commands);
+
+        std::vector<DrawPacket> m_Packets;
+        std::vector<SortEntry> m_SortEntries;
+        std::vector<SortEntry> m_SortScratch;
+        std::vector<shaderio::DrawIndexedIndirectCommand> m_Commands;
+        std::vector<Batch> m_Batches;
+        GrowableBuffer<IndirectBuffer> m_IndirectBuffer;
+        Stats m_Stats = {};
+    };
+}
@@ -0,0 +1,95 @@
+#include "RenderThread.h"
+
+#include "VanK/Core/core.h"
+#include "VanK/Core/Timer.h"
+
+namespace VanK
+{
+    void RenderThread::Start(uint32_t queueDepth, std::function<void(FramePacket&)> render)
+    {
+        VK_CORE_ASSERT(!IsRunning(), "render thread already started");
+        VK_CORE_ASSERT(queueDepth > 0, "a render thread needs room for at least one packet");
+
+        m_Render = std::move(render);
+        m_QueueDepth = queueDepth;
+        m_Packets = std::vector<FramePacket>(queueDepth + 1);
+        m_Submitted = 0;
+        m_Rendered = 0;
+        m_Thread = std::jthread([this](std::stop_token stopToken) { run(stopToken); });
+    }
+
+    void RenderThread::Stop()
+    {
+        if (!IsRunning())
+            return;
+
+        m_Thread.request_stop();
+        m_Thread.join();
+        m_Packets.clear();
+    }
+
+    FramePacket& RenderThread::BeginPacket()
+    {
+        Timer timer;
+        std::unique_lock lock(m_Mutex);
+        // the slot was last used QueueDepth + 1 packets ago, that one has to be rendered
+        m_Condition.wait(lock, [this] { return m_Submitted - m_Rendered <= m_QueueDepth; });
+        m_WaitMillis = timer.ElapsedMillis();
+        return m_Packets[m_Submitted % m_Packets.size()];
+    }
+
+    uint64_t RenderThread::SubmitPacket()
+    {
+        uint64_t index;
+        {
+            std::scoped_lock lock(m_Mutex);
+            index = m_Submitted++;
+        }
+        m_Condition.notify_all();
+        return index;
+    }
+
+    void RenderThread::Wait(uint64_t packetIndex)
+    {
+        std::unique_lock lock(m_Mutex);
+        m_Condition.wait(lock, [this, packetIndex] { return m_Rendered > packetIndex; });
+    }
+
+    void RenderThread::WaitIdle()
+    {
+        std::unique_lock lock(m_Mutex);
+        m_Condition.wait(lock, [this] { return m_Rendered == m_Submitted; });
+    }
+
+    RenderThread::Stats RenderThread::GetStats() const
+    {
+        std::scoped_lock lock(m_Mutex);
+        return {m_WaitMillis, m_RenderMillis, static_cast<uint32_t>(m_Submitted - m_Rendered)};
+    }
+
+    void RenderThread::run(std::stop_token stopToken)
+    {
+        while (true)
+        {
+            FramePacket* packet;
+            {
+                std::unique_lock lock(m_Mutex);
+                // after a stop request whatever was submitted is still rendered
+                if (!m_Condition.wait(lock, stopToken, [this] { return m_Rendered < m_Submitted; }))
+                    return;
+                packet = &m_Packets[m_Rendered % m_Packets.size()];
+            }
+
+            Timer timer;
+            m_Render(*packet);
+            float renderMillis = timer.ElapsedMillis();
+
+            {
+                std::scoped_lock lock(m_Mutex);
+                m_Rendered++;
+                m_RenderMillis = renderMillis;
+            }
+            m_Condition.notify_all();
+        }
+    }
+}
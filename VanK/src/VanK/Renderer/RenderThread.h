@@ -0,0 +1,62 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "FramePacket.h"
+
+namespace VanK
+{
+    /*--
+     * Records and submits frames on its own thread, so the main thread builds frame N+1 while frame N is submitted.
+     * Packets are used round robin from QueueDepth + 1 slots: the main thread fills one while up to QueueDepth are
+     * waiting for or being rendered, a depth of 1 double buffers. BeginPacket blocks while the queue is full, which
+     * bounds how many frames input can be ahead of what is presented.
+    -*/
+    class RenderThread
+    {
+    public:
+        struct Stats
+        {
+            float WaitMillis;   // main thread blocked in BeginPacket, last frame
+            float RenderMillis; // last packet on the render thread
+            uint32_t Queued;    // submitted and not rendered yet
+        };
+
+        ~RenderThread() { Stop(); }
+
+        void Start(uint32_t queueDepth, std::function<void(FramePacket&)> render);
+        // renders what has been submitted, then joins
+        void Stop();
+        bool IsRunning() const { return m_Thread.joinable(); }
+        uint32_t GetQueueDepth() const { return m_QueueDepth; }
+
+        // the packet to fill next, blocks until its slot is free
+        FramePacket& BeginPacket();
+        // hands the packet from BeginPacket to the render thread and returns its index
+        uint64_t SubmitPacket();
+        // blocks until the packet with this index has been rendered
+        void Wait(uint64_t packetIndex);
+        void WaitIdle();
+
+        Stats GetStats() const;
+
+    private:
+        void run(std::stop_token stopToken);
+
+        std::function<void(FramePacket&)> m_Render;
+        std::vector<FramePacket> m_Packets;
+        uint32_t m_QueueDepth = 0;
+        uint64_t m_Submitted = 0;
+        uint64_t m_Rendered = 0;
+        float m_WaitMillis = 0.0f;
+        float m_RenderMillis = 0.0f;
+
+        mutable std::mutex m_Mutex;
+        std::condition_variable_any m_Condition;
+        std::jthread m_Thread;
+    };
+}
@@ -6,10 +6,19 @@
 #include "backends/imgui_impl_vulkan.h"
 
 #include <SDL3/SDL_log.h>
+#include <array>
+#include <filesystem>
 
 #include "VanK/Core/Application.h"
+#include "VanK/Core/JobSystem.h"
 #include "VanK/Core/Log.h"
 #include "VanK/Core/Timer.h"
+#include "MeshDecode.h"
+#include "MeshCache.h"
+#include "GlbReader.h"
+#include "ObjImporter.h"
+#include "Meshlet.h"
+#include "MeshSimplifier.h"
 #define TINYGLTF_IMPLEMENTATION
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include <tiny_gltf.h>
@@ -35,21 +44,231 @@ namespace VanK
             uint64_t countAddress;
             uint32_t numVertices;
             uint32_t numindicies;
+            glm::vec4 frustumPlanes[6];
+            glm::vec3 cameraPosition;
+            uint32_t meshletCount;
+            uint64_t meshletBuffer;
+            uint32_t meshletCulling;
+            uint64_t lodGroupBuffer;
+            uint64_t lodBuffer;
+            uint32_t lodGroupCount;
+            float lodErrorScale;
+            float lodThreshold;
+            uint32_t lodEnabled;
+            uint32_t baseVertex;
+            uint32_t baseIndex;
         };
         CameraData camData;
     };
     static Renderer3DData s_Data;
     const std::string MODEL_PATH = "../build/VanK/models/viking_room.glb";
-    
-    void Renderer::loadModel()
+
+    // Debug > Compare LOD on/off: the same view is measured for a while with LOD selection off, then on
+    struct LodComparison
+    {
+        bool Running = false;
+        bool RestoreLodEnabled = true;
+        uint32_t Phase = 0; // 0 = LOD off, 1 = LOD on
+        uint32_t Frame = 0;
+        double FrameTime[2] = {};
+        uint64_t Triangles[2] = {};
+        uint32_t Samples[2] = {};
+    };
+    static LodComparison s_LodComparison;
+    constexpr uint32_t LOD_COMPARISON_WARMUP_FRAMES = 8; // stats are read back two frames late, more behind the render thread
+    constexpr uint32_t LOD_COMPARISON_FRAMES = 240;
+
+    // Gribb/Hartmann planes of a zero-to-one depth projection, normalized so w is a distance
+    static void ExtractFrustumPlanes(const glm::mat4& viewProj, glm::vec4 (&planes)[6])
+    {
+        glm::vec4 row0(viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0]);
+        glm::vec4 row1(viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1]);
+        glm::vec4 row2(viewProj[0][2], viewProj[1][2], viewProj[2][2], viewProj[3][2]);
+        glm::vec4 row3(viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]);
+
+        planes[0] = row3 + row0; // left
+        planes[1] = row3 - row0; // right
+        planes[2] = row3 + row1; // bottom
+        planes[3] = row3 - row1; // top
+        planes[4] = row2;        // near
+        planes[5] = row3 - row2; // far
+
+        for (glm::vec4& plane : planes)
+        {
+            plane /= glm::length(glm::vec3(plane));
+        }
+    }
+
+    // byteStride of 0 means tightly packed, tinygltf resolves that for us and returns -1 for broken accessors
+    static MeshDecode::AccessorView GetAccessorView(const tinygltf::Model& model, int accessorIndex)
+    {
+        const tinygltf::Accessor& accessor = model.accessors[accessorIndex];
+        const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
+        const tinygltf::Buffer& buffer = model.buffers[bufferView.buffer];
+
+        int stride = accessor.ByteStride(bufferView);
+        if (stride <= 0)
+        {
+            throw std::runtime_error("Invalid glTF accessor stride");
+        }
+
+        return MeshDecode::AccessorView
+        {
+            .Data = &buffer.data[bufferView.byteOffset + accessor.byteOffset],
+            .ByteStride = static_cast<size_t>(stride),
+            .Count = accessor.count,
+            .Type = static_cast<MeshDecode::ComponentType>(accessor.componentType),
+            .Components = static_cast<uint32_t>(tinygltf::GetNumComponentsInType(accessor.type)),
+            .Normalized = accessor.normalized
+        };
+    }
+
+    // float VEC3 is gathered, normalized integer VEC3 (KHR_mesh_quantization) is decoded, anything else is refused
+    static bool IsReadableVec3(const MeshDecode::AccessorView& accessor)
+    {
+        if (accessor.Components != 3)
+            return false;
+        if (accessor.Type == MeshDecode::ComponentType::Float)
+            return true;
+        return accessor.Normalized && accessor.Type != MeshDecode::ComponentType::Uint32;
+    }
+
+    static void ReadVec3(const MeshDecode::AccessorView& accessor, size_t count, void* dst, size_t dstStride)
+    {
+        if (accessor.Type == MeshDecode::ComponentType::Float)
+            MeshDecode::GatherFloat3(accessor.Data, accessor.ByteStride, count, dst, dstStride);
+        else
+            MeshDecode::DecodeNormalized(accessor.Data, accessor.ByteStride, accessor.Type, 3, count, dst, dstStride);
+    }
+
+    // Decodes one triangle primitive into the interleaved vertex array and the rebased u32 index array,
+    // false (and nothing appended) when its positions can't be read. Throws on indices that aren't whole
+    // triangles or point past the primitive's vertices, like the OBJ importer does for bad face indices.
+    static bool AppendPrimitive(const MeshDecode::AccessorView& position, const MeshDecode::AccessorView* normal,
+                                const MeshDecode::AccessorView* texCoord, const MeshDecode::AccessorView& index,
+                                std::vector<shaderio::InstancedVertexData>& vertices, std::vector<uint32_t>& indices)
+    {
+        // the readers assume the element size of the type, a quantized accessor would be read past its end
+        if (!IsReadableVec3(position))
+        {
+            VK_CORE_WARN("Skipping primitive: unsupported position accessor (component type {}, {} components)",
+                         static_cast<uint32_t>(position.Type), position.Components);
+            return false;
+        }
+        if (normal && !IsReadableVec3(*normal))
+        {
+            VK_CORE_WARN("Ignoring unsupported normal accessor (component type {}, {} components)",
+                         static_cast<uint32_t>(normal->Type), normal->Components);
+            normal = nullptr;
+        }
+        if (texCoord && (texCoord->Components != 2 || (texCoord->Type != MeshDecode::ComponentType::Float && !texCoord->Normalized)))
+        {
+            VK_CORE_WARN("Ignoring unsupported texcoord accessor (component type {}, {} components)",
+                         static_cast<uint32_t>(texCoord->Type), texCoord->Components);
+            texCoord = nullptr;
+        }
+
+        if (index.Count % 3 != 0)
+            throw std::runtime_error("glTF: primitive has " + std::to_string(index.Count) + " indices, not a triangle list");
+
+        uint32_t baseVertex = static_cast<uint32_t>(vertices.size());
+        vertices.resize(vertices.size() + position.Count);
+
+        // every attribute is written straight into the interleaved vertex array
+        shaderio::InstancedVertexData* firstVertex = &vertices[baseVertex];
+        constexpr size_t vertexStride = sizeof(shaderio::InstancedVertexData);
+
+        ReadVec3(position, position.Count, &firstVertex->position, vertexStride);
+
+        if (normal)
+        {
+            ReadVec3(*normal, std::min(normal->Count, position.Count), &firstVertex->normals, vertexStride);
+        }
+
+        // texture coordinates can be float or normalized u8/u16
+        if (texCoord)
+        {
+            size_t count = std::min(texCoord->Count, position.Count);
+            if (texCoord->Type == MeshDecode::ComponentType::Float)
+            {
+                MeshDecode::GatherFloat2(texCoord->Data, texCoord->ByteStride, count, &firstVertex->texcoords, vertexStride);
+            }
+            else
+            {
+                MeshDecode::DecodeNormalized(texCoord->Data, texCoord->ByteStride, texCoord->Type, 2, count, &firstVertex->texcoords, vertexStride);
+            }
+        }
+
+        // Widen indices to u32 and rebase them onto the shared vertex array, the component type is resolved once per accessor
+        size_t firstIndex = indices.size();
+        indices.resize(firstIndex + index.Count);
+        MeshDecode::WidenIndices(index.Data, index.ByteStride, index.Type, index.Count, baseVertex, &indices[firstIndex]);
+        // meshlet building, simplification and the draws all index the vertices with these unchecked.
+        // Unsigned, so an index the rebase wrapped around lands above the range as well.
+        for (size_t i = firstIndex; i < indices.size(); i++)
+        {
+            if (indices[i] - baseVertex >= position.Count)
+                throw std::runtime_error("glTF: primitive index " + std::to_string(indices[i] - baseVertex) + " out of range of its " +
+                                         std::to_string(position.Count) + " vertices");
+        }
+        return true;
+    }
+
+    static CookedMeshRange BeginMeshRange(const std::string& name, size_t meshIndex,
+                                          const std::vector<shaderio::InstancedVertexData>& vertices, const std::vector<uint32_t>& indices)
+    {
+        CookedMeshRange range{};
+        std::string meshName = name.empty() ? "mesh_" + std::to_string(meshIndex) : name;
+        std::strncpy(range.Name, meshName.c_str(), sizeof(range.Name) - 1);
+        range.VertexOffset = static_cast<uint32_t>(vertices.size());
+        range.IndexOffset = static_cast<uint32_t>(indices.size());
+        return range;
+    }
+
+    static void EndMeshRange(CookedMeshRange& range, const std::vector<shaderio::InstancedVertexData>& vertices, const std::vector<uint32_t>& indices)
+    {
+        range.VertexCount = static_cast<uint32_t>(vertices.size()) - range.VertexOffset;
+        range.IndexCount = static_cast<uint32_t>(indices.size()) - range.IndexOffset;
+    }
+
+    // GLB files go through the mapped reader, accessors are consumed in place
+    static void ImportGlb(const std::string& path, std::vector<shaderio::InstancedVertexData>& vertices,
+                          std::vector<uint32_t>& indices, std::vector<CookedMeshRange>& ranges)
+    {
+        GlbReader reader(path);
+
+        const auto& meshes = reader.GetMeshes();
+        for (size_t meshIndex = 0; meshIndex < meshes.size(); meshIndex++)
+        {
+            CookedMeshRange range = BeginMeshRange(meshes[meshIndex].Name, meshIndex, vertices, indices);
+
+            for (const GlbReader::Primitive& primitive : meshes[meshIndex].Primitives)
+            {
+                if (primitive.Position < 0 || primitive.Indices < 0)
+                    continue;
+
+                const MeshDecode::AccessorView* normal = primitive.Normal >= 0 ? &reader.GetAccessor(primitive.Normal) : nullptr;
+                const MeshDecode::AccessorView* texCoord = primitive.TexCoord0 >= 0 ? &reader.GetAccessor(primitive.TexCoord0) : nullptr;
+                AppendPrimitive(reader.GetAccessor(primitive.Position), normal, texCoord, reader.GetAccessor(primitive.Indices), vertices, indices);
+            }
+
+            EndMeshRange(range, vertices, indices);
+            ranges.push_back(range);
+        }
+    }
+
+    // .gltf (external buffers / data uris) and the reference path for CompareModelLoaders
+    static void ImportTinyGltf(const std::string& path, std::vector<shaderio::InstancedVertexData>& vertices,
+                               std::vector<uint32_t>& indices, std::vector<CookedMeshRange>& ranges)
     {
-        // Use tinygltf to load the model instead of tinyobjloader
         tinygltf::Model model;
         tinygltf::TinyGLTF loader;
         std::string err;
         std::string warn;
 
-        bool ret = loader.LoadBinaryFromFile(&model, &err, &warn, MODEL_PATH);
+        bool isBinary = std::filesystem::path(path).extension() == ".glb";
+        bool ret = isBinary ? loader.LoadBinaryFromFile(&model, &err, &warn, path)
+                            : loader.LoadASCIIFromFile(&model, &err, &warn, path);
 
         if (!warn.empty())
         {
@@ -66,114 +285,351 @@ namespace VanK
             throw std::runtime_error("Failed to load glTF model");
         }
 
-        vertices.clear();
-        indices.clear();
-
         // Process all meshes in the model
-        for (const auto& mesh : model.meshes)
+        for (size_t meshIndex = 0; meshIndex < model.meshes.size(); meshIndex++)
         {
+            const tinygltf::Mesh& mesh = model.meshes[meshIndex];
+            CookedMeshRange range = BeginMeshRange(mesh.name, meshIndex, vertices, indices);
+
             for (const auto& primitive : mesh.primitives)
             {
-                // Get indices
-                const tinygltf::Accessor& indexAccessor = model.accessors[primitive.indices];
-                const tinygltf::BufferView& indexBufferView = model.bufferViews[indexAccessor.bufferView];
-                const tinygltf::Buffer& indexBuffer = model.buffers[indexBufferView.buffer];
-
-                // Get vertex positions
-                const tinygltf::Accessor& posAccessor = model.accessors[primitive.attributes.at("POSITION")];
-                const tinygltf::BufferView& posBufferView = model.bufferViews[posAccessor.bufferView];
-                const tinygltf::Buffer& posBuffer = model.buffers[posBufferView.buffer];
-
-                // Get texture coordinates if available
-                bool hasTexCoords = primitive.attributes.find("TEXCOORD_0") != primitive.attributes.end();
-                const tinygltf::Accessor* texCoordAccessor = nullptr;
-                const tinygltf::BufferView* texCoordBufferView = nullptr;
-                const tinygltf::Buffer* texCoordBuffer = nullptr;
-
-                if (hasTexCoords)
-                {
-                    texCoordAccessor = &model.accessors[primitive.attributes.at("TEXCOORD_0")];
-                    texCoordBufferView = &model.bufferViews[texCoordAccessor->bufferView];
-                    texCoordBuffer = &model.buffers[texCoordBufferView->buffer];
-                }
+                if (primitive.indices < 0 || primitive.mode != TINYGLTF_MODE_TRIANGLES)
+                    continue;
 
-                uint32_t baseVertex = static_cast<uint32_t>(vertices.size());
+                MeshDecode::AccessorView position = GetAccessorView(model, primitive.attributes.at("POSITION"));
+                MeshDecode::AccessorView index = GetAccessorView(model, primitive.indices);
 
-                for (size_t i = 0; i < posAccessor.count; i++)
-                {
-                    shaderio::InstancedVertexData vertex{};
+                std::optional<MeshDecode::AccessorView> normal;
+                auto normalIt = primitive.attributes.find("NORMAL");
+                if (normalIt != primitive.attributes.end())
+                    normal = GetAccessorView(model, normalIt->second);
 
-                    const float* pos = reinterpret_cast<const float*>(&posBuffer.data[posBufferView.byteOffset + posAccessor
-                        .byteOffset + i * 12]);
-                    vertex.position = {pos[0], pos[1], pos[2]};
+                std::optional<MeshDecode::AccessorView> texCoord;
+                auto texCoordIt = primitive.attributes.find("TEXCOORD_0");
+                if (texCoordIt != primitive.attributes.end())
+                    texCoord = GetAccessorView(model, texCoordIt->second);
 
-                    if (hasTexCoords)
-                    {
-                        const float* texCoord = reinterpret_cast<const float*>(&texCoordBuffer->data[texCoordBufferView->
-                            byteOffset + texCoordAccessor->byteOffset + i * 8]);
-                        vertex.texcoords = {texCoord[0], texCoord[1]};
-                    }
-                    else
-                    {
-                        vertex.texcoords = {0.0f, 0.0f};
-                    }
+                AppendPrimitive(position, normal ? &*normal : nullptr, texCoord ? &*texCoord : nullptr, index, vertices, indices);
+            }
 
-                    /*vertex.color = {1.0f, 1.0f, 1.0f, 1.0f};*/
+            EndMeshRange(range, vertices, indices);
+            ranges.push_back(range);
+        }
+    }
+    
+    void Renderer::loadModel()
+    {
+        Timer loadTimer;
+        XXH128_hash_t sourceHash = Utility::calcul_hash_streaming(MODEL_PATH);
+        // the LOD chain depends on the settings, so they are part of the cache key
+        sourceHash.low64 ^= XXH3_64bits(&m_LodSettings, sizeof(m_LodSettings));
+
+        // Fast path: the cooked file is mapped and viewed in place, nothing is parsed or copied
+        m_CookedModel = MeshCache::Load(MODEL_PATH, sourceHash);
+        if (m_CookedModel)
+        {
+            vertices.clear();
+            indices.clear();
+            meshlets.clear();
+            lodGroups.clear();
+            lods.clear();
+            m_ModelVertices = m_CookedModel->Vertices;
+            m_ModelIndices = m_CookedModel->Indices;
+            m_ModelMeshlets = m_CookedModel->Meshlets;
+            m_ModelLodGroups = m_CookedModel->LodGroups;
+            m_ModelLods = m_CookedModel->Lods;
+            m_ModelRanges = m_CookedModel->Ranges;
+            VK_CORE_INFO("Loaded cooked model '{}' in {}ms", MODEL_PATH, loadTimer.ElapsedMillis());
+            return;
+        }
 
-                    vertices.push_back(vertex);
-                }
+        meshRanges.clear();
+        importModel(meshRanges);
+        buildLodChain(meshRanges);
+        m_ModelRanges = meshRanges;
+        m_ModelVertices = vertices;
+        m_ModelIndices = indices;
+        m_ModelMeshlets = meshlets;
+        m_ModelLodGroups = lodGroups;
+        m_ModelLods = lods;
 
-                const unsigned char* indexData = &indexBuffer.data[indexBufferView.byteOffset + indexAccessor.byteOffset];
-                size_t indexCount = indexAccessor.count;
-                size_t indexStride = 0;
+        CookedMeshData model{ m_ModelVertices, m_ModelIndices, m_ModelRanges, m_ModelMeshlets, m_ModelLodGroups, m_ModelLods };
+        VK_CORE_INFO("Imported model '{}' in {}ms", MODEL_PATH, loadTimer.ElapsedMillis());
 
-                // Determine index stride based on component type
-                if (indexAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
-                {
-                    indexStride = sizeof(uint16_t);
-                }
-                else if (indexAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
-                {
-                    indexStride = sizeof(uint32_t);
-                }
-                else if (indexAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
+        MeshCache::Save(MODEL_PATH, sourceHash, model);
+    }
+
+    void Renderer::importModel(std::vector<CookedMeshRange>& ranges)
+    {
+        vertices.clear();
+        indices.clear();
+
+        std::filesystem::path extension = std::filesystem::path(MODEL_PATH).extension();
+        if (extension == ".glb")
+            ImportGlb(MODEL_PATH, vertices, indices, ranges);
+        else if (extension == ".obj")
+            ObjImporter::Import(MODEL_PATH, vertices, indices, ranges);
+        else
+            ImportTinyGltf(MODEL_PATH, vertices, indices, ranges);
+    }
+
+    // LOD 0 is the imported index range, every further level simplifies the previous one and is appended
+    // to the shared index buffer. Each level gets its own meshlets, tagged with their group and level.
+    void Renderer::buildLodChain(const std::vector<CookedMeshRange>& ranges)
+    {
+        Timer buildTimer;
+        meshlets.clear();
+        lodGroups.clear();
+        lods.clear();
+
+        std::vector<uint32_t> lodIndices;
+        std::vector<uint32_t> simplified;
+        for (const CookedMeshRange& range : ranges)
+        {
+            shaderio::MeshLodGroup group{};
+            group.firstLod = static_cast<uint32_t>(lods.size());
+
+            // bounding sphere of the whole mesh, LOD selection uses the distance to it
+            glm::vec3 minBounds(std::numeric_limits<float>::max());
+            glm::vec3 maxBounds(std::numeric_limits<float>::lowest());
+            for (uint32_t v = range.VertexOffset; v < range.VertexOffset + range.VertexCount; v++)
+            {
+                minBounds = glm::min(minBounds, vertices[v].position);
+                maxBounds = glm::max(maxBounds, vertices[v].position);
+            }
+            group.center = range.VertexCount ? (minBounds + maxBounds) * 0.5f : glm::vec3(0.0f);
+            group.radius = range.VertexCount ? glm::length(maxBounds - minBounds) * 0.5f : 0.0f;
+
+            lodIndices.assign(indices.begin() + range.IndexOffset, indices.begin() + range.IndexOffset + range.IndexCount);
+            uint32_t firstIndex = range.IndexOffset;
+            float error = 0.0f;
+
+            for (uint32_t level = 0; level < std::max(m_LodSettings.MaxLods, 1u); level++)
+            {
+                if (level > 0)
                 {
-                    indexStride = sizeof(uint8_t);
+                    size_t targetIndexCount = static_cast<size_t>(lodIndices.size() * m_LodSettings.Reduction) / 3 * 3;
+                    float levelError = MeshSimplifier::Simplify(vertices, lodIndices, targetIndexCount, m_LodSettings.AttributeWeight, simplified);
+                    if (simplified.empty() || simplified.size() > lodIndices.size() * m_LodSettings.MinReduction)
+                        break;
+
+                    // each level is simplified from the previous one, so the errors add up
+                    error += levelError;
+                    firstIndex = static_cast<uint32_t>(indices.size());
+                    indices.insert(indices.end(), simplified.begin(), simplified.end());
+                    lodIndices.swap(simplified);
                 }
-                else
+
+                shaderio::MeshLod lod{};
+                lod.firstIndex = firstIndex;
+                lod.indexCount = static_cast<uint32_t>(lodIndices.size());
+                lod.firstMeshlet = static_cast<uint32_t>(meshlets.size());
+                lod.error = error;
+
+                MeshletBuilder::Build(vertices, indices, lod.firstIndex, lod.indexCount, meshlets);
+                lod.meshletCount = static_cast<uint32_t>(meshlets.size()) - lod.firstMeshlet;
+                for (uint32_t m = lod.firstMeshlet; m < meshlets.size(); m++)
                 {
-                    throw std::runtime_error("Unsupported index component type");
+                    meshlets[m].lodGroup = static_cast<uint32_t>(lodGroups.size());
+                    meshlets[m].lodLevel = level;
                 }
+                lods.push_back(lod);
+            }
 
-                indices.reserve(indices.size() + indexCount);
+            group.lodCount = static_cast<uint32_t>(lods.size()) - group.firstLod;
+            lodGroups.push_back(group);
+        }
 
-                for (size_t i = 0; i < indexCount; i++)
-                {
-                    uint32_t index = 0;
+        VK_CORE_INFO("Built {} LODs and {} meshlets for {} meshes in {}ms", lods.size(), meshlets.size(), lodGroups.size(), buildTimer.ElapsedMillis());
+    }
 
-                    if (indexAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
-                    {
-                        index = *reinterpret_cast<const uint16_t*>(indexData + i * indexStride);
-                    }
-                    else if (indexAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
-                    {
-                        index = *reinterpret_cast<const uint32_t*>(indexData + i * indexStride);
-                    }
-                    else if (indexAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
-                    {
-                        index = *reinterpret_cast<const uint8_t*>(indexData + i * indexStride);
-                    }
+    void Renderer::registerModel()
+    {
+        m_BaseMeshletCount = 0;
+        m_BaseTriangleCount = 0;
 
-                    indices.push_back(baseVertex + index);
-                }
+        // The whole model is one allocation, its meshes are records inside it. They share the model's index width:
+        // meshlet culling draws every mesh from one index buffer with model-wide indices, so a model over 65536
+        // vertices keeps all of its meshes on 32 bit indices.
+        m_ModelMesh = Geometry::AppendGeometry(MODEL_PATH, m_ModelVertices, m_ModelIndices);
+        m_ModelSubMeshes.clear();
+        m_ModelSubMeshes.reserve(m_ModelRanges.size());
+
+        for (size_t i = 0; i < m_ModelRanges.size(); i++)
+        {
+            const CookedMeshRange& range = m_ModelRanges[i];
+            MeshHandle subMesh = MeshRegistry::Create(range.Name);
+            m_ModelSubMeshes.push_back(subMesh);
+
+            MeshRecord& record = MeshRegistry::Get(subMesh);
+            record.VertexOffset = range.VertexOffset;
+            record.VertexCount = range.VertexCount;
+            record.IndexOffset = range.IndexOffset;
+            record.IndexCount = range.IndexCount;
+            record.IndexType = MeshRegistry::Get(m_ModelMesh).IndexType;
+            record.Parent = m_ModelMesh;
+
+            if (i >= m_ModelLodGroups.size())
+                continue;
+
+            const shaderio::MeshLodGroup& group = m_ModelLodGroups[i];
+            for (uint32_t level = 1; level < group.lodCount; level++)
+            {
+                const shaderio::MeshLod& lod = m_ModelLods[group.firstLod + level];
+                record.LodRanges.emplace_back(lod.firstIndex, lod.indexCount);
             }
+
+            const shaderio::MeshLod& baseLod = m_ModelLods[group.firstLod];
+            m_BaseMeshletCount += baseLod.meshletCount;
+            m_BaseTriangleCount += baseLod.indexCount / 3;
+        }
+    }
+
+    void Renderer::updateLodComparison(float deltaTime, const shaderio::MeshletCullStats& meshletStats)
+    {
+        LodComparison& comparison = s_LodComparison;
+        if (comparison.Frame >= LOD_COMPARISON_WARMUP_FRAMES)
+        {
+            comparison.FrameTime[comparison.Phase] += deltaTime;
+            comparison.Triangles[comparison.Phase] += meshletStats.visibleTriangles;
+            comparison.Samples[comparison.Phase]++;
+        }
+
+        if (++comparison.Frame < LOD_COMPARISON_WARMUP_FRAMES + LOD_COMPARISON_FRAMES)
+            return;
+
+        if (comparison.Phase == 0)
+        {
+            comparison.Phase = 1;
+            comparison.Frame = 0;
+            m_LodEnabled = true;
+            return;
+        }
+
+        comparison.Running = false;
+        m_LodEnabled = comparison.RestoreLodEnabled;
+
+        double frameMs[2];
+        uint64_t triangles[2];
+        for (int phase = 0; phase < 2; phase++)
+        {
+            frameMs[phase] = comparison.FrameTime[phase] * 1000.0 / comparison.Samples[phase];
+            triangles[phase] = comparison.Triangles[phase] / comparison.Samples[phase];
+        }
+
+        VK_CORE_INFO("[LOD] distance {:.1f}, threshold {:.2f}px | off: {:.3f} ms, {} triangles/frame ({:.1f} Mtri/s) | on: {:.3f} ms, {} triangles/frame ({:.1f} Mtri/s)",
+                     m_CameraDistance, m_LodThreshold,
+                     frameMs[0], triangles[0], triangles[0] / (frameMs[0] * 1000.0),
+                     frameMs[1], triangles[1], triangles[1] / (frameMs[1] * 1000.0));
+    }
+
+    void Renderer::CompareModelLoaders()
+    {
+        auto run = [](const char* name, const std::string& path, auto&& importer)
+        {
+            std::vector<shaderio::InstancedVertexData> tempVertices;
+            std::vector<uint32_t> tempIndices;
+            std::vector<CookedMeshRange> tempRanges;
+
+            size_t peakBefore = Utility::GetPeakResidentMemory();
+            Timer timer;
+            importer(path, tempVertices, tempIndices, tempRanges);
+            float elapsed = timer.ElapsedMillis();
+            size_t peakAfter = Utility::GetPeakResidentMemory();
+
+            VK_CORE_INFO("[ModelLoader] {:<12} {:8.2f} ms | peak RSS +{:.2f} MB (now {:.2f} MB) | {} vertices, {} indices",
+                         name, elapsed, (peakAfter - peakBefore) / (1024.0 * 1024.0), peakAfter / (1024.0 * 1024.0),
+                         tempVertices.size(), tempIndices.size());
+        };
+
+        // peak RSS only ever grows, so the mapped reader runs first and tinygltf has to beat its high-water mark
+        run("GlbReader", MODEL_PATH, ImportGlb);
+        run("tinygltf", MODEL_PATH, ImportTinyGltf);
+
+        // the same asset also ships as OBJ next to the GLB
+        std::string objPath = std::filesystem::path(MODEL_PATH).replace_extension(".obj").string();
+        if (std::filesystem::exists(objPath))
+        {
+            run("ObjImporter", objPath, [](const std::string& path, auto& outVertices, auto& outIndices, auto& outRanges)
+            {
+                ObjImporter::Import(path, outVertices, outIndices, outRanges);
+            });
         }
     }
     
-    void Renderer::Init(Window& window)
+    void Renderer::RunGeometryChurn()
+    {
+        // Fills the geometry buffers with spheres of different sizes and frees every other one, run it twice
+        // to see the holes reused, the buffers grow and background compaction close the gaps
+        static uint32_t churnRound = 0;
+        constexpr uint32_t churnCount = 48;
+        static std::array<MeshHandle, churnCount> churnMeshes;
+
+        for (uint32_t i = churnRound % 2; i < churnCount; i += 2)
+            Geometry::RemoveGeometry(churnMeshes[i]);
+
+        std::vector<shaderio::InstancedVertexData> sphereVertices;
+        std::vector<uint32_t> sphereIndices;
+        for (uint32_t i = churnRound % 2; i < churnCount; i += 2)
+        {
+            uint32_t segments = 8 + (i * 7 + churnRound * 5) % 40;
+            GeometryData::GenerateSphere(0.5f, segments, segments * 2, sphereVertices, sphereIndices);
+            churnMeshes[i] = Geometry::AppendGeometry("GeometryChurn" + std::to_string(i), sphereVertices, sphereIndices);
+        }
+        for (uint32_t i = 1 - churnRound % 2; i < churnCount; i += 4)
+            Geometry::RemoveGeometry(churnMeshes[i]);
+        churnRound++;
+
+        Geometry::Stats stats = Geometry::GetStats();
+        VK_CORE_INFO("Geometry churn: vertices {} free in {} ranges, 16 bit indices {} free in {} ranges, 32 bit indices {} free in {} ranges, {} KiB pending",
+                     stats.Vertices.FreeSpace, stats.Vertices.FreeRegions, stats.Indices16.FreeSpace, stats.Indices16.FreeRegions,
+                     stats.Indices32.FreeSpace, stats.Indices32.FreeRegions, stats.PendingUploadBytes / 1024);
+
+        // every node is either an allocation or a free range, the allocators' node arrays must not grow with churn
+        for (const OffsetAllocator::Stats& allocator : {stats.Vertices, stats.Indices16, stats.Indices32, stats.Instances})
+            VK_CORE_ASSERT(allocator.Nodes == allocator.Allocations + allocator.FreeRegions, "Geometry allocator leaked nodes");
+    }
+
+    uint64_t Renderer::FrameUploadBytes()
+    {
+        // what DrawFrame pushes through the ring every frame
+        return GeometryUploadBudget + sizeof(shaderio::MeshletCullStats) + m_RenderQueue.GetUploadBytes() + TransferRingSlack;
+    }
+
+    void Renderer::ReserveTransferRing(uint64_t bytes)
+    {
+        // one region per frame in flight, BeginFrame only hands one out again once the frame that wrote it is done
+        const uint32_t framesInFlight = std::max(RenderCommand::GetFramesInFlight(), 1u);
+        uint32_t regionCount = framesInFlight;
+        bool hasRegion = false;
+        if (m_TransferRingBuffer && m_TransferRingBuffer->GetRegionCount() >= framesInFlight)
+        {
+            hasRegion = m_TransferRingBuffer->BeginFrame();
+            if (hasRegion && bytes <= m_TransferRingBuffer->GetFreeSpace(TransferRingAlignment))
+                return;
+            // all regions busy only happens while the frames in flight change, one more region covers the overlap
+            regionCount = m_TransferRingBuffer->GetRegionCount() + (hasRegion ? 0 : 1);
+        }
+
+        // the ring's contents only live for the frame, so there is nothing to copy over
+        uint64_t regionSize = m_TransferRingBuffer ? m_TransferRingBuffer->GetRegionSize() : 0;
+        if (hasRegion || bytes > regionSize)
+            regionSize = std::max(bytes, regionSize + regionSize / 2);
+        DeferredRelease::Retire(m_TransferRingBuffer);
+        m_TransferRingBuffer.reset(TransferBuffer::Create(regionSize, VanKTransferBufferUsageUpload, regionCount));
+        m_TransferRingBuffer->BeginFrame();
+        if (m_TransferRingCapacity != 0)
+            VK_CORE_INFO("Replaced transfer ring, {} KiB in {} regions, was {} KiB", regionSize * regionCount / 1024, regionCount, m_TransferRingCapacity / 1024);
+        m_TransferRingCapacity = regionSize * regionCount;
+    }
+
+    void Renderer::Init(Window& window, uint32_t renderThreadQueueDepth, uint32_t framesInFlight, bool headless)
     {
         RendererAPI::Config config;
         config.window = window.getWindowHandle();
+        config.framesInFlight = framesInFlight;
+        config.headless = headless;
+        config.headlessExtent = {window.getSpecification().Width, window.getSpecification().Height};
 
         RenderCommand::SetConfig(config);
         RenderCommand::Init();
@@ -279,7 +735,7 @@ namespace VanK
         m_GraphicsDebugPipelineSpecification = GraphicsPipelineSpecification;
 
         m_GraphicsDebugPipeline = RenderCommand::createGraphicsPipeline(m_GraphicsDebugPipelineSpecification);
-        RegisterPipelineForShaderWatcher("DebugShader", "shader.slang", &m_GraphicsDebugPipelineSpecification, nullptr, &m_GraphicsDebugPipeline, VanKGraphics);
+        RegisterPipelineForShaderWatcher("DebugShader", "shader.slang", &m_GraphicsDebugPipelineSpecification, nullptr, m_GraphicsDebugPipeline, VanKGraphics);
         
         // Compute Pipelines creations
         VanKComputePipelineCreateInfo ComputePipelineCreateInfo
@@ -295,7 +751,7 @@ namespace VanK
         m_ComputeDrawIndirectPipelineSpecification = computePipelineSpecification;
         
         m_ComputeDrawIndirectPipeline = RenderCommand::createComputeShaderPipeline(m_ComputeDrawIndirectPipelineSpecification);
-        RegisterPipelineForShaderWatcher("DrawIndirectShader", "DrawIndirectShader.slang", nullptr, &m_ComputeDrawIndirectPipelineSpecification, &m_ComputeDrawIndirectPipeline, VanKCompute);
+        RegisterPipelineForShaderWatcher("DrawIndirectShader", "DrawIndirectShader.slang", nullptr, &m_ComputeDrawIndirectPipelineSpecification, m_ComputeDrawIndirectPipeline, VanKCompute);
 
         WatchShaderFiles(); // has to be after rednerer2d init othwerise it cant watch it beacuse not created shaders
 
@@ -306,21 +762,43 @@ namespace VanK
         /*vertices = GeometryData::cubeVertices;
         indices = GeometryData::cubeIndices;*/
         
-        size_t vertexBufferSize = sizeof(vertices[0]) * vertices.size();
-        m_InstancedVertexBuffer.reset(VertexBuffer::Create(vertexBufferSize));
+        // the model is the first range of the shared geometry buffers, they grow if more is appended later
+        Geometry::Init(std::max<uint32_t>(static_cast<uint32_t>(m_ModelVertices.size()), MinGeometryVertices),
+                       std::max<uint32_t>(static_cast<uint32_t>(m_ModelIndices.size()), MinGeometryIndices));
+        registerModel();
+
+        // the model's meshlet and LOD tables never change, they are staged once and copied at the start of the first frame
+        m_MeshletBuffer.Init(m_ModelMeshlets.size_bytes());
+        m_LodGroupBuffer.Init(m_ModelLodGroups.size_bytes());
+        m_LodBuffer.Init(m_ModelLods.size_bytes());
+        m_MeshletBuffer->Upload(m_ModelMeshlets.data(), m_ModelMeshlets.size_bytes(), 0);
+        m_LodGroupBuffer->Upload(m_ModelLodGroups.data(), m_ModelLodGroups.size_bytes(), 0);
+        m_LodBuffer->Upload(m_ModelLods.data(), m_ModelLods.size_bytes(), 0);
+
+        // worst case every meshlet is visible and gets its own draw
+        indirectBuffer.Init(sizeof(shaderio::DrawIndexedIndirectCommand) * m_ModelMeshlets.size());
+
+        size_t countBufferSize = sizeof(shaderio::MeshletCullStats) * MeshletStatsSlots;
+        countBuffer.reset(IndirectBuffer::Create(countBufferSize));
 
-        size_t indexBufferSize = sizeof(indices[0]) * indices.size();
-        m_InstancedIndexBuffer.reset(IndexBuffer::Create(indexBufferSize));
+        m_RenderQueue.Init(256);
 
-        uint32_t maxDraws = 1;
-        size_t indirectBufferSize = sizeof(shaderio::DrawIndexedIndirectCommand) * maxDraws;
-        indirectBuffer.reset(IndirectBuffer::Create(indirectBufferSize));
+        ReserveTransferRing(FrameUploadBytes());
+        publishFrameStats();
 
-        size_t countBufferSize = sizeof(uint32_t);
-        countBuffer.reset(IndirectBuffer::Create(countBufferSize));
+        if (renderThreadQueueDepth > 0)
+        {
+            // platform windows are rendered and presented from the main thread, that would race the render thread for the queue
+            ImGui::GetIO().ConfigFlags &= ~ImGuiConfigFlags_ViewportsEnable;
 
-        size_t transferSize = vertexBufferSize + indexBufferSize + indirectBufferSize + countBufferSize;
-        m_TransferRingBuffer.reset(TransferBuffer::Create(transferSize, VanKTransferBufferUsageUpload));
+            // everything from here on is recorded and submitted on the render thread
+            m_RenderThread.Start(renderThreadQueueDepth, [](FramePacket& packet)
+            {
+                BeginSubmit();
+                DrawFrame(packet);
+                EndSubmit();
+            });
+        }
         // 4            4        156         152                   152
         //draw calls, meshes, instances, actualy instances, draws saved by instancing
         //pipeline statatistics imputassemblyvertices/primitives vertexshaderinvocation clippinginvocation clipping primitives fragmentshaderinvocations computershaderinvocatinon
@@ -331,6 +809,10 @@ namespace VanK
     //maybe move to vulkanrenderapi backend ?
     void Renderer::Shutdown() 
     {
+        // renders what is still queued
+        m_RenderThread.Stop();
+        m_TextureRequestPacket.reset();
+
         RenderCommand::waitForGraphicsQueueIdle();
 
         RenderCommand::DestroyAllPipelines();
@@ -340,16 +822,41 @@ namespace VanK
         uniformScene.reset();
 
         m_TransferRingBuffer.reset();
+        m_TransferRingCapacity = 0;
 
-        indirectBuffer.reset();
+        indirectBuffer.Reset();
 
         countBuffer.reset();
 
-        m_InstancedVertexBuffer.reset();
-        
-        m_InstancedIndexBuffer.reset();
+        m_RenderQueue.Reset();
+
+        m_MeshletBuffer.Reset();
+
+        m_LodGroupBuffer.Reset();
 
-        m_InstancedStorageBuffer.reset();
+        m_LodBuffer.Reset();
+
+        Geometry::Shutdown();
+        MeshRegistry::Clear();
+        m_ModelMesh = {};
+        m_ModelSubMeshes.clear();
+
+        m_InstancedStorageBuffer.Reset();
+
+        // the queue is idle, nothing can still read a retired buffer
+        DeferredRelease::ReleaseAll();
+
+        m_ModelVertices = {};
+        m_ModelIndices = {};
+        m_ModelMeshlets = {};
+        m_ModelLodGroups = {};
+        m_ModelLods = {};
+        m_ModelRanges = {};
+        meshRanges.clear();
+        meshlets.clear();
+        lodGroups.clear();
+        lods.clear();
+        m_CookedModel.reset();
     }
 
     void Renderer::BeginSubmit()
@@ -366,57 +873,18 @@ namespace VanK
         RenderCommand::EndCommandBuffer(cmd);
         RenderCommand::EndFrame();
     }
-    static auto lastTime = std::chrono::high_resolution_clock::now();
-    static int frameCount = 0;
-    static float fps = 0.0f;
-    void Renderer::DrawFrame()
+    void Renderer::BuildFrame(FramePacket& packet)
     {
-        if (windowMinimized)
-            return;
-        
-        UploadBufferToGpuWithTransferRing(cmd, m_TransferRingBuffer, m_InstancedVertexBuffer, vertices, shaderio::InstancedVertexData, 0);
-        UploadBufferToGpuWithTransferRing(cmd, m_TransferRingBuffer, m_InstancedIndexBuffer, indices, uint32_t, 0);
-
-        /*std::vector<VanKDrawIndexedIndirectCommand> drawCommands(1);
-
-        for (uint32_t i = 0; i < 1; i++)
-        {
-            drawCommands[i].indexCount   = indices.size();
-            drawCommands[i].instanceCount= 1;
-            drawCommands[i].firstIndex   = 0;
-            drawCommands[i].vertexOffset = 0;
-            drawCommands[i].firstInstance = i;
-        }
-        UploadBufferToGpuWithTransferRing(cmd, transferRing, indirectBuffer, drawCommands, VanKDrawIndexedIndirectCommand, 0);
-
-        uint32_t drawCount = 1;
-        std::vector<uint32_t> countVec = { drawCount };
-        UploadBufferToGpuWithTransferRing(cmd, transferRing, countBuffer, countVec, uint32_t, 0);*/
-        
-        frameCount++;
-        auto now = std::chrono::high_resolution_clock::now();
-        float elapsed = std::chrono::duration<float>(now - lastTime).count();
-        if (elapsed >= 1.0f)
+        FrameStats stats;
         {
-            fps = frameCount / elapsed;
-            frameCount = 0;
-            lastTime = now;
-            std::cout << "FPS: " << fps << std::endl;
-        }
-        if (s_IsPipelineReloadFinished.exchange(false))
-        {
-            IsShaderReloadFinished = false;
-            if (s_ShaderWatcher.empty())
-                WatchShaderFiles();
-
-            EndSubmit();
-            ReloadPipelines();
-            BeginSubmit();
-            return;
+            std::scoped_lock lock(m_FrameStatsMutex);
+            stats = m_FrameStats;
         }
+        packet.Commands.clear();
 
         ImGui_ImplVulkan_NewFrame();
-        ImGui_ImplSDL3_NewFrame();
+        if (!RenderCommand::IsHeadless())
+            ImGui_ImplSDL3_NewFrame();
         ImGui::NewFrame();
 
         /*--
@@ -445,7 +913,8 @@ namespace VanK
             {
                 if (ImGui::MenuItem("vSync", "", &vSync))
                 {
-                    RenderCommand::RebuildSwapchain(vSync); // Recreate the swapchain with the new vSync setting
+                    // Recreate the swapchain with the new vSync setting
+                    packet.Commands.emplace_back([enabled = vSync] { RenderCommand::RebuildSwapchain(enabled); });
                 }
                 ImGui::Separator();
                 if (ImGui::MenuItem("Exit"))
@@ -457,6 +926,38 @@ namespace VanK
                 }
                 ImGui::EndMenu();
             }
+            if (ImGui::BeginMenu("Debug"))
+            {
+                if (ImGui::MenuItem("Benchmark mesh decode"))
+                {
+                    MeshDecode::RunBenchmark();
+                }
+                if (ImGui::MenuItem("Compare model loaders"))
+                {
+                    CompareModelLoaders();
+                }
+                if (ImGui::MenuItem("Geometry allocator churn"))
+                {
+                    // the geometry buffers belong to the render thread
+                    packet.Commands.emplace_back([] { RunGeometryChurn(); });
+                }
+                if (ImGui::MenuItem("Benchmark render queue sort"))
+                {
+                    RenderQueue::RunBenchmark();
+                }
+                if (ImGui::MenuItem("Benchmark job system"))
+                {
+                    JobSystem::RunBenchmark();
+                }
+                if (ImGui::MenuItem("Compare LOD on/off", nullptr, false, !s_LodComparison.Running))
+                {
+                    s_LodComparison = {};
+                    s_LodComparison.Running = true;
+                    s_LodComparison.RestoreLodEnabled = m_LodEnabled;
+                    m_LodEnabled = false;
+                }
+                ImGui::EndMenu();
+            }
             ImGui::EndMainMenuBar();
         }
 
@@ -475,13 +976,13 @@ namespace VanK
 
             if (m_ViewportSize.width != lastViewportExtent.width || m_ViewportSize.height != lastViewportExtent.height)
             {
-                
+
                 lastViewportExtent.width = m_ViewportSize.width;
                 lastViewportExtent.height = m_ViewportSize.height;
 
-                RenderCommand::setViewportSize(m_ViewportSize);
+                packet.Commands.emplace_back([size = m_ViewportSize] { RenderCommand::setViewportSize(size); });
             }
-            
+
             // !!! This is where the GBuffer image is displayed !!!
             ImGui::Image(RenderCommand::getImTextureID(0), viewportSize);
 
@@ -491,93 +992,399 @@ namespace VanK
         }
         ImGui::End();
 
+        if (ImGui::Begin("Settings"))
+        {
+            ImGui::Checkbox("Meshlet culling", &m_MeshletCulling);
+            ImGui::BeginDisabled(s_LodComparison.Running);
+            ImGui::Checkbox("LOD selection", &m_LodEnabled);
+            ImGui::EndDisabled();
+            ImGui::SliderFloat("LOD error (px)", &m_LodThreshold, 0.25f, 16.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+            ImGui::SliderFloat("Camera distance", &m_CameraDistance, 1.0f, 200.0f, "%.1f", ImGuiSliderFlags_Logarithmic);
+
+            // totals are LOD 0, what would be drawn without culling and LOD selection
+            ImGui::Text("Meshlets visible: %u / %u", stats.Meshlets.visibleMeshlets, m_BaseMeshletCount);
+            ImGui::Text("Triangles submitted: %u / %llu (%.1f%%)", stats.Meshlets.visibleTriangles, static_cast<unsigned long long>(m_BaseTriangleCount),
+                        m_BaseTriangleCount ? 100.0 * stats.Meshlets.visibleTriangles / m_BaseTriangleCount : 0.0);
+            ImGui::Text("Indirect draws: %u", stats.Meshlets.drawCount);
+            ImGui::Text("Frame time: %.3f ms", 1000.0f / ImGui::GetIO().Framerate);
+
+            ImGui::SeparatorText("Geometry buffers");
+            bool compaction = stats.BackgroundCompaction;
+            if (ImGui::Checkbox("Background compaction", &compaction))
+                packet.Commands.emplace_back([compaction] { Geometry::SetBackgroundCompaction(compaction); });
+            auto allocatorText = [](const char* label, const OffsetAllocator::Stats& allocatorStats)
+            {
+                ImGui::Text("%s: %u / %u used, %u free ranges, largest %u", label, allocatorStats.Capacity - allocatorStats.FreeSpace, allocatorStats.Capacity,
+                            allocatorStats.FreeRegions, allocatorStats.LargestFreeRegion);
+            };
+            const Geometry::Stats& geometryStats = stats.GeometryBuffers;
+            allocatorText("Vertices", geometryStats.Vertices);
+            allocatorText("Indices (16 bit)", geometryStats.Indices16);
+            allocatorText("Indices (32 bit)", geometryStats.Indices32);
+            ImGui::Text("Pending upload: %.1f KiB, growths: %u, moves: %u", geometryStats.PendingUploadBytes / 1024.0,
+                        geometryStats.Growths, geometryStats.CompactionMoves);
+            ImGui::Text("Transfer ring: %.1f MiB, retired buffers waiting: %u", stats.TransferRingCapacity / (1024.0 * 1024.0),
+                        stats.RetiredBuffers);
+
+            ImGui::SeparatorText("Pipelines");
+            ImGui::Text("Live: %u, cache hits: %llu, misses: %llu", stats.Pipelines.Pipelines,
+                        static_cast<unsigned long long>(stats.Pipelines.Hits), static_cast<unsigned long long>(stats.Pipelines.Misses));
+            ImGui::Text("State binds issued: %u, filtered: %u", stats.Commands.Issued, stats.Commands.Filtered);
+
+            ImGui::SeparatorText("Render queue");
+            const RenderQueue::Stats& queueStats = stats.Queue;
+            ImGui::Text("Packets: %u, batches: %u, pipeline switches: %u", queueStats.Packets, queueStats.Batches, queueStats.PipelineSwitches);
+            ImGui::Text("Sort: %.3f ms", queueStats.SortMillis);
+            ImGui::BeginDisabled(!RenderCommand::IsParallelRecordingSupported());
+            ImGui::Checkbox("Parallel recording", &m_ParallelRecording);
+            ImGui::EndDisabled();
+            ImGui::Text("Recording: %.3f ms on %u of %u threads", queueStats.RecordMillis, queueStats.RecordThreads, stats.RecordingThreads);
+
+            ImGui::SeparatorText("Frame pacing");
+            int framesInFlight = static_cast<int>(stats.FramesInFlight);
+            if (ImGui::SliderInt("Frames in flight", &framesInFlight, 1, 4))
+                packet.Commands.emplace_back([framesInFlight] { RenderCommand::SetFramesInFlight(static_cast<uint32_t>(framesInFlight)); });
+            ImGui::Text("Recording frame %llu, GPU finished frame %llu", static_cast<unsigned long long>(stats.RecordingFrame),
+                        static_cast<unsigned long long>(stats.CompletedFrame));
+            ImGui::Checkbox("Low latency", &m_LowLatency);
+            ImGui::SameLine();
+            ImGui::TextDisabled(stats.PresentWait ? "(waits for the present)" : "(waits for the GPU, no present wait)");
+            const char* latencyModes[] = { "Default", "Low latency" };
+            for (size_t mode = 0; mode < stats.Latency.size(); mode++)
+            {
+                const LatencyStats& latency = stats.Latency[mode];
+                ImGui::Text("%-11s input to submit %6.2f ms, to present %6.2f ms (%u frames)", latencyModes[mode],
+                            latency.InputToSubmitMillis, latency.InputToPresentMillis, latency.Frames);
+            }
+            if (ImGui::Button("Reset latency"))
+                packet.Commands.emplace_back([] { m_Latency = {}; });
+
+            ImGui::SeparatorText("Render thread");
+            if (m_RenderThread.IsRunning())
+            {
+                RenderThread::Stats threadStats = m_RenderThread.GetStats();
+                ImGui::Text("Queue depth: %u, queued: %u", m_RenderThread.GetQueueDepth(), threadStats.Queued);
+                ImGui::Text("Main thread waited: %.3f ms, last frame rendered in %.3f ms", threadStats.WaitMillis, threadStats.RenderMillis);
+            }
+            else
+                ImGui::TextUnformatted("Rendering on the main thread");
+        }
+        ImGui::End();
+
         ImGui::Render(); // This is creating the data to draw the UI (not on GPU yet)
-        
+
         static auto startTime = std::chrono::high_resolution_clock::now();
         static auto lastFrameTime = startTime;
         auto currentTime = std::chrono::high_resolution_clock::now();
-        float time = std::chrono::duration<float>(currentTime - startTime).count();
         float deltaTime = std::chrono::duration<float>(currentTime - lastFrameTime).count();
         lastFrameTime = currentTime;
 
+        if (s_LodComparison.Running)
+            updateLodComparison(deltaTime, stats.Meshlets);
+
         // Camera and projection matrices (shared by all objects)
-        glm::mat4 view = glm::lookAt(glm::vec3(2.0f, 2.0f, 6.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        glm::mat4 proj = glm::perspective(glm::radians(45.0f),
-                                          static_cast<float>(m_ViewportSize.width) / static_cast<float>(m_ViewportSize.
-                                              height), 0.1f, 20.0f);
-        proj[1][1] *= -1;
-        
-        s_Data.camData.view = view;
-        s_Data.camData.proj = proj;
+        packet.CameraPosition = glm::normalize(glm::vec3(2.0f, 2.0f, 6.0f)) * m_CameraDistance;
+        packet.View = glm::lookAt(packet.CameraPosition, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        packet.Proj = glm::perspective(glm::radians(45.0f),
+                                       static_cast<float>(m_ViewportSize.width) / static_cast<float>(m_ViewportSize.
+                                           height), 0.1f, m_CameraDistance + 20.0f);
+        packet.LodErrorScale = packet.Proj[1][1] * 0.5f * static_cast<float>(m_ViewportSize.height);
+        packet.Proj[1][1] *= -1;
+
+        packet.ViewportSize = m_ViewportSize;
+        packet.CameraDistance = m_CameraDistance;
+        packet.LodThreshold = m_LodThreshold;
+        packet.LodEnabled = m_LodEnabled;
+        packet.MeshletCulling = m_MeshletCulling;
+        packet.ParallelRecording = m_ParallelRecording && RenderCommand::IsParallelRecordingSupported();
+        packet.LowLatency = m_LowLatency;
+        packet.InputNs = m_PendingInputNs;
+        m_PendingInputNs = 0;
+
+        // without a render thread the draw data is rendered before ImGui starts over
+        if (m_RenderThread.IsRunning())
+            packet.UI.Capture(*ImGui::GetDrawData());
+        else
+            packet.UI.Clear();
+    }
+
+    static auto lastTime = std::chrono::high_resolution_clock::now();
+    static int frameCount = 0;
+    static float fps = 0.0f;
+    void Renderer::DrawFrame(FramePacket& packet)
+    {
+        for (const std::function<void()>& command : packet.Commands)
+            command();
+
+        if (s_IsPipelineReloadFinished.exchange(false))
+        {
+            IsShaderReloadFinished = false;
+            if (s_ShaderWatcher.empty())
+                WatchShaderFiles();
+
+            EndSubmit();
+            ReloadPipelines();
+            BeginSubmit();
+            // the packet is still drawn, its UI may carry texture uploads ImGui is waiting on
+        }
+
+        updateLatency(packet);
+
+        if (windowMinimized)
+            return;
+
+        DeferredRelease::NextFrame();
+        ReserveTransferRing(FrameUploadBytes());
+
+        // may replace the vertex and index buffers, nothing below holds on to the old ones
+        Geometry::Flush(cmd, GeometryUploadBudget);
+
+        // the indirect draws are rewritten by the culling pass, so growing doesn't need the old contents
+        indirectBuffer.Reserve(cmd, sizeof(shaderio::DrawIndexedIndirectCommand) * m_ModelMeshlets.size(), 0);
+
+        /*std::vector<VanKDrawIndexedIndirectCommand> drawCommands(1);
+
+        for (uint32_t i = 0; i < 1; i++)
+        {
+            drawCommands[i].indexCount   = indices.size();
+            drawCommands[i].instanceCount= 1;
+            drawCommands[i].firstIndex   = 0;
+            drawCommands[i].vertexOffset = 0;
+            drawCommands[i].firstInstance = i;
+        }
+        UploadBufferToGpuWithTransferRing(cmd, transferRing, indirectBuffer, drawCommands, VanKDrawIndexedIndirectCommand, 0);
+
+        uint32_t drawCount = 1;
+        std::vector<uint32_t> countVec = { drawCount };
+        UploadBufferToGpuWithTransferRing(cmd, transferRing, countBuffer, countVec, uint32_t, 0);*/
+
+        frameCount++;
+        auto now = std::chrono::high_resolution_clock::now();
+        float elapsed = std::chrono::duration<float>(now - lastTime).count();
+        if (elapsed >= 1.0f)
+        {
+            fps = frameCount / elapsed;
+            frameCount = 0;
+            lastTime = now;
+            std::cout << "FPS: " << fps << std::endl;
+        }
+
+        // BeginFrame waited for the frame frames-in-flight before this one, the stats slot it wrote is complete
+        uint32_t statsSlot = static_cast<uint32_t>(m_MeshletFrameIndex % MeshletStatsSlots);
+        const uint32_t framesInFlight = RenderCommand::GetFramesInFlight();
+        if (m_MeshletFrameIndex >= framesInFlight)
+        {
+            uint32_t readSlot = static_cast<uint32_t>((m_MeshletFrameIndex - framesInFlight) % MeshletStatsSlots);
+            countBuffer->Read(&m_MeshletStats, sizeof(m_MeshletStats), readSlot * sizeof(shaderio::MeshletCullStats));
+        }
+        m_MeshletFrameIndex++;
+
+        // the compute pass appends into this slot, so it starts at zero every frame
+        uint32_t statsOffset = statsSlot * sizeof(shaderio::MeshletCullStats);
+        std::array<shaderio::MeshletCullStats, 1> clearedStats = {};
+        UploadBufferToGpuWithTransferRing(cmd, m_TransferRingBuffer, countBuffer, clearedStats, shaderio::MeshletCullStats, statsOffset);
+
+        s_Data.camData.view = packet.View;
+        s_Data.camData.proj = packet.Proj;
         s_Data.camData.vertexAddress = m_InstancedVertexBuffer->GetBufferAddress();
-        s_Data.camData.indexAddress = m_InstancedIndexBuffer->GetBufferAddress();
+        // the model is drawn from whichever index buffer matches its index width
+        const MeshRecord* model = MeshRegistry::TryGet(m_ModelMesh);
+        VanKIndexElementSize modelIndexType = model ? model->IndexType : VanKIndexElementSize::Uint32;
+        s_Data.camData.indexAddress = Geometry::GetIndexBuffer(modelIndexType).GetBufferAddress();
         s_Data.camData.indirectAddress = indirectBuffer->GetBufferAddress();
-        s_Data.camData.countAddress = countBuffer->GetBufferAddress();
-        s_Data.camData.numVertices = static_cast<uint32_t>(vertices.size());
-        s_Data.camData.numindicies = static_cast<uint32_t>(indices.size());
-        uniformScene->Update(cmd, &s_Data.camData, sizeof(s_Data.camData));
+        s_Data.camData.countAddress = countBuffer->GetBufferAddress() + statsOffset;
+        s_Data.camData.numVertices = static_cast<uint32_t>(m_ModelVertices.size());
+        s_Data.camData.numindicies = static_cast<uint32_t>(m_ModelIndices.size());
+        ExtractFrustumPlanes(packet.Proj * packet.View, s_Data.camData.frustumPlanes);
+        s_Data.camData.cameraPosition = packet.CameraPosition;
+        s_Data.camData.meshletCount = static_cast<uint32_t>(m_ModelMeshlets.size());
+        s_Data.camData.meshletBuffer = m_MeshletBuffer->GetBufferAddress();
+        s_Data.camData.meshletCulling = packet.MeshletCulling ? 1 : 0;
+        s_Data.camData.lodGroupBuffer = m_LodGroupBuffer->GetBufferAddress();
+        s_Data.camData.lodBuffer = m_LodBuffer->GetBufferAddress();
+        s_Data.camData.lodGroupCount = static_cast<uint32_t>(m_ModelLodGroups.size());
+        s_Data.camData.lodErrorScale = packet.LodErrorScale;
+        s_Data.camData.lodThreshold = packet.LodThreshold;
+        s_Data.camData.lodEnabled = packet.LodEnabled ? 1 : 0;
+        // meshlet and LOD index ranges are relative to the model's own geometry range
+        s_Data.camData.baseVertex = model ? model->VertexOffset : 0;
+        s_Data.camData.baseIndex = model ? model->IndexOffset : 0;
+        uniformScene->Update(&s_Data.camData, sizeof(s_Data.camData));
         RenderCommand::BindUniformBuffer(cmd, VanKPipelineBindPoint::Graphics, uniformScene.get(), 1, 0, 0);
         RenderCommand::BindUniformBuffer(cmd, VanKPipelineBindPoint::Compute, uniformScene.get(), 1, 0, 0);
-        
+
         VanKComputePass* computePass = RenderCommand::BeginComputePass(cmd, m_InstancedVertexBuffer.get());
-        
+
         RenderCommand::BindPipeline(cmd, VanKPipelineBindPoint::Compute, m_ComputeDrawIndirectPipeline);
-        
-        RenderCommand::DispatchCompute(computePass, 1, 1, 1);
+
+        uint32_t meshletGroups = (s_Data.camData.meshletCount + 63) / 64; // numthreads(64,1,1) in DrawIndirectShader
+        RenderCommand::DispatchCompute(computePass, std::max(meshletGroups, 1u), 1, 1);
 
         RenderCommand::EndComputePass(computePass);
+
+        // one draw per visible meshlet, written by the culling pass, drawCount is the first field of the stats slot
+        DrawPacket modelPacket;
+        modelPacket.Pipeline = m_GraphicsDebugPipeline;
+        modelPacket.IndexType = modelIndexType;
+        modelPacket.SortKey = RenderQueue::MakeSortKey(DrawPass::Opaque, m_GraphicsDebugPipeline, modelIndexType, 0, packet.CameraDistance);
+        modelPacket.Indirect = indirectBuffer.get();
+        modelPacket.Count = countBuffer.get();
+        modelPacket.CountOffset = statsOffset;
+        modelPacket.MaxDrawCount = std::max<uint32_t>(s_Data.camData.meshletCount, 1);
+        m_RenderQueue.Submit(modelPacket);
+
+        // the ring was sized before anything was submitted, the queue's commands have to fit in what is left of the region
+        ReserveTransferRing(m_RenderQueue.GetUploadBytes());
+        m_RenderQueue.Prepare(cmd, *m_TransferRingBuffer);
         {
             std::vector<VanKColorTargetInfo> colorAttachments;
             colorAttachments.emplace_back(VanK_Format_B8G8R8A8Srgb, VanK_LOADOP_CLEAR, VanK_STOREOP_STORE, VanK_FColor{.f = {0.1f, 0.1f, 0.1f, 1.0f}});
 
             VanKDepthStencilTargetInfo depthStencilTargetInfo = {.loadOp = VanK_LOADOP_CLEAR, .storeOp = VanK_STOREOP_STORE, .clearColor = VanK_FColor{.f = {1.0f, 0}}};
-            
-            RenderCommand::BeginRendering(cmd, colorAttachments.data(), colorAttachments.size(), depthStencilTargetInfo, VanK_Render_None);
-            
-            RenderCommand::BindPipeline(cmd, VanKPipelineBindPoint::Graphics, m_GraphicsDebugPipeline);
-            
-            VanKViewport viewPort = { 0, 0, m_ViewportSize.width, m_ViewportSize.height, 0, 1 };
-            RenderCommand::SetViewport(cmd, 1, viewPort);
 
-            VankRect rect = { 0, 0, m_ViewportSize.width, m_ViewportSize.height };
-            RenderCommand::SetScissor(cmd, 1, rect);
-            
-            RenderCommand::BindFragmentSamplers(cmd, NULL, nullptr, NULL);
-            
-            /*RenderCommand::BindVertexBuffer(cmd, 0, *vertexMesh, 1);*/
+            VanKViewport viewPort = { 0, 0, packet.ViewportSize.width, packet.ViewportSize.height, 0, 1 };
+            VankRect rect = { 0, 0, packet.ViewportSize.width, packet.ViewportSize.height };
+
+            if (packet.ParallelRecording)
+            {
+                RenderCommand::BeginRendering(cmd, colorAttachments.data(), colorAttachments.size(), depthStencilTargetInfo, VanK_Render_None,
+                                              VanK_RenderingContents_SecondaryCommandBuffers);
 
-            RenderCommand::BindIndexBuffer(cmd, *m_InstancedIndexBuffer, VanKIndexElementSize::Uint32);
+                // secondaries inherit nothing, each one sets the viewport, scissor and scene uniforms itself
+                auto bindState = [&](VanKCommandBuffer secondary)
+                {
+                    RenderCommand::SetViewport(secondary, 1, viewPort);
+                    RenderCommand::SetScissor(secondary, 1, rect);
+                    RenderCommand::BindUniformBuffer(secondary, VanKPipelineBindPoint::Graphics, uniformScene.get(), 1, 0, 0);
+                };
+                m_RenderQueue.ExecuteParallel(cmd, DrawPass::Opaque, bindState);
+                m_RenderQueue.ExecuteParallel(cmd, DrawPass::Transparent, bindState);
+            }
+            else
+            {
+                RenderCommand::BeginRendering(cmd, colorAttachments.data(), colorAttachments.size(), depthStencilTargetInfo, VanK_Render_None);
+
+                RenderCommand::SetViewport(cmd, 1, viewPort);
+                RenderCommand::SetScissor(cmd, 1, rect);
 
-            /*RenderCommand::DrawIndexed(cmd, indices.size(), 1, 0, 0, 0);*/
-            RenderCommand::DrawIndexedIndirectCount(cmd, *indirectBuffer, 0, *countBuffer, 0, 1, sizeof(shaderio::DrawIndexedIndirectCommand));
+                /*RenderCommand::BindVertexBuffer(cmd, 0, *vertexMesh, 1);*/
+
+                m_RenderQueue.Execute(cmd, DrawPass::Opaque);
+                m_RenderQueue.Execute(cmd, DrawPass::Transparent);
+            }
 
             RenderCommand::EndRendering(cmd);
         }
-        
+        m_RenderQueue.Clear();
+
         {
+            RenderCommand::SetImGuiDrawData(packet.UI.Get());
             RenderCommand::BeginRendering(cmd, {}, {}, {}, VanK_Render_ImGui);
-            
+
             RenderCommand::EndRendering(cmd);
         }
-        
-        ImGui::EndFrame();
-        if ((ImGui::GetIO().ConfigFlags & ImGuiConfigFlags_ViewportsEnable) != 0)
+
+        publishFrameStats();
+    }
+
+    void Renderer::updateLatency(const FramePacket& packet)
+    {
+        RenderCommand::SetLowLatency(packet.LowLatency);
+        if (packet.InputNs != 0)
+            m_LatencySamples.push_back({ RenderCommand::GetRecordingFrame(), packet.InputNs, packet.LowLatency });
+
+        // frames are presented in order, one the backend no longer tracks is dropped once enough pile up behind it
+        constexpr size_t maxPendingSamples = 16;
+        while (!m_LatencySamples.empty())
         {
-            ImGui::UpdatePlatformWindows();
-            ImGui::RenderPlatformWindowsDefault();
+            const LatencySample& sample = m_LatencySamples.front();
+            VanKFrameTiming timing;
+            if (RenderCommand::GetFrameTiming(sample.Frame, timing))
+            {
+                // averages all frames at first, then follows the last 64 or so
+                LatencyStats& latency = m_Latency[sample.LowLatency ? 1 : 0];
+                latency.Frames++;
+                const float weight = std::max(1.0f / static_cast<float>(latency.Frames), 1.0f / 64.0f);
+                const float toSubmit = static_cast<float>(timing.SubmitNs - sample.InputNs) * 1.0e-6f;
+                const float toPresent = static_cast<float>(timing.PresentNs - sample.InputNs) * 1.0e-6f;
+                latency.InputToSubmitMillis += (toSubmit - latency.InputToSubmitMillis) * weight;
+                latency.InputToPresentMillis += (toPresent - latency.InputToPresentMillis) * weight;
+            }
+            else if (m_LatencySamples.size() <= maxPendingSamples)
+                break;
+            m_LatencySamples.pop_front();
         }
     }
 
+    void Renderer::publishFrameStats()
+    {
+        FrameStats stats
+        {
+            .Meshlets = m_MeshletStats,
+            .GeometryBuffers = Geometry::GetStats(),
+            .BackgroundCompaction = Geometry::IsBackgroundCompactionEnabled(),
+            .TransferRingCapacity = m_TransferRingCapacity,
+            .RetiredBuffers = DeferredRelease::GetPendingCount(),
+            .Pipelines = RenderCommand::GetPipelineCacheStats(),
+            .Commands = RenderCommand::GetCommandStats(),
+            .Queue = m_RenderQueue.GetStats(),
+            .RecordingThreads = RenderCommand::GetRecordingThreadCount(),
+            .FramesInFlight = RenderCommand::GetFramesInFlight(),
+            .RecordingFrame = RenderCommand::GetRecordingFrame(),
+            .CompletedFrame = RenderCommand::GetCompletedFrame(),
+            .Latency = m_Latency,
+            .PresentWait = RenderCommand::IsPresentWaitSupported()
+        };
+
+        std::scoped_lock lock(m_FrameStatsMutex);
+        m_FrameStats = stats;
+    }
+
     void Renderer::Flush()
     {
-        BeginSubmit();
-        DrawFrame();
-        EndSubmit();
+        if (!m_RenderThread.IsRunning())
+        {
+            BuildFrame(m_InlinePacket);
+            BeginSubmit();
+            DrawFrame(m_InlinePacket);
+            if ((ImGui::GetIO().ConfigFlags & ImGuiConfigFlags_ViewportsEnable) != 0)
+            {
+                ImGui::UpdatePlatformWindows();
+                ImGui::RenderPlatformWindowsDefault();
+            }
+            EndSubmit();
+            return;
+        }
+
+        // the render thread handles ImGui's texture requests, ImGui may only go on once they are done
+        if (m_TextureRequestPacket)
+        {
+            m_RenderThread.Wait(*m_TextureRequestPacket);
+            m_TextureRequestPacket.reset();
+        }
+
+        FramePacket& packet = m_RenderThread.BeginPacket();
+        BuildFrame(packet);
+        bool textureRequests = packet.UI.HasTextureRequests();
+        uint64_t packetIndex = m_RenderThread.SubmitPacket();
+        if (textureRequests)
+            m_TextureRequestPacket = packetIndex;
+
+        // the render thread returns from a low latency frame once it is presented, waiting for it here means SDL
+        // collects the input for the next packet after that instead of while frames are still queued
+        if (m_LowLatency)
+            m_RenderThread.Wait(packetIndex);
+    }
+
+    void Renderer::OnInputEvent(uint64_t timestampNs)
+    {
+        if (m_PendingInputNs == 0)
+            m_PendingInputNs = timestampNs;
     }
 
     struct PipelineReloadEntry
     {
-        VanKPipeLine* Pipeline;
+        VanKPipeLine Pipeline; // reloaded in place, the handle never changes
         VanKGraphicsPipelineSpecification* graphicsSpec;
         VanKComputePipelineSpecification* computeSpec;
         std::string ShaderKey;
@@ -593,7 +1400,7 @@ namespace VanK
         const std::string& fileName,
         VanKGraphicsPipelineSpecification* graphicsSpec,
         VanKComputePipelineSpecification* computeSpec,
-        VanKPipeLine* pipeline,
+        VanKPipeLine pipeline,
         VanKShaderStageFlags flag
     )
     {
@@ -638,8 +1445,6 @@ namespace VanK
 
             RenderCommand::waitForGraphicsQueueIdle();
             
-            RenderCommand::DestroyPipeline(*entry.Pipeline);
-            
             GetShaderLibrary().Remove(entry.ShaderKey);
             
             auto Shader = GetShaderLibrary().Load(entry.ShaderKey, changedFile);
@@ -647,12 +1452,12 @@ namespace VanK
             if (entry.flag == VanKGraphics)
             {
                 entry.graphicsSpec->ShaderStageCreateInfo.VanKShader = Shader;
-                *entry.Pipeline = RenderCommand::createGraphicsPipeline(*entry.graphicsSpec);
+                RenderCommand::ReloadPipeline(entry.Pipeline, *entry.graphicsSpec);
             }
             else
             {
                 entry.computeSpec->ComputePipelineCreateInfo.VanKShader = Shader;
-                *entry.Pipeline = RenderCommand::createComputeShaderPipeline(*entry.computeSpec); 
+                RenderCommand::ReloadPipeline(entry.Pipeline, *entry.computeSpec);
             }
         }
     }
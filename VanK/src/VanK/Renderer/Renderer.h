@@ -1,10 +1,18 @@
 #pragma once
+#include <deque>
+#include <optional>
+
 #include "RenderCommand.h"
 #include "VanK/Core/Window.h"
 #include "FileWatch.h"
 #include "VanK/Core/core.h"
 
 #include "Geometry.h"
+#include "GrowableBuffer.h"
+#include "MeshCache.h"
+#include "MeshSimplifier.h"
+#include "RenderQueue.h"
+#include "RenderThread.h"
 
 namespace VanK
 {
@@ -15,10 +23,12 @@ namespace VanK
                 uint64_t offset; \
                 const size_t dataSize = sizeof(array); \
                 ElementType* dataPtr = static_cast<ElementType*>(ringBuffer->MapTransferBuffer(dataSize, alignof(ElementType), offset)); \
-                memcpy(dataPtr, array, dataSize); \
-                ringBuffer->UnMapTransferBuffer(); \
-                ringBuffer->UploadToGPUBuffer(cmd, VanKTransferBufferLocation{.offset = offset}, \
-                VanKBufferRegion{.buffer = targetBuffer.get(), .offset = 0, .size = dataSize}); \
+                if (dataPtr) { \
+                    memcpy(dataPtr, array, dataSize); \
+                    ringBuffer->UnMapTransferBuffer(); \
+                    ringBuffer->UploadToGPUBuffer(cmd, VanKTransferBufferLocation{.offset = offset}, \
+                    VanKBufferRegion{.buffer = targetBuffer.get(), .offset = 0, .size = dataSize}); \
+                } \
             } while(0)
 
         #define UploadBufferToGpuWithTransferRing(cmd, ringBuffer, targetBuffer, vector, ElementType, dstOffset) \
@@ -27,42 +37,81 @@ namespace VanK
                     uint64_t offset; \
                     const size_t dataSize = vector.size() * sizeof(ElementType); \
                     ElementType* dataPtr = static_cast<ElementType*>(ringBuffer->MapTransferBuffer(dataSize, alignof(ElementType), offset)); \
-                    memcpy(dataPtr, vector.data(), dataSize); \
-                    ringBuffer->UnMapTransferBuffer(); \
-                    ringBuffer->UploadToGPUBuffer(cmd, VanKTransferBufferLocation{.offset = offset}, \
-                    VanKBufferRegion{.buffer = targetBuffer.get(), .offset = dstOffset, .size = dataSize}); \
+                    if (dataPtr) { \
+                        memcpy(dataPtr, vector.data(), dataSize); \
+                        ringBuffer->UnMapTransferBuffer(); \
+                        ringBuffer->UploadToGPUBuffer(cmd, VanKTransferBufferLocation{.offset = offset}, \
+                        VanKBufferRegion{.buffer = targetBuffer.get(), .offset = dstOffset, .size = dataSize}); \
+                    } \
                 } \
             } while(0)
         
     public:
         static void loadModel();
-        static void Init(Window& window);
+        // renderThreadQueueDepth frames may be queued for the render thread, 0 renders on the calling thread.
+        // framesInFlight frames may be queued on the GPU, see RendererAPI::SetFramesInFlight.
+        // headless renders offscreen at the window's size without creating a surface, the window may be uninitialized.
+        static void Init(Window& window, uint32_t renderThreadQueueDepth = 1, uint32_t framesInFlight = 2, bool headless = false);
         static void Shutdown();
         static void BeginSubmit();
         static void EndSubmit();
-        static void DrawFrame();
+        // Main thread: builds the UI and the frame packet, then renders it or hands it to the render thread
         static void Flush();
+        // main thread, the SDL timestamp of an input event, measured until the first frame that sees it is presented
+        static void OnInputEvent(uint64_t timestampNs);
     private:
+        static void BuildFrame(FramePacket& packet);
+        // records and submits what BuildFrame put into the packet, on the render thread if there is one
+        static void DrawFrame(FramePacket& packet);
+        static void publishFrameStats();
+        static void updateLatency(const FramePacket& packet);
         static ShaderLibrary& GetShaderLibrary() { return m_ShaderLibrary; }
         static void RegisterPipelineForShaderWatcher(const std::string& shaderKey, const std::string& fileName, VanKGraphicsPipelineSpecification* graphicsSpec, VanKComputePipelineSpecification* computeSpec,
-                                                     VanKPipeLine* pipeline, VanKShaderStageFlags flag);
+                                                     VanKPipeLine pipeline, VanKShaderStageFlags flag);
         static void WatchShaderFiles();
         static void ReloadPipelines();
+        static void importModel(std::vector<CookedMeshRange>& ranges);
+        static void buildLodChain(const std::vector<CookedMeshRange>& ranges);
+        static void registerModel();
+        static void updateLodComparison(float deltaTime, const shaderio::MeshletCullStats& meshletStats);
+        static void CompareModelLoaders();
+        static void RunGeometryChurn();
+        static uint64_t FrameUploadBytes();
     public:
-        inline static std::unordered_map<std::string, std::pair<uint32_t, uint32_t>> InstancedIndexRanges;
-        inline static std::unordered_map<std::string, std::pair<uint32_t, uint32_t>> InstancedVertexRanges;
-        inline static std::unordered_map<std::string, std::pair<uint32_t, uint32_t>> InstancedDataRanges;
-        inline static Ref<IndexBuffer> m_InstancedIndexBuffer;
-        inline static Ref<VertexBuffer> m_InstancedVertexBuffer; // change to storage in the future maybe ? 
+        // Makes sure the frame being recorded has its ring region and bytes left in it. The ring is replaced when they
+        // don't fit or there are fewer regions than frames in flight, the old one is released once no frame reads it.
+        static void ReserveTransferRing(uint64_t bytes);
+
+        inline static GrowableBuffer<VertexBuffer> m_InstancedVertexBuffer; // change to storage in the future maybe ? 
         inline static Ref<TransferBuffer> m_TransferRingBuffer;
-        inline static Ref<StorageBuffer> m_InstancedStorageBuffer;
+        inline static uint64_t m_TransferRingCapacity = 0;
+        inline static GrowableBuffer<StorageBuffer> m_InstancedStorageBuffer;
     private:
         inline static std::vector<shaderio::InstancedVertexData> vertices;
         inline static std::vector<uint32_t> indices;
-        inline static bool vSync = false;
+        // what gets uploaded, views either the vectors above (fresh import) or the mapped cooked file
+        inline static std::span<const shaderio::InstancedVertexData> m_ModelVertices;
+        inline static std::span<const uint32_t> m_ModelIndices;
+        inline static std::vector<CookedMeshRange> meshRanges;
+        inline static std::span<const CookedMeshRange> m_ModelRanges;
+        inline static Scope<CookedMesh> m_CookedModel;
+        inline static MeshHandle m_ModelMesh;
+        inline static std::vector<MeshHandle> m_ModelSubMeshes; // records inside m_ModelMesh, one per imported mesh
+        inline static std::vector<shaderio::Meshlet> meshlets;
+        inline static std::vector<shaderio::MeshLodGroup> lodGroups;
+        inline static std::vector<shaderio::MeshLod> lods;
+        inline static std::span<const shaderio::Meshlet> m_ModelMeshlets;
+        inline static std::span<const shaderio::MeshLodGroup> m_ModelLodGroups;
+        inline static std::span<const shaderio::MeshLod> m_ModelLods;
+        inline static uint32_t m_BaseMeshletCount = 0;  // LOD 0 only
+        inline static uint64_t m_BaseTriangleCount = 0;
+        inline static MeshLodSettings m_LodSettings;
+        static constexpr uint32_t MinGeometryVertices = 1 << 16;
+        static constexpr uint32_t MinGeometryIndices = 3 << 16;
+        static constexpr uint64_t GeometryUploadBudget = 8ull << 20; // bytes of staged geometry uploaded per frame
+        static constexpr uint64_t TransferRingSlack = 64ull << 10;   // alignment padding between a frame's uploads
+        static constexpr uint64_t TransferRingAlignment = 16;        // the largest alignment an upload asks for
         inline static bool windowMinimized = false;
-        inline static Extent2D m_ViewportSize;
-        inline static Extent2D lastViewportExtent = {0, 0};
         inline static VanKCommandBuffer cmd = nullptr;
         inline static ShaderLibrary m_ShaderLibrary;
         
@@ -73,8 +122,49 @@ namespace VanK
         inline static VanKComputePipelineSpecification m_ComputeDrawIndirectPipelineSpecification = {};
         
         inline static Ref<UniformBuffer> uniformScene;
+
+        // every draw of the frame goes through here, sorted and batched before rendering begins
+        inline static RenderQueue m_RenderQueue;
+
+        inline static RenderThread m_RenderThread;
+        inline static FramePacket m_InlinePacket; // without a render thread
+        inline static std::optional<uint64_t> m_TextureRequestPacket; // ImGui can't begin a frame before it is rendered
+        inline static FrameStats m_FrameStats;
+        inline static std::mutex m_FrameStatsMutex;
+
+        // render thread, frames with input waiting for their present time
+        struct LatencySample
+        {
+            uint64_t Frame;
+            uint64_t InputNs;
+            bool LowLatency;
+        };
+        inline static std::deque<LatencySample> m_LatencySamples;
+        inline static std::array<LatencyStats, 2> m_Latency = {};
         
-        inline static Ref<IndirectBuffer> indirectBuffer;
+        // grown in DrawFrame when the scene outgrows them, the UBO picks up the new addresses the same frame
+        inline static GrowableBuffer<IndirectBuffer> indirectBuffer;
         inline static Ref<IndirectBuffer> countBuffer;
+        inline static GrowableBuffer<StorageBuffer> m_MeshletBuffer;
+        inline static GrowableBuffer<StorageBuffer> m_LodGroupBuffer;
+        inline static GrowableBuffer<StorageBuffer> m_LodBuffer;
+
+        // countBuffer holds one MeshletCullStats per slot, read back frames-in-flight frames later once that frame is done.
+        // One more slot than frames can be in flight, so the slot read is never one still being written.
+        static constexpr uint32_t MeshletStatsSlots = 5;
+        inline static uint64_t m_MeshletFrameIndex = 0;
+        inline static shaderio::MeshletCullStats m_MeshletStats = {};
+
+        // UI state, only the main thread touches these, the render thread gets copies through the packet
+        inline static bool vSync = false;
+        inline static Extent2D m_ViewportSize;
+        inline static Extent2D lastViewportExtent = {0, 0};
+        inline static bool m_MeshletCulling = true;
+        inline static bool m_LodEnabled = true;
+        inline static float m_LodThreshold = 1.0f; // pixels
+        inline static float m_CameraDistance = 6.63f;
+        inline static bool m_ParallelRecording = true; // scene draws recorded into secondaries by worker threads
+        inline static bool m_LowLatency = false;
+        inline static uint64_t m_PendingInputNs = 0; // oldest input event since the last packet
     };
 }
@@ -14,8 +14,18 @@ namespace VanK
     struct VanKCommandBuffer_T;
     using VanKCommandBuffer = VanKCommandBuffer_T*;
     
-    struct VanKPipeLine_T;
-    using VanKPipeLine = VanKPipeLine_T*;
+    // Generational handle into the backend's pipeline table. Reloading swaps the table entry in place, so the
+    // handle stays valid, destroying it bumps the slot generation so stale handles are caught.
+    struct VanKPipeLine
+    {
+        static constexpr uint32_t InvalidIndex = 0xFFFFFFFF;
+
+        uint32_t Index = InvalidIndex;
+        uint32_t Generation = 0;
+
+        bool IsValid() const { return Index != InvalidIndex; }
+        bool operator==(const VanKPipeLine&) const = default;
+    };
 
     struct VanKSpecializationMapEntries
     {
@@ -271,6 +281,23 @@ namespace VanK
         std::vector<VanKFormat> VanKColorAttachmentFormats;
     };
 
+    enum VanKShaderStageFlagBits
+    {
+        VanK_SHADER_STAGE_VERTEX_BIT = 0x00000001,
+        VanK_SHADER_STAGE_FRAGMENT_BIT = 0x00000002,
+        VanK_SHADER_STAGE_COMPUTE_BIT = 0x00000004,
+        VanK_SHADER_STAGE_ALL_GRAPHICS = VanK_SHADER_STAGE_VERTEX_BIT | VanK_SHADER_STAGE_FRAGMENT_BIT,
+    };
+    using VanKShaderStageMask = uint32_t;
+
+    // Push constants are limited to maxPushConstantsSize, 128 bytes is guaranteed everywhere
+    struct VanKPushConstantRange
+    {
+        VanKShaderStageMask stageFlags;
+        uint32_t offset;
+        uint32_t size;
+    };
+
     struct VanKGraphicsPipelineSpecification
     {
         VanKPipelineShaderStageCreateInfo ShaderStageCreateInfo;
@@ -281,6 +308,7 @@ namespace VanK
         VanKPipelineMultisampleStateCreateInfo MultisampleStateCreateInfo;
         VanKPipelineDepthStencilStateCreateInfo DepthStateInfo;
         VanKPipelineRenderingCreateInfo RenderingCreateInfo;
+        std::vector<VanKPushConstantRange> PushConstantRanges;
     };
 
     struct VanKComputePipelineCreateInfo
@@ -291,6 +319,30 @@ namespace VanK
     struct VanKComputePipelineSpecification
     {
         VanKComputePipelineCreateInfo ComputePipelineCreateInfo;
+        std::vector<VanKPushConstantRange> PushConstantRanges;
+    };
+
+    // pipeline creation requests answered by an existing pipeline vs. ones that built a new one
+    struct VanKPipelineCacheStats
+    {
+        uint64_t Hits;
+        uint64_t Misses;
+        uint32_t Pipelines;
+    };
+
+    // state binds recorded into the last finished command buffer vs. ones dropped because nothing changed
+    struct VanKCommandStats
+    {
+        uint32_t Issued;
+        uint32_t Filtered;
+    };
+
+    // When a frame left the CPU and when it was seen on screen, in SDL_GetTicksNS() time like SDL event timestamps
+    struct VanKFrameTiming
+    {
+        uint64_t SubmitNs;
+        uint64_t PresentNs;  // 0 until observed, the GPU finishing the frame when the present itself can't be waited on
+        bool PresentWait;    // PresentNs comes from VK_KHR_present_wait
     };
 
     struct VanKComputePass
@@ -367,6 +419,13 @@ namespace VanK
         VanK_Render_ImGui
     };
 
+    // what the rendering begun by BeginRendering is recorded into
+    enum VanKRenderingContents
+    {
+        VanK_RenderingContents_Inline,                  // the command buffer that began it
+        VanK_RenderingContents_SecondaryCommandBuffers  // only ExecuteSecondaryCommandBuffers, workers record the draws
+    };
+
     enum class VanKIndexElementSize
     {
         Uint16,
@@ -407,17 +466,52 @@ namespace VanK
         virtual void RebuildSwapchain(bool vSyncVal) = 0; 
         virtual ImTextureID getImTextureID(uint32_t index = 0) const = 0;
         virtual void setViewportSize(Extent2D viewportSize) = 0;
-        virtual VanKPipeLine createGraphicsPipeline(VanKGraphicsPipelineSpecification pipelineSpecification) = 0;
-        virtual VanKPipeLine createComputeShaderPipeline(VanKComputePipelineSpecification computePipelineSpecification) = 0;
+        // what the next VanK_Render_ImGui pass draws, nullptr draws ImGui::GetDrawData()
+        virtual void SetImGuiDrawData(ImDrawData* drawData) = 0;
+        virtual VanKPipeLine createGraphicsPipeline(const VanKGraphicsPipelineSpecification& pipelineSpecification) = 0;
+        virtual VanKPipeLine createComputeShaderPipeline(const VanKComputePipelineSpecification& computePipelineSpecification) = 0;
+        virtual VanKPipelineCacheStats GetPipelineCacheStats() const = 0;
+        virtual VanKCommandStats GetCommandStats() const = 0;
         virtual void DestroyAllPipelines() = 0;
         virtual void DestroyPipeline(VanKPipeLine pipeline) = 0;
+        // rebuilds in place, the GPU must be done with the old pipeline
+        virtual bool ReloadPipeline(VanKPipeLine pipeline, const VanKGraphicsPipelineSpecification& pipelineSpecification) = 0;
+        virtual bool ReloadPipeline(VanKPipeLine pipeline, const VanKComputePipelineSpecification& computePipelineSpecification) = 0;
         virtual VanKCommandBuffer BeginCommandBuffer() { return nullptr; }
         virtual void EndCommandBuffer(VanKCommandBuffer cmd) = 0;
         virtual void BeginFrame() = 0;
         virtual void EndFrame() = 0;
+        // Frames count from 1 and each one signals its number on the GPU when it finishes. BeginFrame waits until the
+        // frame framesInFlight before it is done, so that many frames may be queued on the GPU at once. A change takes
+        // effect after the frame being recorded has been submitted.
+        virtual void SetFramesInFlight(uint32_t framesInFlight) = 0;
+        virtual uint32_t GetFramesInFlight() const = 0;
+        // A resource the frame being recorded uses may be released or reused once GetCompletedFrame() reaches
+        // GetRecordingFrame() as it was at that time.
+        virtual uint64_t GetRecordingFrame() const = 0;
+        virtual uint64_t GetCompletedFrame() const = 0;
+        // Low latency: EndFrame returns once the frame is presented (or finished on the GPU without present wait), so the
+        // next frame samples input right before it is drawn instead of queuing behind frames that are still in flight.
+        virtual void SetLowLatency(bool enabled) = 0;
+        virtual bool IsPresentWaitSupported() const = 0;
+        // false until the frame's present has been observed, or when it is too old to still be tracked
+        virtual bool GetFrameTiming(uint64_t frame, VanKFrameTiming& timing) const = 0;
+        virtual bool IsHeadless() const = 0;
         virtual void BindPipeline(VanKCommandBuffer cmd, VanKPipelineBindPoint pipelineBindPoint, VanKPipeLine pipeline) = 0;
         virtual void BindUniformBuffer(VanKCommandBuffer cmd, VanKPipelineBindPoint bindPoint, UniformBuffer* buffer, uint32_t set, uint32_t binding, uint32_t arrayElement) = 0;
-        virtual void BeginRendering(VanKCommandBuffer cmd, const VanKColorTargetInfo* color_target_info, uint32_t num_color_targets, VanKDepthStencilTargetInfo depth_stencil_target_info, VanKRenderOption render_option) = 0;
+        virtual void PushConstants(VanKCommandBuffer cmd, VanKShaderStageMask stageFlags, const void* data, uint32_t size, uint32_t offset = 0) = 0;
+        virtual void BeginRendering(VanKCommandBuffer cmd, const VanKColorTargetInfo* color_target_info, uint32_t num_color_targets, VanKDepthStencilTargetInfo depth_stencil_target_info, VanKRenderOption render_option,
+                                    VanKRenderingContents contents = VanK_RenderingContents_Inline) = 0;
+        // Every recording thread has its own command pool per frame in flight, thread is 0..GetRecordingThreadCount()-1
+        // and only one thread at a time may use an index. The secondary continues the rendering begun on primary and
+        // inherits none of its bound state.
+        virtual uint32_t GetRecordingThreadCount() const = 0;
+        // false when secondaries can't run inside the frame's statistics query, everything is recorded on the primary then
+        virtual bool IsParallelRecordingSupported() const = 0;
+        virtual VanKCommandBuffer BeginSecondaryCommandBuffer(VanKCommandBuffer primary, uint32_t thread) = 0;
+        virtual void EndSecondaryCommandBuffer(VanKCommandBuffer cmd) = 0;
+        // main thread, in the order the draws have to happen
+        virtual void ExecuteSecondaryCommandBuffers(VanKCommandBuffer primary, const VanKCommandBuffer* secondaries, uint32_t count) = 0;
         virtual void BindFragmentSamplers(VanKCommandBuffer cmd, uint32_t firstSlot, const TextureSamplerBinding* samplers, uint32_t num_bindings) = 0;
         virtual void SetViewport(VanKCommandBuffer cmd, uint32_t viewportCount, const VanKViewport viewport) = 0;
         virtual void SetScissor(VanKCommandBuffer cmd, uint32_t scissorCount, VankRect scissor) = 0;
@@ -425,11 +519,13 @@ namespace VanK
         virtual void BindIndexBuffer(VanKCommandBuffer cmd, const IndexBuffer& indexBuffer, VanKIndexElementSize elementSize) = 0;
         virtual void Draw(VanKCommandBuffer cmd, uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance) = 0;
         virtual void DrawIndexed(VanKCommandBuffer cmd, uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance) = 0;
+        virtual void DrawIndexedIndirect(VanKCommandBuffer cmd, IndirectBuffer& indirectBuffer, uint32_t indirectBufferOffset, uint32_t drawCount, uint32_t stride) = 0;
         virtual void DrawIndexedIndirectCount(VanKCommandBuffer cmd, IndirectBuffer& indirectBuffer, uint32_t indirectBufferOffset, IndirectBuffer& countBuffer, uint32_t countBufferOffset, uint32_t maxDrawCount, uint32_t stride) = 0;
         virtual void EndRendering(VanKCommandBuffer cmd) = 0;
         virtual VanKComputePass* BeginComputePass(VanKCommandBuffer cmd, VertexBuffer* buffer = nullptr) = 0;
         virtual void DispatchCompute(VanKComputePass* computePass, uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) = 0;
         virtual void EndComputePass(VanKComputePass* computePass) = 0;
+        virtual void CopyBuffer(VanKCommandBuffer cmd, const VanKBuffer& srcBuffer, uint64_t srcOffset, const VanKBuffer& dstBuffer, uint64_t dstOffset, uint64_t size) = 0;
         virtual void waitForGraphicsQueueIdle() = 0;
         //---------
         
@@ -439,6 +535,11 @@ namespace VanK
         // --- New: Configuration ---
         struct Config {
             SDL_Window* window = nullptr;
+            uint32_t framesInFlight = 2;
+            // No window, surface or swapchain: frames are rendered into offscreen targets of headlessExtent and never
+            // presented, for benchmarks and tests on machines without a display (software drivers like lavapipe)
+            bool headless = false;
+            Extent2D headlessExtent = {1280, 720};
         };
         
         static std::unique_ptr<RendererAPI> Create(const Config& config);
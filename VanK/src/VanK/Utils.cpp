@@ -2,6 +2,7 @@
 
 #include <iostream>
 #include <fstream>
+#include <utility>
 #include <vector>
 #include <SDL3/SDL_dialog.h>
 #include <SDL3/SDL_filesystem.h>
@@ -12,6 +13,19 @@
 #include "Core/Application.h"
 #include "Core/window.h"
 
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+    #include <psapi.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/resource.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
 namespace VanK
 {
     /*static const SDL_DialogFileFilter filters[] = {
@@ -250,4 +264,132 @@ namespace VanK
         in.read(reinterpret_cast<char*>(&hash), sizeof(hash));
         return in.good();
     }
+
+    size_t Utility::GetPeakResidentMemory()
+    {
+#if defined(_WIN32)
+        PROCESS_MEMORY_COUNTERS counters{};
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+            return counters.PeakWorkingSetSize;
+        return 0;
+#else
+        struct rusage usage{};
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+            return 0;
+    #if defined(__APPLE__)
+        return static_cast<size_t>(usage.ru_maxrss);        // bytes
+    #else
+        return static_cast<size_t>(usage.ru_maxrss) * 1024; // kilobytes
+    #endif
+#endif
+    }
+
+    // memory mapped file ---------------------------------
+    MappedFile::MappedFile(const std::string& path)
+    {
+#if defined(_WIN32)
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return;
+
+        LARGE_INTEGER fileSize{};
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+        {
+            CloseHandle(file);
+            return;
+        }
+
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping)
+        {
+            CloseHandle(file);
+            return;
+        }
+
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!view)
+        {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            return;
+        }
+
+        m_FileHandle = file;
+        m_MappingHandle = mapping;
+        m_Data = static_cast<const uint8_t*>(view);
+        m_Size = static_cast<size_t>(fileSize.QuadPart);
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+
+        struct stat fileStat{};
+        if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0)
+        {
+            close(fd);
+            return;
+        }
+
+        void* view = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view == MAP_FAILED)
+        {
+            close(fd);
+            return;
+        }
+        madvise(view, static_cast<size_t>(fileStat.st_size), MADV_SEQUENTIAL);
+
+        m_FileDescriptor = fd;
+        m_Data = static_cast<const uint8_t*>(view);
+        m_Size = static_cast<size_t>(fileStat.st_size);
+#endif
+    }
+
+    MappedFile::~MappedFile()
+    {
+        Close();
+    }
+
+    MappedFile::MappedFile(MappedFile&& other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Close();
+            m_Data = std::exchange(other.m_Data, nullptr);
+            m_Size = std::exchange(other.m_Size, 0);
+#if defined(_WIN32)
+            m_FileHandle = std::exchange(other.m_FileHandle, nullptr);
+            m_MappingHandle = std::exchange(other.m_MappingHandle, nullptr);
+#else
+            m_FileDescriptor = std::exchange(other.m_FileDescriptor, -1);
+#endif
+        }
+        return *this;
+    }
+
+    void MappedFile::Close()
+    {
+#if defined(_WIN32)
+        if (m_Data)
+            UnmapViewOfFile(m_Data);
+        if (m_MappingHandle)
+            CloseHandle(m_MappingHandle);
+        if (m_FileHandle)
+            CloseHandle(m_FileHandle);
+        m_FileHandle = nullptr;
+        m_MappingHandle = nullptr;
+#else
+        if (m_Data)
+            munmap(const_cast<uint8_t*>(m_Data), m_Size);
+        if (m_FileDescriptor >= 0)
+            close(m_FileDescriptor);
+        m_FileDescriptor = -1;
+#endif
+        m_Data = nullptr;
+        m_Size = 0;
+    }
 }
@@ -5,6 +5,35 @@
 
 namespace VanK
 {
+    // Read-only memory mapping of a whole file, unmapped on destruction
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        explicit MappedFile(const std::string& path);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+
+        bool IsValid() const { return m_Data != nullptr; }
+        const uint8_t* Data() const { return m_Data; }
+        size_t Size() const { return m_Size; }
+    private:
+        void Close();
+    private:
+        const uint8_t* m_Data = nullptr;
+        size_t m_Size = 0;
+#if defined(_WIN32)
+        void* m_FileHandle = nullptr;
+        void* m_MappingHandle = nullptr;
+#else
+        int m_FileDescriptor = -1;
+#endif
+    };
+
     class Utility
     {
     public:
@@ -21,5 +50,8 @@ namespace VanK
         static XXH128_hash_t calcul_hash_streaming(const std::string& path);
         static void saveHashToFile(const std::string& hashFile, const XXH128_hash_t& hash);
         static bool loadHashFromFile(const std::string& hashFile, XXH128_hash_t& hash);
+
+        // peak resident set size of the process in bytes (0 if the platform can't tell)
+        static size_t GetPeakResidentMemory();
     };
 }
\ No newline at end of file